@@ -3,13 +3,20 @@
 
 
 #include <string>
+#include <string_view>
 #include <nlohmann/json.hpp>
+#include "albot/EntityStore.hpp"
 
 struct LightSocket {
 	const std::function<void(const std::string&, std::function<void(const nlohmann::json&)>)> wrapped_register;
 	const std::function<void(const std::string&, const nlohmann::json&)> wrapped_emitter;
-	const std::function<std::map<std::string, nlohmann::json>& ()> wrapped_entities;
+	const std::function<EntityStore& ()> wrapped_entities;
 	const std::function<nlohmann::json& ()> wrapped_character;
+	const std::function<void(std::string_view)> wrapped_attack;
+	const std::function<void(std::string_view)> wrapped_heal;
+	const std::function<void(std::string_view, std::string_view)> wrapped_skill;
+	const std::function<void(size_t, std::string_view)> wrapped_equip;
+	const std::function<size_t()> wrapped_ping;
 
 	void on(const std::string& name, std::function<void(const nlohmann::json&)> handler) const {
 		wrapped_register(name, handler);
@@ -17,7 +24,25 @@ struct LightSocket {
 	void emit(const std::string& name, const nlohmann::json& data) const {
 		wrapped_emitter(name, data);
 	}
-	std::map<std::string, nlohmann::json>& entities() const {
+	void attack(std::string_view id) const {
+		wrapped_attack(id);
+	}
+	void heal(std::string_view id) const {
+		wrapped_heal(id);
+	}
+	void skill(std::string_view name, std::string_view target = {}) const {
+		wrapped_skill(name, target);
+	}
+	void equip(size_t num, std::string_view slot = {}) const {
+		wrapped_equip(num, slot);
+	}
+	/**
+	 * Median round trip to the server, in milliseconds.
+	 */
+	size_t ping() const {
+		return wrapped_ping();
+	}
+	EntityStore& entities() const {
 		return wrapped_entities();
 	}
 	nlohmann::json& character() const {
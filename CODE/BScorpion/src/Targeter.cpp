@@ -10,26 +10,22 @@ Targeter::Targeter(const LightSocket& wrapper, const std::string& character_name
 	this->tag_targets = tag_targets;
 }
 
-bool Targeter::is_targeting_party(const nlohmann::json& entity) {
-	if (entity.contains("target")) {
-		const auto& jtarget = entity["target"];
-		if (jtarget.is_string()) {
-			const std::string target = jtarget.get<std::string>();
-			if (this->solo) {
-				return target == character_name;
-			}
-			return std::find(safe.begin(), safe.end(), target) != safe.end();
+bool Targeter::is_targeting_party(const EntityStore::Entity& entity) {
+	const std::string& target = entity.getTarget();
+	if (!target.empty()) {
+		if (this->solo) {
+			return target == character_name;
 		}
+		return std::find(safe.begin(), safe.end(), target) != safe.end();
 	}
 	return false;
 }
 
-bool Targeter::will_entity_die_from_fire(const nlohmann::json& entity) {
-	auto status_it = entity.find("s");
-	if(status_it == entity.end()) {
+bool Targeter::will_entity_die_from_fire(const EntityStore::Entity& entity) {
+	const auto& status = entity.getStatus();
+	if(!status.is_object()) {
 		return false;
 	}
-	const auto& status = *status_it;
 	
 	auto burn_status_it = status.find("burned");
 	if(burn_status_it == status.end()) {
@@ -51,15 +47,12 @@ bool Targeter::will_entity_die_from_fire(const nlohmann::json& entity) {
 	double damage_per_tick = burn_intensity / 5;
 	double ticks_remaining = std::floor(ms_remaining / 240);
 	double damage_predicted = damage_per_tick * ticks_remaining;
-	return damage_predicted > entity["hp"];
+	return damage_predicted > entity.getHp();
 }
 
-bool Targeter::should_target_entity(const nlohmann::json& entity, bool event) {
-	if(!entity.contains("type")) {
-		return false;
-	}
-	if (entity["type"].get<std::string>() == "monster") {
-		const std::string& mtype = entity["mtype"];
+bool Targeter::should_target_entity(const EntityStore::Entity& entity, bool event) {
+	if (entity.isMonster()) {
+		const std::string& mtype = entity.getType();
 		if (mtype == "grinch") {
 			return false;
 		}
@@ -70,59 +63,63 @@ bool Targeter::should_target_entity(const nlohmann::json& entity, bool event) {
 			if (event && !events.contains(mtype)) {
 				return false;
 			}
-			if (entity.contains("cooperative")) {
+			if (entity.getExtra().contains("cooperative")) {
 				return true;
 			}
 			if (tag_targets) {
-				if (!entity.contains("target")) {
-					return true;
-				}
-				return entity["target"].is_null();
+				return entity.getTarget().empty();
 			}
 		}
 	}
 	return false;
 }
 
-std::optional<std::reference_wrapper<const nlohmann::json>> Targeter::get_priority_target(bool any, bool ignore_fire, bool event) {
+EntityStore::Handle Targeter::get_priority_target(bool any, bool ignore_fire, bool event) {
 	const auto& entities = socket.entities();
 	const auto& character = socket.character();
 	if (any) {
-		for (const auto& [id, entity] : entities) {
-			if (should_target_entity(entity, event)) {
-				if (!require_los) {
-					// NYI to not have LOS...
-					if (ignore_fire || !will_entity_die_from_fire(entity)) {
-						return entity;
-					}
+		auto viable = [&](const EntityStore::Entity& entity) {
+			// NYI to not have LOS...
+			return should_target_entity(entity, event) && !require_los && (ignore_fire || !will_entity_die_from_fire(entity));
+		};
+		// Something that can be hit from where we stand first, only then anything at all.
+		if (character.contains("range") && character.contains("map")) {
+			for (const EntityStore::Entity& entity : entities.queryRadius(character["map"].get<std::string>(), character["x"], character["y"], character["range"])) {
+				if (viable(entity)) {
+					return entity.getHandle();
 				}
 			}
 		}
-		return std::nullopt;
+		for (const EntityStore::Entity entity : entities) {
+			if (viable(entity)) {
+				return entity.getHandle();
+			}
+		}
+		return EntityStore::Handle();
 	} else {
-		using SORT_ENTRY = std::pair<std::tuple<unsigned int, bool, double>, std::reference_wrapper<const nlohmann::json>>;
+		using SORT_ENTRY = std::pair<std::tuple<unsigned int, bool, double>, EntityStore::Entity>;
 		std::vector<SORT_ENTRY> potentialTargets = {};
-		for (const auto& [id, entity] : entities) {
+		for (const EntityStore::Entity entity : entities) {
 			if (should_target_entity(entity, event)) {
 				if (!require_los) {
 					if (ignore_fire || !will_entity_die_from_fire(entity)) {
 						potentialTargets.emplace_back(
 							std::make_tuple(
-								targeting_priorities.at(entity["mtype"].get<std::string>()),
+								targeting_priorities.at(entity.getType()),
 								!is_targeting_party(entity),
 								Functions::distance_squared(character, entity)
 							),
-							std::cref(entity)
+							entity
 						);
 					}
 				}
 			}
 		}
 		if (potentialTargets.empty()) {
-			return std::nullopt;
+			return EntityStore::Handle();
 		}
 		return std::min_element(potentialTargets.begin(), potentialTargets.end(), [](const SORT_ENTRY& first, const SORT_ENTRY& second) {
 			return first.first < second.first;
-		})->second;
+		})->second.getHandle();
 	}
 }
\ No newline at end of file
@@ -32,10 +32,13 @@ private:
 	bool tag_targets;
 public:
 	Targeter(const LightSocket& wrapper, const std::string& character_name, const std::vector<std::string>& monster_targets, std::vector<std::string> safe, bool solo = false, bool require_los = false, bool tag_targets = true);
-	bool is_targeting_party(const nlohmann::json& entity);
-	static bool will_entity_die_from_fire(const nlohmann::json& entity);
-	bool should_target_entity(const nlohmann::json& entity, bool event = false);
-	std::optional<std::reference_wrapper<const nlohmann::json>> get_priority_target(bool any = false, bool ignore_fire = false, bool event = false);
+	bool is_targeting_party(const EntityStore::Entity& entity);
+	static bool will_entity_die_from_fire(const EntityStore::Entity& entity);
+	bool should_target_entity(const EntityStore::Entity& entity, bool event = false);
+	/**
+	 * @returns  The entity to attack, safe to keep across ticks. Unset if there's nothing worth attacking.
+	 */
+	EntityStore::Handle get_priority_target(bool any = false, bool ignore_fire = false, bool event = false);
 };
 
 #endif
\ No newline at end of file
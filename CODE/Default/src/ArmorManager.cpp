@@ -62,10 +62,7 @@ void ArmorManager::ArmorSet::attempt_equip(const LightSocket& wrapper) const {
 			for (size_t i = 0; i < items.size(); i++) {
 				auto& item = items[i];
 				if (filter.test(item)) {
-					wrapper.emit("equip", {
-						{"num", i},
-						{"slot", filter.slot}
-					});
+					wrapper.equip(i, filter.slot);
 					// Swap the items on the client...
 					std::swap(item, slot);
 					break;
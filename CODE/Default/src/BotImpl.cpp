@@ -34,10 +34,19 @@ RESULT invoke_service(const std::string& name, ARGUMENTS* arguments) {
 
 LightSocket buildLightSocket(SocketWrapper& wrapper) {
 	return {
-		std::bind_front(&SocketWrapper::registerEventCallback, std::ref(wrapper)),
+		[&wrapper](const std::string& name, std::function<void(const nlohmann::json&)> handler) {
+			wrapper.registerEventCallback(name, handler);
+		},
 		std::bind_front(&SocketWrapper::emit, std::ref(wrapper)),
 		std::bind_front(&SocketWrapper::getEntities, std::ref(wrapper)),
-		std::bind_front(&SocketWrapper::getCharacter, std::ref(wrapper))
+		std::bind_front(&SocketWrapper::getCharacter, std::ref(wrapper)),
+		std::bind_front(&SocketWrapper::attack, std::ref(wrapper)),
+		std::bind_front(&SocketWrapper::heal, std::ref(wrapper)),
+		std::bind_front(&SocketWrapper::skill, std::ref(wrapper)),
+		std::bind_front(&SocketWrapper::equip, std::ref(wrapper)),
+		[&wrapper]() {
+			return size_t(std::chrono::duration_cast<std::chrono::milliseconds>(wrapper.getRttLatency().getPercentile(50)).count());
+		}
 	};
 }
 
@@ -128,6 +137,9 @@ public:
 	auto distance(const nlohmann::json& A, const nlohmann::json& B) {
 		return std::hypot(A["x"].get<double>() - B["x"].get<double>(), A["y"].get<double>() - B["y"].get<double>());
 	};
+	auto distance(const nlohmann::json& A, const EntityStore::Entity& B) {
+		return std::hypot(A["x"].get<double>() - B.getX(), A["y"].get<double>() - B.getY());
+	};
 	auto determine_clockwise(double origin_x, double origin_y, double target_x, double target_y, double range) {
 		auto CW = get_kite_point(origin_x, origin_y, target_x, target_y, range, true);
 		auto ACW = get_kite_point(origin_x, origin_y, target_x, target_y, range, false);
@@ -135,19 +147,19 @@ public:
 		return distance(CHAR_LOC, CW) < distance(CHAR_LOC, ACW);
 	};
 
-	auto find_viable_target() {
+	std::optional<EntityStore::Entity> find_viable_target() {
 		if (curEvent.has_value()) {
-			return targeter.get_priority_target(false, true, true);
+			return wrapper.getEntities().resolve(targeter.get_priority_target(false, true, true));
 		} else {
-			return targeter.get_priority_target(true, true, false);
+			return wrapper.getEntities().resolve(targeter.get_priority_target(true, true, false));
 		}
 	};
 
-	auto find_viable_target_ignore_fire() {
+	std::optional<EntityStore::Entity> find_viable_target_ignore_fire() {
 		if (curEvent.has_value()) {
-			return targeter.get_priority_target(false, false, true);
+			return wrapper.getEntities().resolve(targeter.get_priority_target(false, false, true));
 		} else {
-			return targeter.get_priority_target(true, true, false);
+			return wrapper.getEntities().resolve(targeter.get_priority_target(true, true, false));
 		}
 	};
 
@@ -162,13 +174,7 @@ public:
 		auto vxy = MovementMath::calculateVelocity(data);
 		data["vx"] = vxy.first;
 		data["vy"] = vxy.second;
-		wrapper.emit("move", {
-			{"x", getX()},
-			{"y", getY()},
-			{"going_x", x},
-			{"going_y", y},
-			{"m", getMapId() }
-		});
+		wrapper.move(getX(), getY(), x, y, getMapId());
 	}
 	void state_controller() {
 		if (curEvent.has_value()) {
@@ -186,16 +192,16 @@ public:
 					if (party_member == name) {
 						if (Functions::needs_hp(character)) {
 							skill_helper.mark_used("attack");
-							wrapper.emit("heal", { { "id", name } });
+							wrapper.heal(name);
 							break;
 						}
 					} else {
-						auto it = entities.find(party_member);
-						if (it != entities.end()) {
-							const auto& member = it->second;
+						auto found = entities.find(party_member);
+						if (found.has_value()) {
+							const EntityStore::Entity& member = *found;
 							if (Functions::needs_hp(member) && Functions::distance(character, member) < getRange()) {
 								skill_helper.mark_used("attack");
-								wrapper.emit("heal", { { "id", party_member } });
+								wrapper.heal(party_member);
 								break;
 							}
 						}
@@ -205,13 +211,13 @@ public:
 		}
 		auto attack_target = find_viable_target();
 		if (attack_target.has_value()) {
-			const nlohmann::json& monster_target = attack_target.value();
+			const EntityStore::Entity& monster_target = attack_target.value();
 			if (CHARACTER_CLASS == ClassEnum::PRIEST) {
 
-				if (!monster_target.contains("target") || monster_target["target"].is_null()) {
+				if (monster_target.getTarget().empty()) {
 					skill_helper.attempt_targeted("zapperzap", monster_target);
 				}
-				if (double(monster_target["hp"]) / double(monster_target["max_hp"]) < 0.2 && monster_target["mtype"].get<std::string>() != "bgoo") {
+				if (double(monster_target.getHp()) / double(monster_target.getMaxHp()) < 0.2 && monster_target.getType() != "bgoo") {
 					LUCK_SET.attempt_equip(lightSocket);
 				}
 			}
@@ -220,16 +226,16 @@ public:
 				if (CHARACTER_CLASS == ClassEnum::PRIEST) {
 					if (skill_helper.can_use("darkblessing") && character["s"].contains("warcry")) {
 						skill_helper.mark_used("darkblessing");
-						wrapper.emit("skill", { {"name", "darkblessing"} });
+						wrapper.skill("darkblessing");
 					}
 					skill_helper.attempt_targeted("curse", monster_target);
-					if (monster_target["hp"].get<long>() > 20000) {
+					if (monster_target.getHp() > 20000) {
 						skill_helper.attempt_attack(monster_target);
 					}
 				} else if (CHARACTER_CLASS == ClassEnum::WARRIOR) {
 					if (skill_helper.can_use("warcry") && !(character["s"].contains("warcry"))) {
 						skill_helper.mark_used("warcry");
-						wrapper.emit("skill", { {"name", "warcry"} });
+						wrapper.skill("warcry");
 					}
 					skill_helper.attempt_attack(monster_target);
 				}
@@ -237,7 +243,7 @@ public:
 			if constexpr (CHARACTER_CLASS == ClassEnum::WARRIOR) {
 				if(!isMoving()) {
 					if (distance(character, monster_target) > 0.5 * getRange()) {
-						move(monster_target["x"].get<double>(), monster_target["y"].get<double>());
+						move(monster_target.getX(), monster_target.getY());
 					}
 				}
 			}
@@ -251,7 +257,8 @@ public:
 				}
 			}
 			if constexpr (CHARACTER_CLASS == ClassEnum::WARRIOR) {
-				if (entities.contains("Geoffriel") && !entities.at("Geoffriel")["rip"].get<bool>()) {
+				auto geoffriel = entities.find("Geoffriel");
+				if (geoffriel.has_value() && !geoffriel->isRip()) {
 					if(distance(std::pair{getX(), getY()}, {-398, -1261.5}) > 10 && !isMoving()) {
 						move(-398, -1261.5);
 					}
@@ -345,12 +352,12 @@ public:
 					if (distance(CHAR_LOC, std::make_pair(KITING_ORIGIN_X, KITING_ORIGIN_Y)) < 200.0) {
 						auto monster = find_viable_target_ignore_fire();
 						if (monster.has_value()) {
-							const nlohmann::json& monster_entity = monster.value().get();
-							if (monster_entity["mtype"].get<std::string>() != "bscorpion") {
+							const EntityStore::Entity& monster_entity = monster.value();
+							if (monster_entity.getType() != "bscorpion") {
 								return;
 							}
-							double monster_x = monster_entity["x"].get<double>();
-							double monster_y = monster_entity["y"].get<double>();
+							double monster_x = monster_entity.getX();
+							double monster_y = monster_entity.getY();
 							bool kiting_clockwise = determine_clockwise(KITING_ORIGIN_X, KITING_ORIGIN_Y, monster_x, monster_y, KITING_RANGE);
 							auto [x, y] = get_kite_point(KITING_ORIGIN_X, KITING_ORIGIN_Y, monster_x, monster_y, KITING_RANGE, kiting_clockwise);
 							move(x, y);
@@ -384,5 +391,5 @@ extern "C" std::thread& init(CharacterGameInfo & info) {
 	BotInstance.reset(new BotImpl(info));
 
 	BotInstance->connect();
-	return BotInstance->uvThread;
+	return BotInstance->getThread();
 }
\ No newline at end of file
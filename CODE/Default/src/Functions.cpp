@@ -19,6 +19,13 @@ double Functions::distance(const nlohmann::json& A, const nlohmann::json& B) {
 	return NAN;
 };
 
+double Functions::distance(const nlohmann::json& A, const EntityStore::Entity& B) {
+	if(A.contains("x") && A.contains("y")) {
+		return std::hypot(A["x"].get<double>() - B.getX(), A["y"].get<double>() - B.getY());
+	}
+	return NAN;
+};
+
 double Functions::distance_squared(const nlohmann::json& A, const nlohmann::json& B) {
 	if(A.contains("x") && A.contains("y") && B.contains("x") && B.contains("y")) {
 		double dx = double(A["x"]) - double(B["x"]);
@@ -28,6 +35,22 @@ double Functions::distance_squared(const nlohmann::json& A, const nlohmann::json
 	return NAN;
 };
 
+double Functions::distance_squared(const nlohmann::json& A, const EntityStore::Entity& B) {
+	if(A.contains("x") && A.contains("y")) {
+		double dx = double(A["x"]) - B.getX();
+		double dy = double(A["y"]) - B.getY();
+		return dx * dx + dy * dy;
+	}
+	return NAN;
+};
+
+bool Functions::needs_hp(const EntityStore::Entity& entity) {
+	if(!entity.has(EntityRecord::HP) || !entity.has(EntityRecord::MAX_HP)) {
+		return false;
+	}
+	return double(entity.getHp()) / double(entity.getMaxHp()) < 0.75;
+}
+
 bool Functions::needs_hp(const nlohmann::json& entity) {
 	auto hp_it = entity.find("hp");
 	if(hp_it == entity.end()) {
@@ -2,11 +2,15 @@
 #define BOTIMPL_FUNCTIONS_HPP_
 
 #include <nlohmann/json.hpp>
+#include "albot/EntityStore.hpp"
 namespace Functions {
 	bool needs_mp(const nlohmann::json& entity);
 	bool needs_hp(const nlohmann::json& entity);
+	bool needs_hp(const EntityStore::Entity& entity);
 	double distance(const nlohmann::json& A, const nlohmann::json& B);
+	double distance(const nlohmann::json& A, const EntityStore::Entity& B);
 	double distance_squared(const nlohmann::json& A, const nlohmann::json& B);
+	double distance_squared(const nlohmann::json& A, const EntityStore::Entity& B);
 }
 
 #endif
\ No newline at end of file
@@ -45,16 +45,6 @@ SkillHelper::SkillHelper(const LightLoop& lightLoop, const LightSocket& lightSoc
 			clear_cooldown(place_it->get<std::string>());
 		}
 	});
-	socket.on("ping_ack", [this](const nlohmann::json& event) {
-		std::lock_guard<std::mutex> guard(skill_guard);
-		if (pings.size() > 63) {
-			ping_sum -= pings.front();
-			pings.erase(pings.begin());
-		}
-		const size_t& ping_time = pings.emplace_back((loop.now() - last_ping).count());
-		ping_sum += ping_time;
-		ping = ping_sum / pings.size();
-	});
 	socket.on("skill_timeout", [this](const nlohmann::json& event) {
 		auto name_it = event.find("name");
 		if (name_it == event.end()) {
@@ -77,11 +67,6 @@ SkillHelper::SkillHelper(const LightLoop& lightLoop, const LightSocket& lightSoc
 			set_cooldown("potion", 2000);
 		}
 	});
-	loop.setInterval([this]() {
-		std::lock_guard<std::mutex> guard(skill_guard);
-		last_ping = loop.now();
-		socket.emit("ping_trig", { "id", "pings" });
-	}, 4000);
 }
 
 bool SkillHelper::can_use(const std::string& name) const {
@@ -95,6 +80,7 @@ void SkillHelper::mark_used(const std::string& name) {
 }
 
 void SkillHelper::set_cooldown(std::string name, size_t millis) {
+	const size_t ping = socket.ping();
 	{
 		std::lock_guard<std::mutex> guard(skill_guard);
 		if(millis <= ping) {
@@ -124,47 +110,27 @@ inline void SkillHelper::clear_cooldown(const std::string& name) {
 	unusable.erase(name);
 }
 
-void SkillHelper::attempt_attack(const nlohmann::json& entity) {
-	auto id_it = entity.find("id");
-	if(id_it == entity.end()) {
-		return;
-	} else {
-		std::lock_guard<std::mutex> guard(skill_guard);
-		if (can_use_internal("attack")) {
-			mark_used_internal("attack");
-			socket.emit("attack", {
-				{"id", *id_it }
-			});
-		}
+void SkillHelper::attempt_attack(const EntityStore::Entity& entity) {
+	std::lock_guard<std::mutex> guard(skill_guard);
+	if (can_use_internal("attack")) {
+		mark_used_internal("attack");
+		socket.attack(entity.getId());
 	}
 }
 
-void SkillHelper::attempt_heal(const nlohmann::json& entity) {
-	auto id_it = entity.find("id");
-	if(id_it == entity.end()) {
-		return;
-	} else {
-		std::lock_guard<std::mutex> guard(skill_guard);
-		if (can_use_internal("attack")) {
-			mark_used_internal("attack");
-			socket.emit("heal", {
-				{"id", *id_it }
-			});
-		}
+void SkillHelper::attempt_heal(const EntityStore::Entity& entity) {
+	std::lock_guard<std::mutex> guard(skill_guard);
+	if (can_use_internal("attack")) {
+		mark_used_internal("attack");
+		socket.heal(entity.getId());
 	}
 }
 
-void SkillHelper::attempt_targeted(const std::string& skill, const nlohmann::json& entity) {
-	auto id_it = entity.find("id");
-	if(id_it != entity.end()) {
-		std::lock_guard<std::mutex> guard(skill_guard);
-		if (can_use_internal(skill)) {
-			mark_used_internal(skill);
-			socket.emit("skill", {
-				{ "name", skill },
-				{ "id", *id_it }
-			});
-		}
+void SkillHelper::attempt_targeted(const std::string& skill, const EntityStore::Entity& entity) {
+	std::lock_guard<std::mutex> guard(skill_guard);
+	if (can_use_internal(skill)) {
+		mark_used_internal(skill);
+		socket.skill(skill, entity.getId());
 	}
 }
 
@@ -172,9 +138,7 @@ void SkillHelper::attempt(const std::string& skill) {
 	std::lock_guard<std::mutex> guard(skill_guard);
 	if (can_use_internal(skill)) {
 		mark_used_internal(skill);
-		socket.emit("skill", {
-			{ "name", skill }
-		});
+		socket.skill(skill);
 	}
 }
 
@@ -189,7 +153,7 @@ void SkillHelper::attempt_use_mp_potion() {
 					std::string name = item["name"];
 					if (name.starts_with("mpot")) {
 							mark_used_internal("potion");
-							socket.emit("equip", { {"num", i} });
+							socket.equip(i);
 							break;
 					}
 				}
@@ -208,7 +172,7 @@ void SkillHelper::attempt_use_hp_potion() {
 					std::string name = item["name"];
 					if (name.starts_with("hpot")) {
 							mark_used_internal("potion");
-							socket.emit("equip", { {"num", i} });
+							socket.equip(i);
 							break;
 					}
 				}
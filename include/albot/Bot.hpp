@@ -31,12 +31,7 @@ class Bot {
 		virtual void connect() = 0;
 		virtual void disconnect() = 0;
 		virtual void stop() = 0;
-		
-		void updateCharacter(const nlohmann::json& patch) {
-			getUpdateCharacter().update(patch);
-		}
 
-		virtual nlohmann::json& getUpdateCharacter() = 0;
 		virtual nlohmann::json& getCharacter() = 0;
 		void setParty(const nlohmann::json& j);
 
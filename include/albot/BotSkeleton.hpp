@@ -4,27 +4,62 @@
 #include <atomic>
 
 #include "albot/SocketWrapper.hpp"
+#include "albot/Utils/Backoff.hpp"
 #include "albot/Utils/LoopHelper.hpp"
+#include "albot/Utils/Reactor.hpp"
 #include "albot/Utils/Timer.hpp"
 
 class BotSkeleton : public Bot {
 	protected:
     	Types::TimePoint last; 
-		void processInternals();
+		/**
+		 * @param now  The time to advance the world to. Only replays pass anything but the current time.
+		 */
+		void processInternals(Types::TimePoint now = Types::Clock::now());
+		void runDedicatedLoop();
+
+		enum ConnectionState : uint8_t {
+			CONNECTING,
+			CONNECTED,
+			// Lost the connection, the world is kept as it was until the new start merges into it.
+			RECONNECTING
+		};
+		std::atomic<ConnectionState> connectionState = CONNECTING;
+		// Set while disconnect() closes the socket, so the close it causes isn't taken for the server's.
+		std::atomic<bool> closing = false;
+		Types::TimePoint disconnectedAt;
+		// Loop thread only.
+		Backoff reconnectBackoff;
+		// Identifies the current attempt, so timeouts of earlier attempts do nothing.
+		size_t reconnectAttempt = 0;
+		/**
+		 * Waits out the next backoff delay, then reconnects. Runs on the loop.
+		 */
+		void scheduleReconnect();
 	public:
+		// How long a reconnection attempt gets to reach `start`, in milliseconds.
+		int reconnectTimeout = 5000;
 		BotSkeleton(const CharacterGameInfo& id);
 		LoopHelper loop;
 		SocketWrapper wrapper;
 		std::atomic<bool> running = true;
 		std::atomic<bool> loop_running = false;
+		// Not started when the bot runs on the shared Reactor.
 		std::thread uvThread;
+		/**
+		 * The thread running this bot's loop: uvThread, or the Reactor's thread, which every
+		 * bot on the reactor shares.
+		 */
+		std::thread& getThread();
 		void onDisconnect(std::string reason) override;
 		void onConnect() override;
+		bool isReconnecting() const {
+			return connectionState == RECONNECTING;
+		}
 		void connect() override;
 		void disconnect() override;
 		void stop() override;
 
-		nlohmann::json& getUpdateCharacter() override;
 		nlohmann::json& getCharacter() override;
 };
 
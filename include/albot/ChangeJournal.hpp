@@ -0,0 +1,135 @@
+#pragma once
+
+#ifndef ALBOT_CHANGEJOURNAL_HPP_
+#define ALBOT_CHANGEJOURNAL_HPP_
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Records which entities changed, and which of their fields (EntityRecord::Field bits), one
+ * generation at a time. The bot's loop closes a generation at the end of every tick.
+ *
+ * Bot code keeps the generation it last looked at, and asks for what changed since then
+ * instead of rescanning every entity:
+ *
+ *     journal.changedSince(seen, [](std::string_view id, uint32_t fields, bool removed) { ... });
+ *     seen = journal.getGeneration();
+ *
+ * Only changes made to the world count. Movement simulated between updates isn't journaled.
+ * Loop thread only.
+ */
+class ChangeJournal {
+	public:
+		struct Version {
+			// The generation the entity last changed in, 0 if it never did.
+			uint64_t generation = 0;
+			// The fields that changed in that generation.
+			uint32_t fields = 0;
+		};
+	private:
+		struct Entry {
+			uint64_t generation;
+			std::string id;
+			uint32_t fields;
+			bool removed;
+		};
+		std::deque<Entry> entries;
+		std::unordered_map<std::string, Version> versions;
+		uint64_t generation = 1;
+		uint64_t retainedGenerations;
+
+		uint64_t getOldestRetained() const {
+			return generation > retainedGenerations ? generation - retainedGenerations : 1;
+		}
+	public:
+		/**
+		 * @param retainedGenerations  How far back changedSince can answer. At 60 ticks a second,
+		 *                             the default covers two seconds.
+		 */
+		explicit ChangeJournal(uint64_t retainedGenerations = 120) : retainedGenerations(retainedGenerations) {}
+
+		/**
+		 * The generation changes are currently recorded in.
+		 */
+		uint64_t getGeneration() const {
+			return generation;
+		}
+
+		void record(const std::string& id, uint32_t fields) {
+			if (fields == 0) {
+				return;
+			}
+			Version& version = versions[id];
+			if (version.generation == generation) {
+				version.fields |= fields;
+			} else {
+				version = { generation, fields };
+			}
+			if (!entries.empty() && entries.back().generation == generation && entries.back().id == id && !entries.back().removed) {
+				entries.back().fields |= fields;
+				return;
+			}
+			entries.push_back({ generation, id, fields, false });
+		}
+		void remove(const std::string& id) {
+			versions.erase(id);
+			entries.push_back({ generation, id, 0, true });
+		}
+
+		/**
+		 * @returns  When the entity last changed, and what. {0, 0} for entities that don't exist.
+		 */
+		Version getVersion(const std::string& id) const {
+			auto it = versions.find(id);
+			return it == versions.end() ? Version() : it->second;
+		}
+
+		/**
+		 * Closes the current generation. Generations past the retention window are forgotten.
+		 */
+		void advance() {
+			generation++;
+			const uint64_t oldest = getOldestRetained();
+			while (!entries.empty() && entries.front().generation < oldest) {
+				entries.pop_front();
+			}
+		}
+
+		/**
+		 * Calls `callback(std::string_view id, uint32_t fields, bool removed)` once for every entity
+		 * changed in generation `since` or later, with every field that changed since then. `removed`
+		 * is set if the entity is gone now.
+		 *
+		 * @returns  false if `since` is older than the journal goes back. Nothing is reported,
+		 *           and the caller has to rescan the world.
+		 */
+		template <typename Callback>
+		bool changedSince(uint64_t since, Callback&& callback) const {
+			if (since < getOldestRetained()) {
+				return false;
+			}
+			struct Summary {
+				uint32_t fields = 0;
+				bool removed = false;
+			};
+			std::unordered_map<std::string_view, Summary> changes;
+			for (auto it = entries.rbegin(); it != entries.rend() && it->generation >= since; ++it) {
+				auto [slot, inserted] = changes.try_emplace(it->id);
+				// Walking backwards, the first entry seen for an id is its latest state.
+				if (inserted) {
+					slot->second.removed = it->removed;
+				}
+				slot->second.fields |= it->fields;
+			}
+			for (const auto& [id, summary] : changes) {
+				callback(id, summary.fields, summary.removed);
+			}
+			return true;
+		}
+};
+
+#endif /* ALBOT_CHANGEJOURNAL_HPP_ */
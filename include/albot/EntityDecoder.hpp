@@ -0,0 +1,168 @@
+#pragma once
+
+#ifndef ALBOT_ENTITYDECODER_HPP_
+#define ALBOT_ENTITYDECODER_HPP_
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "albot/GameTables.hpp"
+
+class GameData;
+class MonsterTable;
+
+/**
+ * A typed entity update, decoded straight from an `entities` payload.
+ * Only the fields flagged in `fields` were sent by the server. Anything the
+ * record doesn't model is kept in `extra`, keyed like the original JSON.
+ */
+struct EntityRecord {
+	enum Field : uint32_t {
+		X = 1 << 0,
+		Y = 1 << 1,
+		GOING_X = 1 << 2,
+		GOING_Y = 1 << 3,
+		SPEED = 1 << 4,
+		HP = 1 << 5,
+		MAX_HP = 1 << 6,
+		MP = 1 << 7,
+		MAX_MP = 1 << 8,
+		LEVEL = 1 << 9,
+		MOVE_NUM = 1 << 10,
+		MOVING = 1 << 11,
+		RIP = 1 << 12,
+		DEAD = 1 << 13,
+		TARGET = 1 << 14,
+		// mtype for monsters, ctype for characters.
+		TYPE = 1 << 15,
+		// in and map.
+		LOCATION = 1 << 16,
+		EXTRA = 1 << 17
+	};
+	enum Kind : uint8_t {
+		UNKNOWN_KIND,
+		CHARACTER,
+		MONSTER
+	};
+
+	std::string id;
+	Kind kind = UNKNOWN_KIND;
+	std::string type;
+	std::string in;
+	std::string map;
+	// Empty means the entity isn't targeting anything.
+	std::string target;
+	double x = 0;
+	double y = 0;
+	double going_x = 0;
+	double going_y = 0;
+	double speed = 0;
+	long hp = 0;
+	long max_hp = 0;
+	long mp = 0;
+	long max_mp = 0;
+	long level = 0;
+	long move_num = 0;
+	bool moving = false;
+	bool rip = false;
+	bool dead = false;
+	uint32_t fields = 0;
+	nlohmann::json extra;
+
+	bool has(Field field) const {
+		return (fields & field) != 0;
+	}
+
+	/**
+	 * Assigns a numeric or boolean field by its JSON key.
+	 *
+	 * @returns  false if the key doesn't have a typed field.
+	 */
+	bool setNumber(std::string_view key, double value);
+
+	/**
+	 * Fills in max_hp and hp for monsters that were sent without them.
+	 */
+	void fillDefaults(const MonsterTable& monsters);
+
+	/**
+	 * Overwrites the fields present in `other`, the same way json::update would.
+	 */
+	void merge(EntityRecord&& other);
+
+	/**
+	 * Writes the present fields into a JSON entity, in the shape the rest of the client expects.
+	 * Fields that already hold the same value are left alone.
+	 *
+	 * @returns  The fields whose value actually changed.
+	 */
+	uint32_t apply(nlohmann::json& entity) const;
+
+	/**
+	 * @returns  The field a JSON key is stored in, EXTRA for keys without a typed field.
+	 */
+	static uint32_t fieldOf(std::string_view key);
+};
+
+/**
+ * The monster stats the decoder needs for defaults, from the tables GameData builds out of
+ * G.monsters, so the socket thread doesn't walk the game data per entity.
+ */
+class MonsterTable {
+	private:
+		std::shared_ptr<const GameTables> tables;
+	public:
+		MonsterTable() = default;
+		explicit MonsterTable(const GameData* G);
+
+		/**
+		 * @returns  The monster type, or nullptr if G doesn't know it.
+		 */
+		const MonsterInfo* find(std::string_view mtype) const {
+			return tables == nullptr ? nullptr : tables->getMonsters().find(mtype);
+		}
+};
+
+struct EntityBatch {
+	// "all" replaces every known entity, "xy" only updates.
+	std::string type;
+	std::string in;
+	std::string map;
+	std::vector<EntityRecord> records;
+	// For wrapped payloads (start, new_map): every top level key except `entities`.
+	nlohmann::json rest;
+	// Set when the batch was for another map, and dropped.
+	bool wrongMap = false;
+
+	/**
+	 * Checks the batch against the expected map, and stamps every record with the batch location.
+	 * Called once the whole payload has been read, since the map may come after the entities.
+	 */
+	void finish(std::string_view expectedMap);
+};
+
+namespace EntityDecoder {
+	/**
+	 * Streams an `entities` payload into typed records without building a DOM.
+	 *
+	 * @param payload       The raw JSON of the event.
+	 * @param batch         Receives the records.
+	 * @param monsters      Used to fill in max_hp and hp for monsters.
+	 * @param expectedMap   If not empty, a batch for any other map is dropped.
+	 * @returns             false on a parse error.
+	 */
+	bool decodeEntities(std::string_view payload, EntityBatch& batch, const MonsterTable& monsters, std::string_view expectedMap = {});
+
+	/**
+	 * Same as decodeEntities, for payloads that carry the entities under an `entities` key
+	 * (start, new_map). Every other key is collected into `batch.rest`.
+	 */
+	bool decodeWrapped(std::string_view payload, EntityBatch& batch, const MonsterTable& monsters);
+}
+
+#endif /* ALBOT_ENTITYDECODER_HPP_ */
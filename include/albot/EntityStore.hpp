@@ -0,0 +1,457 @@
+#pragma once
+
+#ifndef ALBOT_ENTITYSTORE_HPP_
+#define ALBOT_ENTITYSTORE_HPP_
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "albot/EntityDecoder.hpp"
+#include "albot/SpatialGrid.hpp"
+#include "albot/Utils/FlatHashMap.hpp"
+
+/**
+ * Every entity around the character, stored column by column: one vector per field, and one row
+ * per entity. Walking a column (every x, every hp) touches contiguous memory, and an entity costs
+ * a few hundred bytes instead of a tree of string keys. Fields the client doesn't model are kept
+ * per entity as JSON, see Entity::getExtra.
+ *
+ * Movement isn't stepped every tick. A moving entity keeps the segment it's on: where and when it
+ * started, its velocity and when it arrives. Its position is worked out when something reads it,
+ * see positionAt, so entities nobody looks at cost nothing between updates.
+ *
+ * Entities are also indexed by position, per map, for range queries (queryRadius, queryRect, nearestK).
+ *
+ * Rows aren't stable: erasing one moves the last row into its place. To hold on to an entity
+ * across ticks, keep its Handle.
+ * Owned by the bot's loop, like the rest of the world.
+ */
+class EntityStore {
+	public:
+		static constexpr size_t npos = size_t(-1);
+
+		/**
+		 * Names an entity for as long as it stays in the store. Cheap to copy and to keep.
+		 *
+		 * The low bits pick a slot, the high bits hold the slot's generation. Erasing the entity bumps
+		 * the generation, so an old handle stops resolving instead of finding whoever reused the slot.
+		 * A slot is retired before its generation wraps, so that never happens to an old handle either.
+		 * The default handle never resolves.
+		 */
+		class Handle {
+			private:
+				uint32_t value = 0;
+			public:
+				static constexpr uint32_t SLOT_BITS = 20;
+				static constexpr uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1;
+				static constexpr uint32_t GENERATION_MASK = (1u << (32 - SLOT_BITS)) - 1;
+
+				Handle() = default;
+				Handle(uint32_t slot, uint32_t generation) : value((generation << SLOT_BITS) | slot) {}
+
+				uint32_t getSlot() const {
+					return value & SLOT_MASK;
+				}
+				uint32_t getGeneration() const {
+					return value >> SLOT_BITS;
+				}
+				uint32_t getValue() const {
+					return value;
+				}
+				/**
+				 * Whether it was ever assigned. Only EntityStore::resolve says if it's still alive.
+				 */
+				bool isSet() const {
+					return value != 0;
+				}
+				bool operator==(const Handle& other) const = default;
+		};
+
+		enum Flag : uint32_t {
+			MOVING = 1 << 0,
+			RIP = 1 << 1,
+			DEAD = 1 << 2,
+			// The entity is on a segment: its velocity and arrival time are set, see engage.
+			ENGAGED = 1 << 3,
+			// The server's "amoving": the entity keeps moving once it gets where it was going.
+			AMOVING = 1 << 4
+		};
+
+		// How often, in milliseconds of advance, positions are written back and the grid catches up.
+		static constexpr double SETTLE_INTERVAL = 250.0;
+
+		/**
+		 * A read-only view of one row. Only valid until the store is modified.
+		 */
+		class Entity {
+			private:
+				const EntityStore* store;
+				size_t row;
+			public:
+				Entity(const EntityStore& store, size_t row) : store(&store), row(row) {}
+
+				size_t getRow() const {
+					return row;
+				}
+				Handle getHandle() const {
+					return store->handles[row];
+				}
+				const std::string& getId() const {
+					return store->ids[row];
+				}
+				EntityRecord::Kind getKind() const {
+					return store->kinds[row];
+				}
+				bool isMonster() const {
+					return getKind() == EntityRecord::MONSTER;
+				}
+				bool isCharacter() const {
+					return getKind() == EntityRecord::CHARACTER;
+				}
+				/**
+				 * mtype for monsters, ctype for characters.
+				 */
+				const std::string& getType() const {
+					return store->types[row];
+				}
+				const std::string& getMap() const {
+					return store->maps[row];
+				}
+				const std::string& getIn() const {
+					return store->ins[row];
+				}
+				/**
+				 * Empty if the entity isn't targeting anything.
+				 */
+				const std::string& getTarget() const {
+					return store->targets[row];
+				}
+				/**
+				 * Where the entity is now, as of the last advance.
+				 */
+				double getX() const {
+					return store->positionAt(row, store->clock).first;
+				}
+				double getY() const {
+					return store->positionAt(row, store->clock).second;
+				}
+				/**
+				 * Where the entity is at `time`, on the store's clock, assuming it stays on its current segment.
+				 */
+				std::pair<double, double> positionAt(double time) const {
+					return store->positionAt(row, time);
+				}
+				double getGoingX() const {
+					return store->goingX[row];
+				}
+				double getGoingY() const {
+					return store->goingY[row];
+				}
+				double getSpeed() const {
+					return store->speed[row];
+				}
+				long getHp() const {
+					return store->hp[row];
+				}
+				long getMaxHp() const {
+					return store->maxHp[row];
+				}
+				long getMp() const {
+					return store->mp[row];
+				}
+				long getMaxMp() const {
+					return store->maxMp[row];
+				}
+				long getLevel() const {
+					return store->level[row];
+				}
+				/**
+				 * Whether the server ever sent the field for this entity.
+				 */
+				bool has(EntityRecord::Field field) const {
+					return (store->fields[row] & field) != 0;
+				}
+				bool isMoving() const {
+					return store->isMovingAt(row, store->clock);
+				}
+				bool isRip() const {
+					return (store->flags[row] & RIP) != 0;
+				}
+				bool isDead() const {
+					return (store->flags[row] & DEAD) != 0;
+				}
+				/**
+				 * The conditions on the entity (`s`), an object keyed by condition name. Null if there are none.
+				 */
+				const nlohmann::json& getStatus() const {
+					return store->statuses[row];
+				}
+				/**
+				 * Everything else the server sent, keyed like the original JSON. Null if there's nothing.
+				 */
+				const nlohmann::json& getExtra() const {
+					return store->extras[row];
+				}
+				/**
+				 * The entity in the JSON shape it used to be stored in.
+				 */
+				nlohmann::json toJson() const {
+					return store->toJson(row);
+				}
+		};
+
+		class Iterator {
+			private:
+				const EntityStore* store;
+				size_t row;
+			public:
+				Iterator(const EntityStore& store, size_t row) : store(&store), row(row) {}
+				Entity operator*() const {
+					return Entity(*store, row);
+				}
+				Iterator& operator++() {
+					row++;
+					return *this;
+				}
+				bool operator!=(const Iterator& other) const {
+					return row != other.row;
+				}
+				bool operator==(const Iterator& other) const {
+					return row == other.row;
+				}
+		};
+
+	private:
+		std::vector<std::string> ids;
+		std::vector<EntityRecord::Kind> kinds;
+		std::vector<std::string> types;
+		std::vector<std::string> ins;
+		std::vector<std::string> maps;
+		std::vector<std::string> targets;
+		// Where the entity was at movedAt. Current for entities that aren't moving.
+		std::vector<double> x;
+		std::vector<double> y;
+		std::vector<double> goingX;
+		std::vector<double> goingY;
+		std::vector<double> fromX;
+		std::vector<double> fromY;
+		std::vector<double> vx;
+		std::vector<double> vy;
+		std::vector<double> speed;
+		// On the store's clock, like arriveAt.
+		std::vector<double> movedAt;
+		std::vector<double> arriveAt;
+		std::vector<long> hp;
+		std::vector<long> maxHp;
+		std::vector<long> mp;
+		std::vector<long> maxMp;
+		std::vector<long> level;
+		std::vector<long> moveNum;
+		// EntityRecord::Field bits the server has sent for the entity.
+		std::vector<uint32_t> fields;
+		std::vector<uint32_t> flags;
+		std::vector<nlohmann::json> statuses;
+		std::vector<nlohmann::json> extras;
+		std::vector<Handle> handles;
+		// Scratch space for advance, see MovementKernel::Columns::arrived.
+		std::vector<uint8_t> arrivals;
+
+		struct Slot {
+			// npos while the slot is free.
+			size_t row = npos;
+			// Starts at 1, so no live handle is ever 0.
+			uint32_t generation = 1;
+		};
+		std::vector<Slot> slots;
+		// Reused oldest first, which spreads reuse over every free slot instead of cycling one.
+		std::deque<uint32_t> freeSlots;
+		// id -> slot
+		FlatHashMap<std::string, uint32_t, std::hash<std::string_view>> index;
+
+		// Holds slots, which unlike rows don't move.
+		SpatialGrid grid;
+		std::vector<SpatialGrid::CellKey> cellKeys;
+		// Map names are interned, the id is part of the cell key. Never shrinks, there are only so many maps.
+		FlatHashMap<std::string, uint32_t, std::hash<std::string_view>> mapIds;
+		std::vector<size_t> mapPopulation;
+
+		// Milliseconds of advance since the store was created.
+		double clock = 0;
+		// When positions were last written back, the grid is at most this far behind.
+		double settledAt = 0;
+		// The fastest entity that has moved since then, to bound how far the grid can be off.
+		double maxSpeed = 0;
+
+		size_t insert(const std::string& id);
+		void release(uint32_t slot);
+		uint32_t internMap(const std::string& map);
+		/**
+		 * @returns  The interned id of the map, or npos if no entity was ever on it.
+		 */
+		size_t findMap(std::string_view map) const;
+		/**
+		 * Puts the row into the cell for its current map and position.
+		 */
+		void regrid(size_t row, uint32_t map);
+		/**
+		 * Starts the entity on a segment from where it is now to where it's going.
+		 */
+		void engage(size_t row);
+		/**
+		 * Writes the entity's current position back into x and y.
+		 */
+		void materialize(size_t row);
+		/**
+		 * Materializes every moving entity at once, stops the ones that arrived and moves them
+		 * on the grid.
+		 */
+		void settle();
+		/**
+		 * How far an entity may have moved away from its place on the grid.
+		 */
+		double getDrift() const {
+			return maxSpeed * (clock - settledAt) / 1000.0;
+		}
+	public:
+		size_t size() const {
+			return ids.size();
+		}
+		bool empty() const {
+			return ids.empty();
+		}
+		Iterator begin() const {
+			return Iterator(*this, 0);
+		}
+		Iterator end() const {
+			return Iterator(*this, size());
+		}
+		Entity operator[](size_t row) const {
+			return Entity(*this, row);
+		}
+
+		/**
+		 * @returns  The row of the entity, or npos.
+		 */
+		size_t indexOf(std::string_view id) const {
+			const uint32_t* slot = index.find(id);
+			return slot == nullptr ? npos : slots[*slot].row;
+		}
+		bool contains(std::string_view id) const {
+			return index.contains(id);
+		}
+		std::optional<Entity> find(std::string_view id) const {
+			size_t row = indexOf(id);
+			if (row == npos) {
+				return std::nullopt;
+			}
+			return Entity(*this, row);
+		}
+
+		/**
+		 * @returns  The handle of the entity, or an unset one if it isn't here.
+		 */
+		Handle handleOf(std::string_view id) const {
+			size_t row = indexOf(id);
+			return row == npos ? Handle() : handles[row];
+		}
+		/**
+		 * @returns  The row the handle points to, or npos if the entity is gone.
+		 */
+		size_t rowOf(Handle handle) const {
+			const uint32_t slot = handle.getSlot();
+			if (!handle.isSet() || slot >= slots.size() || slots[slot].generation != handle.getGeneration()) {
+				return npos;
+			}
+			return slots[slot].row;
+		}
+		bool isAlive(Handle handle) const {
+			return rowOf(handle) != npos;
+		}
+		std::optional<Entity> resolve(Handle handle) const {
+			size_t row = rowOf(handle);
+			if (row == npos) {
+				return std::nullopt;
+			}
+			return Entity(*this, row);
+		}
+
+		/**
+		 * Writes the fields present in the record into the entity, adding it if it's new.
+		 * Fields that already hold the same value are left alone.
+		 *
+		 * @returns  The fields whose value actually changed, like EntityRecord::apply.
+		 */
+		uint32_t apply(const EntityRecord& record);
+		/**
+		 * Same as above, for an entity already in the store.
+		 */
+		uint32_t apply(size_t row, const EntityRecord& record);
+		/**
+		 * Sets the speed of an entity the server didn't send one for.
+		 */
+		void setDefaultSpeed(size_t row, double value);
+		/**
+		 * Removes the row. The last row takes its place. Handles to the entity stop resolving.
+		 */
+		void erase(size_t row);
+		void clear();
+
+		double getClock() const {
+			return clock;
+		}
+		std::pair<double, double> positionAt(size_t row, double time) const {
+			if ((flags[row] & (MOVING | RIP | DEAD | ENGAGED)) != (MOVING | ENGAGED)) {
+				return { x[row], y[row] };
+			}
+			if (time >= arriveAt[row]) {
+				return { goingX[row], goingY[row] };
+			}
+			// Same order of operations as MovementMath::moveEntity.
+			const double elapsed = time - movedAt[row];
+			return { x[row] + vx[row] * elapsed / 1000.0, y[row] + vy[row] * elapsed / 1000.0 };
+		}
+		bool isMovingAt(size_t row, double time) const {
+			const uint32_t flag = flags[row];
+			if ((flag & MOVING) == 0) {
+				return false;
+			}
+			return (flag & (AMOVING | ENGAGED)) != ENGAGED || time < arriveAt[row];
+		}
+
+		/**
+		 * Moves the store's clock `delta` milliseconds ahead. Positions follow without being touched;
+		 * every SETTLE_INTERVAL they're written back in bulk by MovementKernel, and entities that
+		 * arrived stop. Rip and dead entities stay where they are.
+		 */
+		void advance(double delta);
+
+		nlohmann::json toJson(size_t row) const;
+
+		/**
+		 * Entities on the map in the rectangle, borders included, in no particular order.
+		 */
+		std::vector<Entity> queryRect(std::string_view map, double minX, double minY, double maxX, double maxY) const;
+		/**
+		 * Entities on the map at most `radius` away from x, y, in no particular order.
+		 */
+		std::vector<Entity> queryRadius(std::string_view map, double x, double y, double radius) const;
+		/**
+		 * The `k` entities on the map closest to x, y, closest first.
+		 */
+		std::vector<Entity> nearestK(std::string_view map, double x, double y, size_t k) const;
+		/**
+		 * Rows of entities that aren't strictly inside the rectangle on the map, highest row first,
+		 * so they can be erased in that order. Cells wholly inside are skipped without looking at
+		 * their entities.
+		 */
+		std::vector<size_t> rowsOutside(std::string_view map, double minX, double minY, double maxX, double maxY) const;
+};
+
+#endif /* ALBOT_ENTITYSTORE_HPP_ */
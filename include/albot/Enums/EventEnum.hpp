@@ -0,0 +1,160 @@
+#pragma once
+
+#ifndef EVENT_ENUM_HPP_
+#define EVENT_ENUM_HPP_
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace EventEnum {
+	/**
+	 * Dense ids for the events Adventure Land (and the socket itself) is known to send.
+	 * Names registered at runtime that aren't in this list are interned by the socket
+	 * with ids starting at KNOWN_EVENT_COUNT.
+	 */
+	enum EVENT : uint16_t {
+		// Socket level
+		CONNECT,
+		DISCONNECT,
+		PING,
+		PONG,
+		UPGRADE,
+		NOOP,
+		MESSAGE,
+		ERROR,
+		// Loading
+		WELCOME,
+		START,
+		ENTITIES,
+		NEW_MAP,
+		// Gameplay
+		PLAYER,
+		DEATH,
+		DISAPPEAR,
+		NOTTHERE,
+		DROP,
+		CHEST_OPENED,
+		CORRECTION,
+		HIT,
+		GAME_RESPONSE,
+		GAME_ERROR,
+		GAME_LOG,
+		GAME_EVENT,
+		SKILL_TIMEOUT,
+		PING_ACK,
+		EVAL,
+		UI,
+		UPGRADE_RESULT,
+		Q_DATA,
+		TRACKER,
+		EMOTION,
+		MAGIPORT,
+		// Social
+		CM,
+		PM,
+		CHAT_LOG,
+		INVITE,
+		REQUEST,
+		PARTY_UPDATE,
+		FRIEND,
+		ONLINE,
+		// Server
+		SERVER_INFO,
+		SERVER_MESSAGE,
+		DISCONNECT_REASON,
+		ACHIEVEMENT_PROGRESS,
+		LIMITDCREPORT,
+		SECONDHANDS,
+		LOSTANDFOUND,
+		KNOWN_EVENT_COUNT,
+		UNKNOWN = 0xFFFF
+	};
+
+	inline constexpr std::array<std::string_view, KNOWN_EVENT_COUNT> NAMES = {
+		"connect", "disconnect", "ping", "pong", "upgrade", "noop", "message", "error",
+		"welcome", "start", "entities", "new_map",
+		"player", "death", "disappear", "notthere", "drop", "chest_opened", "correction", "hit",
+		"game_response", "game_error", "game_log", "game_event", "skill_timeout", "ping_ack", "eval", "ui",
+		"upgrade_result", "q_data", "tracker", "emotion", "magiport",
+		"cm", "pm", "chat_log", "invite", "request", "party_update", "friend", "online",
+		"server_info", "server_message", "disconnect_reason", "achievement_progress", "limitdcreport",
+		"secondhands", "lostandfound"
+	};
+
+	namespace detail {
+		inline constexpr size_t TABLE_SIZE = 256;
+
+		constexpr uint32_t hash(std::string_view name, uint32_t seed) {
+			// FNV-1a, seeded.
+			uint32_t h = 2166136261u ^ seed;
+			for (char c : name) {
+				h ^= uint8_t(c);
+				h *= 16777619u;
+			}
+			return h ^ (h >> 15);
+		}
+
+		constexpr bool is_perfect(uint32_t seed) {
+			std::array<bool, TABLE_SIZE> used = {};
+			for (std::string_view name : NAMES) {
+				size_t slot = hash(name, seed) % TABLE_SIZE;
+				if (used[slot]) {
+					return false;
+				}
+				used[slot] = true;
+			}
+			return true;
+		}
+
+		constexpr uint32_t find_seed() {
+			uint32_t seed = 0;
+			while (!is_perfect(seed)) {
+				seed++;
+			}
+			return seed;
+		}
+
+		inline constexpr uint32_t SEED = find_seed();
+
+		constexpr std::array<uint8_t, TABLE_SIZE> build_table() {
+			std::array<uint8_t, TABLE_SIZE> table = {};
+			for (size_t i = 0; i < TABLE_SIZE; i++) {
+				table[i] = 0xFF;
+			}
+			for (size_t i = 0; i < NAMES.size(); i++) {
+				table[hash(NAMES[i], SEED) % TABLE_SIZE] = uint8_t(i);
+			}
+			return table;
+		}
+
+		inline constexpr std::array<uint8_t, TABLE_SIZE> TABLE = build_table();
+		static_assert(KNOWN_EVENT_COUNT < 0xFF, "Event ids must fit in the perfect hash table.");
+	}
+
+	/**
+	 * Looks up a known event by name: one hash and one comparison, no allocation.
+	 *
+	 * @returns  The event id, or UNKNOWN if the name isn't a known event.
+	 */
+	constexpr EVENT getEventId(std::string_view name) {
+		uint8_t id = detail::TABLE[detail::hash(name, detail::SEED) % detail::TABLE_SIZE];
+		if (id != 0xFF && NAMES[id] == name) {
+			return EVENT(id);
+		}
+		return UNKNOWN;
+	}
+
+	constexpr std::string_view getEventName(EVENT event) {
+		if (event < KNOWN_EVENT_COUNT) {
+			return NAMES[event];
+		}
+		return "unknown";
+	}
+
+	static_assert(getEventId("entities") == ENTITIES);
+	static_assert(getEventId("lostandfound") == LOSTANDFOUND);
+	static_assert(getEventId("not_an_event") == UNKNOWN);
+}
+
+#endif /* EVENT_ENUM_HPP_ */
@@ -0,0 +1,197 @@
+#pragma once
+
+#ifndef ALBOT_GAMEDATACACHE_HPP_
+#define ALBOT_GAMEDATACACHE_HPP_
+
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "albot/GameTables.hpp"
+
+/**
+ * G after processing, written once per game version as flat binary sections, so later starts
+ * can map the file read-only instead of parsing data.json. The typed tables and the simplified
+ * geometry are read straight out of the mapping, and G itself is kept as MessagePack for code
+ * that still wants the JSON.
+ *
+ * The mapping is shared, so every process started from the same directory reads the same pages.
+ * The file is only ever replaced by renaming a new one over it, never rewritten in place.
+ */
+class GameDataCache {
+	public:
+		// Bumped whenever the layout below changes. Files of another format are ignored.
+		static constexpr uint32_t FORMAT = 1;
+
+		enum Section : uint32_t {
+			// G as MessagePack.
+			DOCUMENT,
+			// Every string the records point into, back to back.
+			STRINGS,
+			MONSTERS,
+			SKILLS,
+			ITEMS,
+			MAPS,
+			LINES,
+			SPAWNS,
+			SECTION_COUNT
+		};
+
+		struct StringRef {
+			uint32_t offset;
+			uint32_t length;
+		};
+		struct SectionRef {
+			uint64_t offset;
+			uint64_t size;
+		};
+		struct Header {
+			char magic[8];
+			uint32_t format;
+			// 0x01020304 as written, so a file from a machine of the other byte order is rejected.
+			uint32_t byteOrder;
+			int64_t version;
+			uint64_t size;
+			SectionRef sections[SECTION_COUNT];
+		};
+
+		struct MonsterRecord {
+			StringRef name;
+			StringRef damageType;
+			int64_t hp;
+			int64_t attack;
+			int64_t xp;
+			int64_t armor;
+			int64_t resistance;
+			double speed;
+			double range;
+			double frequency;
+		};
+		struct SkillRecord {
+			StringRef name;
+			StringRef share;
+			StringRef type;
+			double cooldown;
+			double range;
+			int64_t mp;
+		};
+		struct ItemRecord {
+			StringRef name;
+			StringRef type;
+			StringRef slot;
+			int64_t value;
+			int64_t tier;
+			// In the order of ItemStats.
+			int64_t stats[11];
+		};
+
+		// The same three shorts as MapProcessing::AxisLineSegment.
+		struct Line {
+			int16_t axis;
+			int16_t rangeStart;
+			int16_t rangeEnd;
+		};
+		struct Spawn {
+			double x;
+			double y;
+		};
+		struct MapRecord {
+			StringRef name;
+			double minX;
+			double minY;
+			double maxX;
+			double maxY;
+			// Indices into LINES and SPAWNS.
+			uint32_t xLines;
+			uint32_t xLineCount;
+			uint32_t yLines;
+			uint32_t yLineCount;
+			uint32_t spawns;
+			uint32_t spawnCount;
+		};
+		struct MapGeometry {
+			std::string_view name;
+			double minX;
+			double minY;
+			double maxX;
+			double maxY;
+			std::span<const Line> xLines;
+			std::span<const Line> yLines;
+			std::span<const Spawn> spawns;
+		};
+	private:
+		const uint8_t* base = nullptr;
+		size_t length = 0;
+
+		GameDataCache(const uint8_t* base, size_t length) : base(base), length(length) {}
+
+		const Header& header() const {
+			return *reinterpret_cast<const Header*>(base);
+		}
+		template <typename Record>
+		std::span<const Record> records(Section section) const {
+			const SectionRef& ref = header().sections[section];
+			return { reinterpret_cast<const Record*>(base + ref.offset), size_t(ref.size / sizeof(Record)) };
+		}
+		std::string_view string(StringRef ref) const {
+			const SectionRef& strings = header().sections[STRINGS];
+			if (uint64_t(ref.offset) + ref.length > strings.size) {
+				return {};
+			}
+			return { reinterpret_cast<const char*>(base + strings.offset + ref.offset), ref.length };
+		}
+	public:
+		GameDataCache(const GameDataCache&) = delete;
+		GameDataCache& operator=(const GameDataCache&) = delete;
+		~GameDataCache();
+
+		/**
+		 * Maps the cache at `path` read-only.
+		 *
+		 * @returns  The cache, or nullptr if there's no file, it's for another game version or format,
+		 *           or it's damaged.
+		 */
+		static std::shared_ptr<const GameDataCache> open(const std::string& path, int64_t version);
+		/**
+		 * Writes G, which handleGameJson has already been over, as the cache for `version`. Writes a
+		 * temporary file next to `path` and renames it over, so processes that have the old one
+		 * mapped keep reading it undisturbed.
+		 *
+		 * @returns  false if the file couldn't be written.
+		 */
+		static bool write(const std::string& path, int64_t version, const nlohmann::json& G);
+
+		int64_t getVersion() const {
+			return header().version;
+		}
+		size_t getSize() const {
+			return length;
+		}
+		/**
+		 * @returns  G as MessagePack, see nlohmann::json::from_msgpack.
+		 */
+		std::span<const uint8_t> getDocument() const {
+			return records<uint8_t>(DOCUMENT);
+		}
+		/**
+		 * Copies the monster, skill and item records into GameTables. A few thousand fixed size
+		 * records, without touching the document.
+		 */
+		GameTables loadTables() const;
+
+		size_t getMapCount() const {
+			return records<MapRecord>(MAPS).size();
+		}
+		MapGeometry getMap(size_t index) const;
+		/**
+		 * @returns  Whether the map has geometry, and if so fills `geometry` in.
+		 */
+		bool findMap(std::string_view name, MapGeometry& geometry) const;
+};
+
+#endif /* ALBOT_GAMEDATACACHE_HPP_ */
@@ -0,0 +1,120 @@
+#pragma once
+
+#ifndef ALBOT_GAMEEVENTS_HPP_
+#define ALBOT_GAMEEVENTS_HPP_
+
+#include <string>
+#include <string_view>
+
+#include "albot/Enums/EventEnum.hpp"
+
+/**
+ * Typed payloads of known events, for SocketWrapper::registerEventCallback<Event>. They're read
+ * straight out of the frame, without a JSON DOM: every view points into the frame, or into a
+ * scratch buffer the callback owns, so an event is only valid for the duration of its callback.
+ * Copy what has to outlive it. Fields the server leaves out are empty.
+ */
+namespace GameEvents {
+	struct Cm {
+		// The character that sent it.
+		std::string_view name;
+		// Whatever the sender passed, as raw JSON text.
+		std::string_view message;
+	};
+	struct Pm {
+		std::string_view owner;
+		std::string_view to;
+		std::string_view message;
+	};
+	struct ChatLog {
+		std::string_view owner;
+		std::string_view message;
+		// The owner's entity id, empty for server messages.
+		std::string_view id;
+	};
+	struct PartyInvite {
+		std::string_view name;
+	};
+	struct PartyRequest {
+		std::string_view name;
+	};
+	struct Disappear {
+		std::string_view id;
+		// "transport", "disconnect"... Empty for entities that simply left range.
+		std::string_view reason;
+	};
+	struct Death {
+		std::string_view id;
+	};
+
+	/**
+	 * Walks the top-level members of a JSON object in place.
+	 *
+	 * String values come back unescaped: as views into the object, or into `scratch` when they had
+	 * escape sequences. `scratch` is reserved to the size of the object up front, so the views into
+	 * it stay put, and once it has grown to the largest payload seen it stops allocating.
+	 */
+	class FieldReader {
+		private:
+			std::string_view json;
+			std::string& scratch;
+			size_t pos = 0;
+			bool valid = false;
+			std::string_view raw;
+
+			bool readString(std::string_view& value);
+			bool skipValue();
+		public:
+			FieldReader(std::string_view object, std::string& scratch);
+
+			/**
+			 * @param isString  Set if the value was a string, which `value` then holds unescaped.
+			 *                  Otherwise `value` is the raw JSON text.
+			 * @returns         false once there are no more members, or the object turned out to be malformed.
+			 */
+			bool next(std::string_view& key, std::string_view& value, bool& isString);
+			/**
+			 * @returns  The last value next() read, as raw JSON text: strings with their quotes and escapes.
+			 */
+			std::string_view getRaw() const {
+				return raw;
+			}
+			/**
+			 * @returns  false if the payload wasn't an object, or something in it was malformed.
+			 */
+			bool isValid() const {
+				return valid;
+			}
+	};
+
+	/**
+	 * Fill in the event from its payload.
+	 *
+	 * @returns  false if the payload isn't a JSON object.
+	 */
+	bool read(std::string_view payload, std::string& scratch, Cm& event);
+	bool read(std::string_view payload, std::string& scratch, Pm& event);
+	bool read(std::string_view payload, std::string& scratch, ChatLog& event);
+	bool read(std::string_view payload, std::string& scratch, PartyInvite& event);
+	bool read(std::string_view payload, std::string& scratch, PartyRequest& event);
+	bool read(std::string_view payload, std::string& scratch, Disappear& event);
+	bool read(std::string_view payload, std::string& scratch, Death& event);
+
+	/**
+	 * The payload type of an event. Only the events below have one, registering a typed callback
+	 * for any other is a compile error.
+	 */
+	template <EventEnum::EVENT Event>
+	struct Payload;
+
+	template <> struct Payload<EventEnum::CM> { typedef Cm type; };
+	template <> struct Payload<EventEnum::PM> { typedef Pm type; };
+	template <> struct Payload<EventEnum::CHAT_LOG> { typedef ChatLog type; };
+	template <> struct Payload<EventEnum::INVITE> { typedef PartyInvite type; };
+	template <> struct Payload<EventEnum::REQUEST> { typedef PartyRequest type; };
+	template <> struct Payload<EventEnum::DISAPPEAR> { typedef Disappear type; };
+	template <> struct Payload<EventEnum::NOTTHERE> { typedef Disappear type; };
+	template <> struct Payload<EventEnum::DEATH> { typedef Death type; };
+}
+
+#endif /* ALBOT_GAMEEVENTS_HPP_ */
@@ -30,6 +30,14 @@ struct CharacterGameInfo {
 	GameData *G;
 	std::string auth;
 	std::string userId;
+	// Run the bot loop on the process-wide Reactor instead of a thread of its own.
+	bool sharedReactor = false;
+	// Offer permessage-deflate on the game socket.
+	bool compression = true;
+	// If set, every raw frame of the game socket is recorded here, see WireCapture.
+	std::string capturePath;
+	// Where the game socket connects, instead of the default game server. Used to point bots at a stand-in.
+	std::string socketUrl;
 };
 
 #endif /* ALBOT_GAMEINFO_HPP_ */
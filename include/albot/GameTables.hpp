@@ -0,0 +1,223 @@
+#pragma once
+
+#ifndef ALBOT_GAMETABLES_HPP_
+#define ALBOT_GAMETABLES_HPP_
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "albot/Utils/FlatHashMap.hpp"
+
+struct MonsterInfo {
+	std::string name;
+	long hp = 0;
+	double speed = 0;
+	double range = 0;
+	long attack = 0;
+	long xp = 0;
+	long armor = 0;
+	long resistance = 0;
+	// Attacks per second.
+	double frequency = 0;
+	// "physical", "magical" or "pure".
+	std::string damageType;
+};
+
+struct SkillInfo {
+	std::string name;
+	// In milliseconds, 0 for skills without one.
+	double cooldown = 0;
+	long mp = 0;
+	double range = 0;
+	// The skill whose cooldown this one shares, if any.
+	std::string share;
+	// "skill", "ability", "passive"...
+	std::string type;
+};
+
+struct ItemStats {
+	long attack = 0;
+	long armor = 0;
+	long resistance = 0;
+	long hp = 0;
+	long mp = 0;
+	long speed = 0;
+	long str = 0;
+	long intelligence = 0;
+	long dex = 0;
+	long vit = 0;
+	long crit = 0;
+};
+
+struct ItemInfo {
+	std::string name;
+	std::string type;
+	// Where it's equipped: "mainhand", "offhand", "helmet"... "ring" and "earring" fit either of
+	// the two slots. Empty for things that can't be equipped.
+	std::string slot;
+	// Gold value.
+	long value = 0;
+	long tier = 0;
+	// At level 0.
+	ItemStats stats;
+};
+
+/**
+ * One kind of game data (monsters, skills, items), as rows of a typed struct. Every name is
+ * interned into a dense id, so hot code can look a name up once and index by id afterwards.
+ */
+template <typename Info>
+class GameTable {
+	private:
+		std::vector<Info> rows;
+		FlatHashMap<std::string, uint32_t, std::hash<std::string_view>> ids;
+	public:
+		static constexpr uint32_t npos = ~uint32_t(0);
+
+		uint32_t add(Info info) {
+			const uint32_t id = uint32_t(rows.size());
+			ids.insert(info.name, id);
+			rows.push_back(std::move(info));
+			return id;
+		}
+
+		size_t size() const {
+			return rows.size();
+		}
+		typename std::vector<Info>::const_iterator begin() const {
+			return rows.begin();
+		}
+		typename std::vector<Info>::const_iterator end() const {
+			return rows.end();
+		}
+
+		/**
+		 * @returns  The id of the name, or npos.
+		 */
+		uint32_t idOf(std::string_view name) const {
+			const uint32_t* id = ids.find(name);
+			return id == nullptr ? npos : *id;
+		}
+		const Info& operator[](uint32_t id) const {
+			return rows[id];
+		}
+		/**
+		 * @returns  The row for the name, or nullptr if G doesn't have it.
+		 */
+		const Info* find(std::string_view name) const {
+			const uint32_t* id = ids.find(name);
+			return id == nullptr ? nullptr : &rows[*id];
+		}
+};
+
+/**
+ * The parts of G that bot code reads all the time, pulled out of the JSON once when the game data
+ * is loaded. See GameData::getTables.
+ */
+class GameTables {
+	private:
+		GameTable<MonsterInfo> monsters;
+		GameTable<SkillInfo> skills;
+		GameTable<ItemInfo> items;
+
+		static double number(const nlohmann::json& object, const char* key) {
+			auto it = object.find(key);
+			return it != object.end() && it->is_number() ? it->get<double>() : 0.0;
+		}
+		static std::string string(const nlohmann::json& object, const char* key) {
+			auto it = object.find(key);
+			return it != object.end() && it->is_string() ? it->get<std::string>() : std::string();
+		}
+		static std::string slotOf(const std::string& type) {
+			if (type == "weapon") {
+				return "mainhand";
+			}
+			if (type == "shield" || type == "source" || type == "quiver" || type == "misc_offhand") {
+				return "offhand";
+			}
+			static const char* const SLOTS[] = {
+				"helmet", "chest", "pants", "gloves", "shoes", "cape", "amulet", "belt", "orb", "ring", "earring"
+			};
+			for (const char* slot : SLOTS) {
+				if (type == slot) {
+					return type;
+				}
+			}
+			return "";
+		}
+	public:
+		GameTables() = default;
+		GameTables(GameTable<MonsterInfo> monsters, GameTable<SkillInfo> skills, GameTable<ItemInfo> items)
+			: monsters(std::move(monsters)), skills(std::move(skills)), items(std::move(items)) {}
+		explicit GameTables(const nlohmann::json& G) {
+			if (!G.is_object()) {
+				return;
+			}
+			if (auto it = G.find("monsters"); it != G.end() && it->is_object()) {
+				for (const auto& [name, monster] : it->items()) {
+					MonsterInfo info;
+					info.name = name;
+					info.hp = long(number(monster, "hp"));
+					info.speed = number(monster, "speed");
+					info.range = number(monster, "range");
+					info.attack = long(number(monster, "attack"));
+					info.xp = long(number(monster, "xp"));
+					info.armor = long(number(monster, "armor"));
+					info.resistance = long(number(monster, "resistance"));
+					info.frequency = number(monster, "frequency");
+					info.damageType = string(monster, "damage_type");
+					monsters.add(std::move(info));
+				}
+			}
+			if (auto it = G.find("skills"); it != G.end() && it->is_object()) {
+				for (const auto& [name, skill] : it->items()) {
+					SkillInfo info;
+					info.name = name;
+					info.cooldown = number(skill, "cooldown");
+					info.mp = long(number(skill, "mp"));
+					info.range = number(skill, "range");
+					info.share = string(skill, "share");
+					info.type = string(skill, "type");
+					skills.add(std::move(info));
+				}
+			}
+			if (auto it = G.find("items"); it != G.end() && it->is_object()) {
+				for (const auto& [name, item] : it->items()) {
+					ItemInfo info;
+					info.name = name;
+					info.type = string(item, "type");
+					info.slot = slotOf(info.type);
+					info.value = long(number(item, "g"));
+					info.tier = long(number(item, "tier"));
+					info.stats.attack = long(number(item, "attack"));
+					info.stats.armor = long(number(item, "armor"));
+					info.stats.resistance = long(number(item, "resistance"));
+					info.stats.hp = long(number(item, "hp"));
+					info.stats.mp = long(number(item, "mp"));
+					info.stats.speed = long(number(item, "speed"));
+					info.stats.str = long(number(item, "str"));
+					info.stats.intelligence = long(number(item, "int"));
+					info.stats.dex = long(number(item, "dex"));
+					info.stats.vit = long(number(item, "vit"));
+					info.stats.crit = long(number(item, "crit"));
+					items.add(std::move(info));
+				}
+			}
+		}
+
+		const GameTable<MonsterInfo>& getMonsters() const {
+			return monsters;
+		}
+		const GameTable<SkillInfo>& getSkills() const {
+			return skills;
+		}
+		const GameTable<ItemInfo>& getItems() const {
+			return items;
+		}
+};
+
+#endif /* ALBOT_GAMETABLES_HPP_ */
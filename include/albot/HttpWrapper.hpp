@@ -16,6 +16,7 @@
 
 #include <optional>
 #include <functional>
+#include <mutex>
 
 class HttpWrapper {
 	private:
@@ -23,12 +24,21 @@ class HttpWrapper {
 		static std::string password;
 		static std::string email;
 		static int online_version;
+		// Guards session_cookie and cookie, which sign_in sets while other requests may be in flight.
+		static std::mutex cookie_mutex;
+		/**
+		 * Writes data.bin from the parsed game data, then maps it, so the geometry is there through
+		 * data.getCache() on a cold start too.
+		 */
+		bool static write_binary_cache(int version);
 	public:
 		struct Service {
 			std::string name;
 			bool enabled;
 		};
 		static std::string NAME_MACROS;
+		// The game website, without a trailing slash. Set by the `url` key of bot.json.
+		static std::string base_url;
 		typedef std::pair<std::string, int> NameNumberPair;
 		static std::map<std::string, int> NAME_TO_NUMBER;
 		static GameData data;
@@ -102,12 +112,26 @@ class HttpWrapper {
 		bool static do_request(const std::string& url, std::optional<std::reference_wrapper<std::string>> out = std::nullopt);
 
 		/**
-		 * @brief Login to the game.
+		 * @brief Login to the game. Fetches the game version, then signs in.
 		 * 
 		 * @return true 
 		 * @return false 
 		 */
 		bool static login();
+		/**
+		 * @brief Sign in with the credentials in .env, without fetching the game version.
+		 * 
+		 * @return true 
+		 * @return false 
+		 */
+		bool static sign_in();
+		/**
+		 * @brief Fetch the current game version into online_version.
+		 * 
+		 * @return true 
+		 * @return false 
+		 */
+		bool static fetch_game_version();
 		bool static get_characters();
 		bool static get_characters_and_servers();
 		bool static process_services(const nlohmann::json& services);
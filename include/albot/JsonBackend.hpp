@@ -0,0 +1,65 @@
+#pragma once
+
+#ifndef ALBOT_JSONBACKEND_HPP_
+#define ALBOT_JSONBACKEND_HPP_
+
+#include <nlohmann/json.hpp>
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "albot/EntityDecoder.hpp"
+
+/**
+ * Parses inbound socket payloads on the socket thread.
+ *
+ * The hot events (entities, start, new_map) never need a DOM, so each backend decodes them
+ * straight into EntityRecords with whatever parser it wraps. Callbacks registered by scripts
+ * get a mutable nlohmann::json no matter the backend, see parseDocument.
+ *
+ * A backend keeps scratch buffers between calls, so an instance must only be used by one thread.
+ */
+class JsonBackend {
+	public:
+		virtual ~JsonBackend() = default;
+
+		virtual std::string_view getName() const = 0;
+
+		/**
+		 * See EntityDecoder::decodeEntities.
+		 */
+		virtual bool decodeEntities(std::string_view payload, EntityBatch& batch, const MonsterTable& monsters, std::string_view expectedMap) = 0;
+		/**
+		 * See EntityDecoder::decodeWrapped.
+		 */
+		virtual bool decodeWrapped(std::string_view payload, EntityBatch& batch, const MonsterTable& monsters) = 0;
+
+		/**
+		 * Builds a DOM for event callbacks. Always nlohmann, since that's what scripts are written against.
+		 *
+		 * @returns  false on a parse error.
+		 */
+		bool parseDocument(std::string_view payload, nlohmann::json& document) const {
+			document = nlohmann::json::parse(payload.begin(), payload.end(), nullptr, false);
+			return !document.is_discarded();
+		}
+
+		/**
+		 * Creates a backend by name ("nlohmann" or "simdjson").
+		 * An empty name picks the fastest one this build was compiled with.
+		 *
+		 * @returns  nullptr if the backend isn't available in this build.
+		 */
+		static std::unique_ptr<JsonBackend> create(std::string_view name = {});
+		/**
+		 * The names of the backends this build was compiled with, fastest first.
+		 */
+		static std::vector<std::string_view> getAvailable();
+};
+
+#ifdef ALBOT_HAS_SIMDJSON
+std::unique_ptr<JsonBackend> createSimdJsonBackend();
+#endif
+
+#endif /* ALBOT_JSONBACKEND_HPP_ */
@@ -0,0 +1,56 @@
+#pragma once
+
+#ifndef ALBOT_MOVEMENTKERNEL_HPP_
+#define ALBOT_MOVEMENTKERNEL_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Brings a whole column of moving entities to where they are at a given time:
+ * x += vx * (time - movedAt) / 1000, or their destination once time reaches arriveAt. This is
+ * EntityStore::positionAt, for every row at once.
+ *
+ * Every instruction set does the same IEEE operations in the same order, so they all produce
+ * the same bits as the scalar version, and as positionAt.
+ */
+namespace MovementKernel {
+	enum Isa {
+		SCALAR,
+		SSE2,
+		AVX2
+	};
+
+	struct Columns {
+		double* x;
+		double* y;
+		const double* vx;
+		const double* vy;
+		const double* goingX;
+		const double* goingY;
+		// When x and y were last brought up to date. Set to `time` for every row that moves.
+		double* movedAt;
+		const double* arriveAt;
+		const uint32_t* flags;
+		// Set to 1 for every row that has arrived by `time`, 0 for the others.
+		uint8_t* arrived;
+		size_t count;
+	};
+
+	/**
+	 * The fastest instruction set this CPU supports, checked once.
+	 */
+	Isa best();
+	bool isSupported(Isa isa);
+	const char* getName(Isa isa);
+
+	/**
+	 * Moves the rows whose `(flags & activeMask) == activeValue` to where they are at `time`. The
+	 * others are left as they are.
+	 *
+	 * @returns  How many rows have arrived.
+	 */
+	size_t settle(const Columns& columns, double time, uint32_t activeMask, uint32_t activeValue, Isa isa = best());
+}
+
+#endif /* ALBOT_MOVEMENTKERNEL_HPP_ */
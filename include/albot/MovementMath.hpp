@@ -19,7 +19,7 @@ public:
         double fromX = entity["from_x"];
         double fromY = entity["from_y"];
 
-        if (((fromX <= goingX && x >= goingX - 0.1) || (fromX >= goingX && x <= goingX + 0.1)) && ((fromY <= goingY && y >= goingY - 0.1) || (fromY >= goingY && y <= goingY + 0.1))) {
+        if (hasArrived(fromX, fromY, x, y, goingX, goingY)) {
             entity["x"] = goingX;
             entity["y"] = goingY;
 
@@ -40,16 +40,25 @@ public:
         return double(value);
     }
     static std::pair<double, double> calculateVelocity(const nlohmann::json& entity) {
+        return calculateVelocity(double(entity["from_x"]), double(entity["from_y"]),
+                                 double(entity["going_x"]), double(entity["going_y"]), double(entity["speed"]));
+    }
+    static std::pair<double, double> calculateVelocity(double fromX, double fromY, double goingX, double goingY, double speed) {
         
         double ref = std::sqrt(0.0001 +
-                             std::pow(double(entity["going_x"]) - double(entity["from_x"]), 2) +
-                             std::pow(double(entity["going_y"]) - double(entity["from_y"]), 2));
-        auto speed = double(entity["speed"]);
-        double vx = speed * (double(entity["going_x"]) - double(entity["from_x"])) / ref;
-        double vy = speed * (double(entity["going_y"]) - double(entity["from_y"])) / ref;
+                             std::pow(goingX - fromX, 2) +
+                             std::pow(goingY - fromY, 2));
+        double vx = speed * (goingX - fromX) / ref;
+        double vy = speed * (goingY - fromY) / ref;
         
         return std::make_pair(vx, vy);
     }
+    /**
+     * Whether an entity moving from (fromX, fromY) has reached or passed (goingX, goingY).
+     */
+    static bool hasArrived(double fromX, double fromY, double x, double y, double goingX, double goingY) {
+        return ((fromX <= goingX && x >= goingX - 0.1) || (fromX >= goingX && x <= goingX + 0.1)) && ((fromY <= goingY && y >= goingY - 0.1) || (fromY >= goingY && y <= goingY + 0.1));
+    }
 
     static double pythagoras(double x1, double y1, double x2, double y2) {
         return std::sqrt(
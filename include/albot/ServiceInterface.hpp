@@ -8,6 +8,9 @@
 #include <nlohmann/json.hpp>
 #include <functional>
 #include <any>
+#include <mutex>
+#include "albot/GameDataCache.hpp"
+#include "albot/GameTables.hpp"
 
 class MutableGameData {
 private:
@@ -39,40 +42,90 @@ public:
 class GameData {
 private:
 	std::shared_ptr<nlohmann::json> data;
+	// Built once the JSON is final, and shared by every copy.
+	std::shared_ptr<const GameTables> tables;
+	// Set when loaded from the binary cache: the JSON is only decoded out of it the first time
+	// someone asks for it, once for every copy.
+	std::shared_ptr<const GameDataCache> cache;
+	std::shared_ptr<std::once_flag> decoded;
+
+	const nlohmann::json& document() const {
+		if (decoded) {
+			std::call_once(*decoded, [this]() {
+				std::span<const uint8_t> bytes = cache->getDocument();
+				nlohmann::json::from_msgpack(bytes.begin(), bytes.end()).swap(*data);
+			});
+		}
+		return *data;
+	}
 public:
 	bool was_cached = false;
-	GameData() : data(new nlohmann::json()) {
+	GameData() : data(new nlohmann::json()), tables(std::make_shared<const GameTables>()) {
 	}
 	GameData(const std::string& rawJson) : data(new nlohmann::json()) {
 		was_cached = false;
 		nlohmann::json::parse(rawJson, nullptr, true, true).swap(*this->data);
+		tables = std::make_shared<const GameTables>(*data);
 	}
 	GameData(std::istream& rawJson) : data(new nlohmann::json()) {
 		was_cached = true;
 		nlohmann::json::parse(rawJson, nullptr, true, true).swap(*this->data);
+		tables = std::make_shared<const GameTables>(*data);
+	}
+	explicit GameData(std::shared_ptr<const GameDataCache> cache)
+		: data(new nlohmann::json()), tables(std::make_shared<const GameTables>(cache->loadTables())), cache(std::move(cache)),
+		decoded(std::make_shared<std::once_flag>()) {
+		was_cached = true;
 	}
-	GameData(const GameData& old) : data(old.data) {
+	/**
+	 * The JSON already parsed, with the cache just written from it: nothing gets decoded, but the
+	 * geometry is there for getCache() users like on a warm start.
+	 */
+	GameData(const GameData& parsed, std::shared_ptr<const GameDataCache> cache)
+		: data(parsed.data), tables(parsed.tables), cache(std::move(cache)) {
+		was_cached = parsed.was_cached;
+	}
+	GameData(const GameData& old) : data(old.data), tables(old.tables), cache(old.cache), decoded(old.decoded) {
 		was_cached = true;
 	}
-	GameData(const MutableGameData& old) : data(old.data) {
+	GameData& operator=(const GameData& old) = default;
+	GameData(const MutableGameData& old) : data(old.data), tables(std::make_shared<const GameTables>(*data)) {
 		was_cached = false;
 	}
-	GameData(MutableGameData&& old) : data(std::move(old.data)) {
+	GameData(MutableGameData&& old) : data(std::move(old.data)), tables(std::make_shared<const GameTables>(*data)) {
 		was_cached = false;
 	}
 
+	/**
+	 * Monsters, skills and items as typed tables, for code that shouldn't walk the JSON.
+	 */
+	const GameTables& getTables() const {
+		return *tables;
+	}
+	std::shared_ptr<const GameTables> shareTables() const {
+		return tables;
+	}
+	/**
+	 * @returns  The binary cache, for the simplified geometry of every map (see GameDataCache::findMap),
+	 *           which doesn't need G decoded. Set on cold starts too, once data.bin is written, so it's
+	 *           only nullptr if writing it failed.
+	 */
+	const GameDataCache* getCache() const {
+		return cache.get();
+	}
+
 	// Utility methods to access the JSON.
 	const nlohmann::json& getData() const {
-		return *data;
+		return document();
 	}
 	const nlohmann::json& operator[](const std::string& key) const {
-		return data->at(key);
+		return document().at(key);
 	}
 	bool contains(const std::string& key) const {
-		return data->contains(key);
+		return document().contains(key);
 	}
 	const nlohmann::json& at(const std::string& key) const {
-		return data->at(key);
+		return document().at(key);
 	}
 };
 
@@ -131,6 +184,8 @@ private:
 	erased_type<std::function> handler;
 	std::function<void()> destructor;
 public:
+	// Read map geometry through G.getCache() and the typed tables through G.getTables(), both
+	// without decoding G. Only getData() and operator[] decode it, once, on first use.
 	const GameData& G;
 	ServiceInfo(const GameData& data) : G(data) {
 		
@@ -9,17 +9,70 @@
 
 #include <vector>
 
+#include <array>
+#include <atomic>
+#include <deque>
 #include <mutex>
 #include <map>
+#include <memory>
 #include <chrono>
 
 #include "albot/Bot.hpp"
+#include "albot/ChangeJournal.hpp"
+#include "albot/EntityDecoder.hpp"
+#include "albot/EntityStore.hpp"
+#include "albot/GameEvents.hpp"
+#include "albot/JsonBackend.hpp"
+#include "albot/WorldSnapshot.hpp"
+#include "albot/Enums/EventEnum.hpp"
+#include "albot/Utils/FrameParser.hpp"
+#include "albot/Utils/LatencyHistogram.hpp"
+#include "albot/Utils/MpscQueue.hpp"
+#include "albot/Utils/RateGovernor.hpp"
+#include "albot/Utils/WireCapture.hpp"
 
 #include <functional>
+#include <string_view>
+#include <utility>
 
 
 typedef std::function<void(const ix::WebSocketMessagePtr&)> RawCallback;
 typedef std::function<void(const nlohmann::json&)> EventCallback;
+typedef std::function<void(std::string_view)> PayloadCallback;
+
+/**
+ * What permessage-deflate is saving on one connection. Wire bytes are the frame payloads
+ * as sent, the others are the same messages inflated. Safe to read from any thread.
+ */
+struct CompressionStats {
+	std::atomic<bool> negotiated = false;
+	std::atomic<size_t> inboundMessages = 0;
+	std::atomic<size_t> inboundWireBytes = 0;
+	std::atomic<size_t> inboundBytes = 0;
+	std::atomic<size_t> outboundMessages = 0;
+	std::atomic<size_t> outboundWireBytes = 0;
+	std::atomic<size_t> outboundBytes = 0;
+
+	/**
+	 * @returns  Inflated bytes per wire byte for inbound traffic, 1 if nothing was received.
+	 */
+	double getInboundRatio() const {
+		size_t wire = inboundWireBytes;
+		return wire == 0 ? 1.0 : double(inboundBytes) / double(wire);
+	}
+	double getOutboundRatio() const {
+		size_t wire = outboundWireBytes;
+		return wire == 0 ? 1.0 : double(outboundBytes) / double(wire);
+	}
+	void reset() {
+		inboundMessages = 0;
+		inboundWireBytes = 0;
+		inboundBytes = 0;
+		outboundMessages = 0;
+		outboundWireBytes = 0;
+		outboundBytes = 0;
+	}
+};
 
 class SocketWrapper {
 	private:
@@ -32,41 +85,185 @@ class SocketWrapper {
 		// ping managing
 		int pingInterval;
 		std::chrono::time_point<std::chrono::high_resolution_clock> lastPing;
+		// ping_trig ids and when they were sent, indexed by id modulo the size. Socket thread only.
+		uint64_t nextPingId = 0;
+		std::array<Types::TimePoint, 16> pingsSent;
+
+		// See getRttLatency and friends.
+		LatencyHistogram rttLatency;
+		LatencyHistogram dispatchLatency;
+		LatencyHistogram responseLatency;
+		// When the frame being handled arrived, and whether its dispatch has been timed yet. Socket thread only.
+		Types::TimePoint frameReceivedAt;
+		bool frameDispatched = true;
+		void markDispatched();
+		// When each command still waiting for its game_response was sent, oldest first, by event.
+		std::mutex responseGuard;
+		std::map<std::string, std::deque<Types::TimePoint>, std::less<>> pendingResponses;
+		/**
+		 * Remembers that `event` was just sent, if the server answers it with a game_response.
+		 */
+		void trackResponse(std::string_view event, Types::TimePoint sentAt);
+		void onGameResponse(const nlohmann::json& event);
+
+		bool compression = true;
+		CompressionStats compressionStats;
+		/**
+		 * Every frame goes out through here, so it's counted in compressionStats.
+		 */
+		void send(const std::string& frame);
+		void logCompressionStats();
+
+		// Set before connecting, see setRecorder.
+		std::shared_ptr<WireCapture::Recorder> recorder;
+		// While replaying, nothing is sent and the socket is never opened.
+		bool replaying = false;
+		bool canSend() {
+			return replaying || this->webSocket.getReadyState() == ix::ReadyState::Open;
+		}
 
 		// Entity management
 		bool hasReceivedFirstEntities;
 
 		// Callbacks
 		std::vector<RawCallback> rawCallbacks;
-		std::map<std::string, std::vector<EventCallback>> eventCallbacks;
+		// Indexed by event id. Known events get their ids from EventEnum, anything else
+		// registered at runtime is interned with an id past EventEnum::KNOWN_EVENT_COUNT.
+		std::vector<std::vector<EventCallback>> eventCallbacks;
+		std::map<std::string, EventEnum::EVENT, std::less<>> internedEvents;
+
+		// Events received without any listener. These are dropped before their payload is parsed.
+		std::atomic<size_t> droppedEventCount = 0;
+		std::vector<size_t> droppedEvents;
+		std::map<std::string, size_t, std::less<>> droppedUnknownEvents;
 
-		std::map<std::string, nlohmann::json> entities;
-		std::map<std::string, nlohmann::json> updatedEntities;
+		// Internal handlers that decode the raw payload themselves, indexed like eventCallbacks.
+		std::vector<std::vector<PayloadCallback>> payloadCallbacks;
+
+		// World state: entities, character and chests. Only applyInbound writes to it, on the bot's loop.
+		EntityStore entities;
+		MonsterTable monsterTable;
+		// Parses inbound payloads. Socket thread only.
+		std::unique_ptr<JsonBackend> jsonBackend;
+		// The map the character is on, as last told by start or new_map. Socket thread only.
+		std::string currentMap;
 
 		
 		nlohmann::json character;
-		nlohmann::json updatedCharacter;
-
-		std::mutex chestGuard;
-		std::mutex deletionGuard;
-		std::mutex entityGuard;
 
 		std::map<std::string, nlohmann::json> chests;
-		void handle_entities(const nlohmann::json&);
+		ChangeJournal journal;
+
+		// The last snapshot publishSnapshot made, for readers on any thread.
+		std::atomic<std::shared_ptr<const WorldSnapshot>> snapshot;
+		// Published snapshots alternate between these. The one not currently published is
+		// refilled in place, unless a reader still holds it. Loop thread only.
+		std::array<std::shared_ptr<WorldSnapshot>, 2> snapshotBuffers;
+		uint64_t snapshotTick = 0;
+
+		// Changes to the world decoded on the socket thread, waiting for applyInbound.
+		struct InboundUpdate {
+			Types::TimePoint queuedAt;
+			std::function<void()> apply;
+		};
+		MpscQueue<InboundUpdate> inbound;
+		std::atomic<size_t> inboundHighWater = 0;
+		std::atomic<size_t> inboundOverflowCount = 0;
+		LatencyHistogram applyLatency;
+		// Whether a full resend was asked for since the queue overflowed. Socket thread only.
+		bool requestedResync = false;
+		/**
+		 * Queues a change to the world for the bot's loop. If the queue is full the change is lost,
+		 * so the server is asked to send everything again.
+		 */
+		void post(std::function<void()> update);
+		/**
+		 * Merges decoded entities into the world. A snapshot also removes every entity it doesn't mention.
+		 * Loop thread only.
+		 */
+		void applyEntities(const EntityBatch& batch, bool snapshot);
+		/**
+		 * Merges the patch into the character, journaling the fields that changed under its name.
+		 * Loop thread only.
+		 */
+		void patchCharacter(const nlohmann::json& patch);
+
+		// Outbound commands are serialized into sendBuffer, then staged until the next flushCommands.
+		// Staged frames swap buffers with sendBuffer, so their capacity is reused between ticks.
+		enum CommandType : uint8_t {
+			ATTACK_COMMAND,
+			HEAL_COMMAND,
+			SKILL_COMMAND,
+			MOVE_COMMAND,
+			EQUIP_COMMAND,
+			// Anything passed to emit that the rate governor held back.
+			OTHER_COMMAND
+		};
+		struct StagedCommand {
+			CommandType type;
+			RateGovernor::Priority priority;
+			// Set when a later command in the same tick superseded this one.
+			bool superseded = false;
+			Types::TimePoint stagedAt;
+			std::string event;
+			std::string frame;
+		};
+		std::mutex sendGuard;
+		std::string sendBuffer;
+		std::vector<StagedCommand> stagedCommands;
+		size_t stagedCount = 0;
+		// Whether a flush on a closed socket has been logged since it was last open.
+		bool reportedClosed = false;
+		std::atomic<size_t> sentCommandCount = 0;
+		std::atomic<size_t> coalescedCommandCount = 0;
+		RateGovernor rateGovernor;
+		/**
+		 * Starts a `42["event",{` frame in sendBuffer. The caller must hold sendGuard.
+		 */
+		void beginCommand(std::string_view event);
+		void appendField(std::string_view key, std::string_view value);
+		void appendField(std::string_view key, double value);
+		void appendField(std::string_view key, long value);
+		/**
+		 * Closes the frame in sendBuffer and stages it. Moves supersede earlier moves, skills and
+		 * equips identical to one already staged are dropped. The caller must hold sendGuard.
+		 */
+		void stageCommand(CommandType type, std::string_view event, RateGovernor::Priority priority);
+		/**
+		 * Moves the frame in sendBuffer to the end of the staged commands. The caller must hold sendGuard.
+		 */
+		void stageFrame(CommandType type, std::string_view event, RateGovernor::Priority priority);
+		/**
+		 * Sends the frame in sendBuffer right away if the rate governor allows it, otherwise stages
+		 * or drops it. The caller must hold sendGuard.
+		 */
+		void emitFrame(std::string_view event);
+
 		void triggerInternalEvents(std::string eventName, const nlohmann::json &event);
-		void dispatchEvent(std::string eventName, const nlohmann::json &event);
+		void dispatchEvent(EventEnum::EVENT event, const nlohmann::json &data);
+		bool hasEventCallback(EventEnum::EVENT event) const;
+		bool hasPayloadCallback(EventEnum::EVENT event) const;
+		/**
+		 * @returns  true if any payload callback handled the event.
+		 */
+		bool dispatchPayload(EventEnum::EVENT event, std::string_view payload);
+		void registerPayloadCallback(EventEnum::EVENT event, PayloadCallback callback);
+		void dropEvent(EventEnum::EVENT event, std::string_view eventName);
+		/**
+		 * Maps an event name to its id without allocating.
+		 * Returns EventEnum::UNKNOWN for names nobody registered.
+		 */
+		EventEnum::EVENT resolveEvent(std::string_view eventName) const;
+		EventEnum::EVENT internEvent(std::string_view eventName);
 		void messageReceiver(const ix::WebSocketMessagePtr &message);
+		/**
+		 * Dispatches a decoded EVENT packet. The payload is parsed in place; the
+		 * full array is only parsed when the frame couldn't be split.
+		 */
+		void receiveEvent(const FrameParser::Frame &frame);
 		void initializeSystem();
 		void login(const CharacterGameInfo& info);
 
-		/**
-		 * Cleans up input to avoid type bugs introduced by the backend.
-		 * One notable use for this is with the `rip` attribute.
-		 * Some chars have an integer value as the value, but this
-		 * client expects a bool, meaning anything else will trigger a
-		 * crash.
-		 */
-		void sanitizeInput(nlohmann::json &entity);
 	public:
 		/**
 		 * Initializes a general, empty SocketWrapper ready to connect.
@@ -89,8 +286,70 @@ class SocketWrapper {
 		 * Equivalent of socket.on
 		 */
 		void registerEventCallback(const std::string& event, std::function<void(const nlohmann::json&)> callback);
+		/**
+		 * Equivalent of socket.on, for events known ahead of time. This skips interning the name.
+		 */
+		void registerEventCallback(EventEnum::EVENT event, std::function<void(const nlohmann::json&)> callback);
+		/**
+		 * Equivalent of socket.on, with the payload read into its type from GameEvents:
+		 * `registerEventCallback<EventEnum::PM>([](const GameEvents::Pm& pm) { ... })`.
+		 *
+		 * The payload is read straight from the frame, without a JSON DOM. The event's views are
+		 * only valid during the callback. Payloads that aren't objects never reach it.
+		 */
+		template <EventEnum::EVENT Event>
+		void registerEventCallback(std::function<void(const typename GameEvents::Payload<Event>::type&)> callback) {
+			registerPayloadCallback(Event, [callback = std::move(callback), scratch = std::string()](std::string_view payload) mutable {
+				typename GameEvents::Payload<Event>::type event;
+				if (GameEvents::read(payload, scratch, event)) {
+					callback(event);
+				}
+			});
+		}
 		void deleteEntities();
 
+		/**
+		 * The number of events that arrived without a registered callback, and were
+		 * therefore dropped without parsing their payload.
+		 */
+		size_t getDroppedEventCount() const;
+		/**
+		 * Same as above, for a single event. Only safe to call from the socket thread.
+		 */
+		size_t getDroppedEventCount(const std::string& eventName) const;
+
+		/**
+		 * Switches the parser used for inbound events, see JsonBackend::create.
+		 * Must be called before connecting.
+		 *
+		 * @returns  false if the backend isn't available in this build. The current one is kept.
+		 */
+		bool setJsonBackend(std::string_view name);
+
+		/**
+		 * Offers permessage-deflate when connecting. On by default; the server decides whether
+		 * it's actually used, see CompressionStats::negotiated. Must be called before connecting.
+		 */
+		void setCompression(bool enabled);
+		const CompressionStats& getCompressionStats() const {
+			return compressionStats;
+		}
+
+		/**
+		 * Records every raw frame this socket receives or sends, see WireCapture.
+		 * Pass nullptr to stop recording. Must be called before connecting.
+		 */
+		void setRecorder(std::shared_ptr<WireCapture::Recorder> recorder);
+		/**
+		 * Puts the socket in replay mode: outbound frames are dropped instead of sent,
+		 * and inbound frames come from replayMessage instead of the network.
+		 */
+		void setReplaying(bool replaying);
+		/**
+		 * Handles a recorded inbound text frame as if it had just arrived.
+		 */
+		void replayMessage(const std::string& frame);
+
 		void receiveLocalCm(std::string from, const nlohmann::json &message);
 		/**
 		 *  Connects a user. this should only be run from the Player class
@@ -101,17 +360,131 @@ class SocketWrapper {
 		void sendPing();
 		void emit(const std::string& event, const nlohmann::json &json = { });
 		void emitRawJsonString(std::string event, std::string json = " ");
+
+		/**
+		 * Typed versions of the commands bots send all the time. These are serialized straight
+		 * into a reused buffer, instead of building and dumping a JSON object per call, and
+		 * staged until the end of the current loop iteration (see flushCommands).
+		 */
+		void attack(std::string_view id);
+		void heal(std::string_view id);
+		/**
+		 * @param target  The entity to use the skill on, or empty for untargeted skills.
+		 */
+		void skill(std::string_view name, std::string_view target = {});
+		void move(double x, double y, double going_x, double going_y, long m);
+		/**
+		 * Equips (or uses, for potions) the item in inventory slot `num`.
+		 *
+		 * @param slot  The equipment slot to put it in, or empty to let the server decide.
+		 */
+		void equip(size_t num, std::string_view slot = {});
+		/**
+		 * Sends the commands staged since the last flush, in order. Called once per loop iteration.
+		 */
+		void flushCommands();
+		/**
+		 * Commands actually sent, and commands dropped because they were superseded or duplicated within a tick.
+		 */
+		size_t getSentCommandCount() const {
+			return sentCommandCount;
+		}
+		size_t getCoalescedCommandCount() const {
+			return coalescedCommandCount;
+		}
+		/**
+		 * Limits and priorities for everything this socket sends. Only configure it before connecting;
+		 * the metrics can be read at any time.
+		 */
+		RateGovernor& getRateGovernor() {
+			return rateGovernor;
+		}
+		/**
+		 * Round trips of ping_trig, measured every ping interval.
+		 */
+		const LatencyHistogram& getRttLatency() const {
+			return rttLatency;
+		}
+		/**
+		 * From a frame arriving to its first callback running, which includes parsing it.
+		 */
+		const LatencyHistogram& getDispatchLatency() const {
+			return dispatchLatency;
+		}
+		/**
+		 * From a command (attack, heal, skill, equip, use) being sent to its game_response.
+		 * Commands the server answers with something else, or not at all, aren't counted.
+		 */
+		const LatencyHistogram& getResponseLatency() const {
+			return responseLatency;
+		}
 		void onDisappear(const nlohmann::json &event);
 
 		void changeServer(Server *server);
 
-		std::map<std::string, nlohmann::json>& getEntities();
-		std::map<std::string, nlohmann::json>& getUpdateEntities();
+		/**
+		 * Applies every change the socket thread queued since the last call, in the order it arrived.
+		 * This is the only writer of the world, so the getters below need no lock on the loop thread.
+		 *
+		 * @returns  The number of changes applied.
+		 */
+		size_t applyInbound();
+		/**
+		 * Changes waiting for applyInbound, and the most there have ever been at once.
+		 * Safe to read from any thread.
+		 */
+		size_t getInboundDepth() const {
+			return inbound.size();
+		}
+		size_t getInboundHighWater() const {
+			return inboundHighWater;
+		}
+		/**
+		 * Changes lost to a full queue. Each overflow asks the server for a full resend.
+		 */
+		size_t getInboundOverflowCount() const {
+			return inboundOverflowCount;
+		}
+		/**
+		 * From a change being queued on the socket thread to it being applied on the loop.
+		 */
+		const LatencyHistogram& getApplyLatency() const {
+			return applyLatency;
+		}
+
+		/**
+		 * Copies the world into an immutable snapshot and publishes it. Called by the bot's loop
+		 * at the end of every tick.
+		 */
+		void publishSnapshot(Types::TimePoint now);
+		/**
+		 * The world as of the end of the last tick, or nullptr before the first one. Safe to call
+		 * from any thread, without locking: the snapshot stays valid and unchanged for as long as
+		 * it's held, while the loop goes on publishing new ones. Hold it only as long as needed,
+		 * or the next publish has to allocate a new buffer.
+		 */
+		std::shared_ptr<const WorldSnapshot> getSnapshot() const {
+			return snapshot.load(std::memory_order_acquire);
+		}
+
+		/**
+		 * World state. Loop thread only, other threads should use getSnapshot.
+		 */
+		EntityStore& getEntities();
+		const MonsterTable& getMonsterTable() const {
+			return monsterTable;
+		}
 
 		nlohmann::json& getCharacter();
-		nlohmann::json& getUpdateCharacter();
 		
 		std::map<std::string, nlohmann::json>& getChests();
+		/**
+		 * What changed in the world, generation by generation. The character is journaled under its name.
+		 * Whoever removes entities from getEntities is expected to journal it.
+		 */
+		ChangeJournal& getJournal() {
+			return journal;
+		}
 
 		bool isOpen() {
 			return webSocket.getReadyState() == ix::ReadyState::Open;
@@ -119,13 +492,6 @@ class SocketWrapper {
 		ix::ReadyState getReadyState() {
 			return webSocket.getReadyState();
 		}
-
-		std::mutex& getChestGuard() {
-			return chestGuard;
-		}
-		std::mutex& getEntityGuard() {
-			return entityGuard;
-		}
 };
 
 #endif /* ALBOT_SOCKETWRAPPER_HPP_ */
@@ -0,0 +1,128 @@
+#pragma once
+
+#ifndef ALBOT_SPATIALGRID_HPP_
+#define ALBOT_SPATIALGRID_HPP_
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "albot/Utils/FlatHashMap.hpp"
+
+/**
+ * Buckets ids by position into square cells, one grid per map, so range queries only look at
+ * the cells they overlap instead of at everything. Only occupied cells take memory.
+ *
+ * The grid doesn't know where its ids are, the owner passes the cell back in to move or remove
+ * one, see EntityStore.
+ */
+class SpatialGrid {
+	public:
+		typedef uint64_t CellKey;
+		static constexpr CellKey NO_CELL = ~CellKey(0);
+		// Around the attack range of most classes, so a query for targets in range covers a few cells.
+		static constexpr double DEFAULT_CELL_SIZE = 128.0;
+	private:
+		// Map in the top 16 bits, then 24 bits per axis, biased to be positive.
+		static constexpr int64_t BIAS = int64_t(1) << 23;
+		static constexpr uint64_t AXIS_MASK = (uint64_t(1) << 24) - 1;
+
+		double cellSize;
+		double inverseCellSize;
+		FlatHashMap<CellKey, std::vector<uint32_t>> cells;
+	public:
+		explicit SpatialGrid(double cellSize = DEFAULT_CELL_SIZE) : cellSize(cellSize), inverseCellSize(1.0 / cellSize) {}
+
+		double getCellSize() const {
+			return cellSize;
+		}
+		int64_t cellOf(double coordinate) const {
+			return int64_t(std::floor(coordinate * inverseCellSize));
+		}
+		static CellKey keyOf(uint32_t map, int64_t cellX, int64_t cellY) {
+			return (CellKey(map) << 48) | ((CellKey(cellX + BIAS) & AXIS_MASK) << 24) | (CellKey(cellY + BIAS) & AXIS_MASK);
+		}
+		CellKey keyOf(uint32_t map, double x, double y) const {
+			return keyOf(map, cellOf(x), cellOf(y));
+		}
+		static uint32_t mapOf(CellKey key) {
+			return uint32_t(key >> 48);
+		}
+		static int64_t cellXOf(CellKey key) {
+			return int64_t((key >> 24) & AXIS_MASK) - BIAS;
+		}
+		static int64_t cellYOf(CellKey key) {
+			return int64_t(key & AXIS_MASK) - BIAS;
+		}
+
+		void insert(CellKey key, uint32_t id) {
+			std::vector<uint32_t>* cell = cells.find(key);
+			if (cell == nullptr) {
+				cell = &cells.insert(key, {});
+			}
+			cell->push_back(id);
+		}
+		void remove(CellKey key, uint32_t id) {
+			std::vector<uint32_t>* cell = cells.find(key);
+			if (cell == nullptr) {
+				return;
+			}
+			for (size_t i = 0; i < cell->size(); i++) {
+				if ((*cell)[i] == id) {
+					(*cell)[i] = cell->back();
+					cell->pop_back();
+					break;
+				}
+			}
+			if (cell->empty()) {
+				cells.erase(key);
+			}
+		}
+		void clear() {
+			cells.clear();
+		}
+
+		/**
+		 * Calls `callback(uint32_t id)` for every id in a cell the rectangle touches. Some may lie
+		 * outside of it, the caller checks the exact position.
+		 */
+		template <typename Callback>
+		void forEachInRect(uint32_t map, double minX, double minY, double maxX, double maxY, Callback&& callback) const {
+			const int64_t fromX = cellOf(minX);
+			const int64_t toX = cellOf(maxX);
+			const int64_t fromY = cellOf(minY);
+			const int64_t toY = cellOf(maxY);
+			// A rectangle spanning more cells than are occupied is cheaper to answer by walking the occupied ones.
+			if (double(toX - fromX + 1) * double(toY - fromY + 1) > double(cells.size())) {
+				cells.forEach([&](CellKey key, const std::vector<uint32_t>& ids) {
+					const int64_t cellX = cellXOf(key);
+					const int64_t cellY = cellYOf(key);
+					if (mapOf(key) == map && fromX <= cellX && cellX <= toX && fromY <= cellY && cellY <= toY) {
+						for (uint32_t id : ids) {
+							callback(id);
+						}
+					}
+				});
+				return;
+			}
+			for (int64_t cellX = fromX; cellX <= toX; cellX++) {
+				for (int64_t cellY = fromY; cellY <= toY; cellY++) {
+					if (const std::vector<uint32_t>* ids = cells.find(keyOf(map, cellX, cellY))) {
+						for (uint32_t id : *ids) {
+							callback(id);
+						}
+					}
+				}
+			}
+		}
+
+		/**
+		 * Calls `callback(CellKey key, const std::vector<uint32_t>& ids)` for every occupied cell.
+		 */
+		template <typename Callback>
+		void forEachCell(Callback&& callback) const {
+			cells.forEach(callback);
+		}
+};
+
+#endif /* ALBOT_SPATIALGRID_HPP_ */
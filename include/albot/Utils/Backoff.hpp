@@ -0,0 +1,46 @@
+#pragma once
+
+#ifndef ALBOT_BACKOFF_HPP_
+#define ALBOT_BACKOFF_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+/**
+ * Jittered exponential backoff. Each delay is drawn from the upper half of base * 2^attempt,
+ * capped at `cap`, so a batch of characters dropped at once doesn't reconnect in lockstep,
+ * while the delay still grows with every failed attempt.
+ *
+ * Not thread safe.
+ */
+class Backoff {
+	private:
+		std::chrono::milliseconds base;
+		std::chrono::milliseconds cap;
+		size_t attempts = 0;
+		std::mt19937 random;
+	public:
+		Backoff(std::chrono::milliseconds base = std::chrono::milliseconds(100), std::chrono::milliseconds cap = std::chrono::milliseconds(10000))
+			: base(base), cap(cap), random(std::random_device()()) {
+		}
+
+		/**
+		 * @returns  How long to wait before the next attempt.
+		 */
+		std::chrono::milliseconds next() {
+			// Past 2^20 the cap has long been reached, and the shift would only risk overflowing.
+			double ceiling = std::min(double(cap.count()), double(base.count()) * double(1ull << std::min<size_t>(attempts, 20)));
+			attempts++;
+			std::uniform_real_distribution<double> jitter(ceiling / 2, ceiling);
+			return std::chrono::milliseconds(long(jitter(random)));
+		}
+		void reset() {
+			attempts = 0;
+		}
+		size_t getAttempts() const {
+			return attempts;
+		}
+};
+
+#endif /* ALBOT_BACKOFF_HPP_ */
@@ -0,0 +1,226 @@
+#pragma once
+
+#ifndef ALBOT_FLAT_HASH_MAP_HPP_
+#define ALBOT_FLAT_HASH_MAP_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/**
+ * An open-addressing hash map that keeps every entry in one flat array.
+ *
+ * Collisions are resolved by linear probing with Robin Hood ordering: an entry far from its
+ * bucket takes the place of one closer to its own. Probe sequences stay short, a miss stops as
+ * soon as it meets an entry closer to home than it would be, and erasing shifts the following
+ * entries back instead of leaving tombstones.
+ *
+ * Lookups take anything Hash and Equal accept, so a map keyed by std::string can be searched
+ * with a std::string_view when Hash is std::hash<std::string_view>.
+ *
+ * References to values are invalidated by any insert or erase.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<>>
+class FlatHashMap {
+	private:
+		struct Bucket {
+			Key key;
+			Value value;
+		};
+		// The longest probe before the table grows, so the distance fits in a byte.
+		static constexpr uint8_t MAX_DISTANCE = 255;
+
+		std::vector<Bucket> buckets;
+		// 0 for an empty bucket, otherwise 1 + how far the entry is from its own bucket.
+		std::vector<uint8_t> distances;
+		size_t count = 0;
+		size_t mask = 0;
+		unsigned int shift = 64;
+		[[no_unique_address]] Hash hasher;
+		[[no_unique_address]] Equal equal;
+
+		template <typename K>
+		size_t bucketOf(const K& key) const {
+			// Fibonacci hashing, so weak hashes (like identity on integers) still spread out.
+			return size_t((uint64_t(hasher(key)) * 0x9E3779B97F4A7C15ull) >> shift) & mask;
+		}
+
+		template <typename K>
+		bool locate(const K& key, size_t& out) const {
+			if (count == 0) {
+				return false;
+			}
+			size_t index = bucketOf(key);
+			uint8_t distance = 1;
+			while (distances[index] >= distance) {
+				if (distances[index] == distance && equal(buckets[index].key, key)) {
+					out = index;
+					return true;
+				}
+				distance++;
+				index = (index + 1) & mask;
+			}
+			return false;
+		}
+
+		void place(Bucket&& entry) {
+			size_t index = bucketOf(entry.key);
+			uint8_t distance = 1;
+			while (distances[index] != 0) {
+				if (distances[index] < distance) {
+					std::swap(entry, buckets[index]);
+					std::swap(distance, distances[index]);
+				}
+				if (distance == MAX_DISTANCE) {
+					rehash(buckets.size() * 2);
+					place(std::move(entry));
+					return;
+				}
+				distance++;
+				index = (index + 1) & mask;
+			}
+			buckets[index] = std::move(entry);
+			distances[index] = distance;
+		}
+
+		void rehash(size_t capacity) {
+			std::vector<Bucket> oldBuckets = std::move(buckets);
+			std::vector<uint8_t> oldDistances = std::move(distances);
+			buckets = std::vector<Bucket>(capacity);
+			distances = std::vector<uint8_t>(capacity, 0);
+			mask = capacity - 1;
+			shift = 64;
+			for (size_t size = capacity; size > 1; size >>= 1) {
+				shift--;
+			}
+			for (size_t i = 0; i < oldBuckets.size(); i++) {
+				if (oldDistances[i] != 0) {
+					place(std::move(oldBuckets[i]));
+				}
+			}
+		}
+	public:
+		FlatHashMap() = default;
+		explicit FlatHashMap(size_t expected) {
+			reserve(expected);
+		}
+
+		size_t size() const {
+			return count;
+		}
+		bool empty() const {
+			return count == 0;
+		}
+		size_t capacity() const {
+			return buckets.size();
+		}
+
+		/**
+		 * Makes room for `expected` entries without growing again.
+		 */
+		void reserve(size_t expected) {
+			size_t capacity = 8;
+			while (capacity * 3 < expected * 4) {
+				capacity <<= 1;
+			}
+			if (capacity > buckets.size()) {
+				rehash(capacity);
+			}
+		}
+
+		/**
+		 * @returns  The value, or nullptr.
+		 */
+		template <typename K>
+		Value* find(const K& key) {
+			size_t index;
+			return locate(key, index) ? &buckets[index].value : nullptr;
+		}
+		template <typename K>
+		const Value* find(const K& key) const {
+			size_t index;
+			return locate(key, index) ? &buckets[index].value : nullptr;
+		}
+		template <typename K>
+		bool contains(const K& key) const {
+			size_t index;
+			return locate(key, index);
+		}
+
+		/**
+		 * Sets the value of the key, adding it if it's missing.
+		 */
+		template <typename K>
+		Value& insert(const K& key, Value value) {
+			if (Value* existing = find(key)) {
+				*existing = std::move(value);
+				return *existing;
+			}
+			if ((count + 1) * 4 > buckets.size() * 3) {
+				rehash(buckets.empty() ? 8 : buckets.size() * 2);
+			}
+			place(Bucket{ Key(key), std::move(value) });
+			count++;
+			return *find(key);
+		}
+
+		/**
+		 * @returns  false if the key wasn't there.
+		 */
+		template <typename K>
+		bool erase(const K& key) {
+			size_t index;
+			if (!locate(key, index)) {
+				return false;
+			}
+			size_t next = (index + 1) & mask;
+			while (distances[next] > 1) {
+				buckets[index] = std::move(buckets[next]);
+				distances[index] = distances[next] - 1;
+				index = next;
+				next = (next + 1) & mask;
+			}
+			buckets[index] = Bucket();
+			distances[index] = 0;
+			count--;
+			return true;
+		}
+
+		/**
+		 * Calls `callback(const Key&, Value&)` for every entry, in no particular order.
+		 * The callback must not insert or erase.
+		 */
+		template <typename Callback>
+		void forEach(Callback&& callback) {
+			for (size_t i = 0; i < buckets.size(); i++) {
+				if (distances[i] != 0) {
+					callback(static_cast<const Key&>(buckets[i].key), buckets[i].value);
+				}
+			}
+		}
+		template <typename Callback>
+		void forEach(Callback&& callback) const {
+			for (size_t i = 0; i < buckets.size(); i++) {
+				if (distances[i] != 0) {
+					callback(buckets[i].key, buckets[i].value);
+				}
+			}
+		}
+
+		/**
+		 * Empties the map. The capacity is kept.
+		 */
+		void clear() {
+			for (size_t i = 0; i < buckets.size(); i++) {
+				if (distances[i] != 0) {
+					buckets[i] = Bucket();
+					distances[i] = 0;
+				}
+			}
+			count = 0;
+		}
+};
+
+#endif /* ALBOT_FLAT_HASH_MAP_HPP_ */
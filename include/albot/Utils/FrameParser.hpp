@@ -0,0 +1,81 @@
+#pragma once
+
+#ifndef ALBOT_FRAMEPARSER_HPP_
+#define ALBOT_FRAMEPARSER_HPP_
+
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Zero-copy decoder for Engine.IO v4 / Socket.IO v5 websocket frames.
+ *
+ * Every view in a decoded Frame points into the message it was decoded from, so the
+ * frame is only valid for as long as that message is.
+ */
+namespace FrameParser {
+	/**
+	 * Engine.IO packet type, the first character of every frame.
+	 */
+	enum FrameType : int8_t {
+		INVALID_FRAME = -1,
+		OPEN = 0,
+		CLOSE = 1,
+		PING = 2,
+		PONG = 3,
+		MESSAGE = 4,
+		UPGRADE = 5,
+		NOOP = 6
+	};
+
+	/**
+	 * Socket.IO packet type, the second character of MESSAGE frames.
+	 * NO_PACKET means the MESSAGE frame carried plain data instead of a Socket.IO packet.
+	 */
+	enum PacketType : int8_t {
+		NO_PACKET = -1,
+		CONNECT = 0,
+		DISCONNECT = 1,
+		EVENT = 2,
+		ACK = 3,
+		CONNECT_ERROR = 4,
+		BINARY_EVENT = 5,
+		BINARY_ACK = 6
+	};
+
+	struct Frame {
+		FrameType frameType = INVALID_FRAME;
+		PacketType packetType = NO_PACKET;
+		// -1 when the packet doesn't request an acknowledgement.
+		int64_t ackId = -1;
+		// Empty for the default namespace.
+		std::string_view nsp;
+		// Everything after the type digits, namespace and ack id.
+		std::string_view body;
+		// For EVENT packets: the event name, without quotes.
+		std::string_view eventName;
+		// For EVENT packets: the raw JSON text of the arguments following the name.
+		// Empty when the event was sent without data.
+		std::string_view payload;
+		// Set when the name contains escape sequences, or the array couldn't be
+		// split in place. The name is then unusable and the body has to be parsed.
+		bool needsFullParse = false;
+	};
+
+	/**
+	 * Decodes a websocket text frame in place.
+	 *
+	 * @param message   The full websocket message.
+	 * @param frame     The frame to fill in.
+	 * @returns         false if the message doesn't start with a valid frame type.
+	 */
+	bool decode(std::string_view message, Frame& frame);
+
+	/**
+	 * Splits the body of an EVENT packet (`["name",data]`) into its name and payload.
+	 *
+	 * @returns          false if the body isn't an array starting with a string.
+	 */
+	bool splitEvent(std::string_view body, Frame& frame);
+}
+
+#endif /* ALBOT_FRAMEPARSER_HPP_ */
@@ -0,0 +1,112 @@
+#pragma once
+
+#ifndef ALBOT_LATENCY_HISTOGRAM_HPP_
+#define ALBOT_LATENCY_HISTOGRAM_HPP_
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * A fixed-size, HDR-style histogram of durations, in microseconds.
+ *
+ * Values under 16 us get a bucket each. Above that every power of two is split into 16 buckets,
+ * so any value is reported within 1/16 (about 6%) of what was recorded, from 1 us up to
+ * about an hour. Larger values are counted in the last bucket.
+ *
+ * Recording and reading are both lock free: every bucket is an atomic counter. A reader running
+ * alongside a writer may see a value that is counted but not yet in its bucket, so percentiles
+ * are approximate while samples are coming in, which is fine for monitoring.
+ */
+class LatencyHistogram {
+	private:
+		static constexpr size_t SUB_BUCKETS = 16;
+		static constexpr size_t SUB_BUCKET_BITS = 4;
+		// Powers of two above the linear range, up to 2^32 us.
+		static constexpr size_t MAGNITUDES = 32 - SUB_BUCKET_BITS + 1;
+		static constexpr size_t BUCKET_COUNT = SUB_BUCKETS * (MAGNITUDES + 1);
+
+		std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets = {};
+		std::atomic<uint64_t> count = 0;
+		std::atomic<uint64_t> sum = 0;
+		std::atomic<uint64_t> max = 0;
+
+		static size_t indexOf(uint64_t micros) {
+			if (micros < SUB_BUCKETS) {
+				return micros;
+			}
+			size_t magnitude = std::bit_width(micros) - 1;
+			size_t shift = magnitude - SUB_BUCKET_BITS;
+			size_t index = (shift + 1) * SUB_BUCKETS + ((micros >> shift) & (SUB_BUCKETS - 1));
+			return index < BUCKET_COUNT ? index : BUCKET_COUNT - 1;
+		}
+		/**
+		 * The largest value that lands in the bucket, like HdrHistogram's highestEquivalentValue.
+		 */
+		static uint64_t highestIn(size_t index) {
+			if (index < SUB_BUCKETS) {
+				return index;
+			}
+			size_t shift = index / SUB_BUCKETS - 1;
+			uint64_t lowest = (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+			return lowest + (uint64_t(1) << shift) - 1;
+		}
+	public:
+		void record(std::chrono::nanoseconds duration) {
+			uint64_t micros = duration.count() < 0 ? 0 : uint64_t(duration.count()) / 1000;
+			buckets[indexOf(micros)].fetch_add(1, std::memory_order_relaxed);
+			sum.fetch_add(micros, std::memory_order_relaxed);
+			uint64_t previous = max.load(std::memory_order_relaxed);
+			while (micros > previous && !max.compare_exchange_weak(previous, micros, std::memory_order_relaxed)) {
+			}
+			count.fetch_add(1, std::memory_order_release);
+		}
+
+		uint64_t getCount() const {
+			return count.load(std::memory_order_acquire);
+		}
+		std::chrono::microseconds getMax() const {
+			return std::chrono::microseconds(max.load(std::memory_order_relaxed));
+		}
+		std::chrono::microseconds getMean() const {
+			uint64_t samples = getCount();
+			return std::chrono::microseconds(samples == 0 ? 0 : sum.load(std::memory_order_relaxed) / samples);
+		}
+		/**
+		 * @param percentile  Between 0 and 100, e.g. 50 for the median or 99 for p99.
+		 * @returns           The value at or below which that share of samples fall, 0 without samples.
+		 */
+		std::chrono::microseconds getPercentile(double percentile) const {
+			uint64_t samples = getCount();
+			if (samples == 0) {
+				return std::chrono::microseconds(0);
+			}
+			uint64_t rank = uint64_t(percentile / 100.0 * double(samples) + 0.5);
+			rank = rank < 1 ? 1 : (rank > samples ? samples : rank);
+			uint64_t seen = 0;
+			for (size_t i = 0; i < BUCKET_COUNT; i++) {
+				seen += buckets[i].load(std::memory_order_relaxed);
+				if (seen >= rank) {
+					uint64_t highest = highestIn(i);
+					uint64_t maximum = getMax().count();
+					return std::chrono::microseconds(highest < maximum ? highest : maximum);
+				}
+			}
+			return getMax();
+		}
+		/**
+		 * Not atomic as a whole: samples recorded during a reset may be partially kept.
+		 */
+		void reset() {
+			for (auto& bucket : buckets) {
+				bucket.store(0, std::memory_order_relaxed);
+			}
+			sum = 0;
+			max = 0;
+			count = 0;
+		}
+};
+
+#endif /* ALBOT_LATENCY_HISTOGRAM_HPP_ */
@@ -3,48 +3,163 @@
 
 // Credits to LunarWatcher aka Zoe for this class.
 #include "uvw.hpp"
-#include <mutex>
+#include "albot/Utils/Reactor.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 class LoopHelper {
-	private:
-		std::shared_ptr<uvw::Loop> loop;
 	public:
 		using RawTimerCallback = std::function<void(const uvw::TimerEvent&, uvw::TimerHandle&)>;
 		using TimerCallback = std::function<void()>;
 		using Millis = std::chrono::milliseconds;
+	private:
+		std::shared_ptr<uvw::Loop> loop;
+		// Set when the loop is shared with other helpers and runs on the reactor's thread. Anything
+		// that touches the loop from another thread is posted there.
+		Reactor* reactor = nullptr;
+		struct Timer {
+			std::weak_ptr<uvw::TimerHandle> handle;
+			// 0 for timeouts.
+			Millis repeat;
+			// Left until the next call as of pause(). Timeouts also keep the loop time they're due at.
+			Millis remaining;
+			Millis due;
+		};
+		// Everything this helper started that hasn't been closed, so pause and closeAll can get
+		// to it without touching other helpers' handles on a shared loop.
+		std::vector<Timer> timers;
+		std::vector<std::weak_ptr<uvw::CheckHandle>> checks;
+		// While paused, every timer and check is stopped, and started again on resume.
+		std::atomic<bool> paused = false;
 
-		LoopHelper() : loop(uvw::Loop::create()){ }
+		// A loop of our own gets posted work the way Reactor does: a queue, and one AsyncHandle
+		// created up front to wake the loop. Creating a handle per call from another thread would
+		// race with whoever is running the loop.
+		std::shared_ptr<uvw::AsyncHandle> wakeup;
+		std::mutex queueMutex;
+		std::vector<std::function<void()>> queue;
+		// The thread that last ran our own loop, unset until run() is first called.
+		std::atomic<std::thread::id> loopThread;
 
+		void drain() {
+			std::vector<std::function<void()>> work;
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				work.swap(queue);
+			}
+			for (auto& function : work) {
+				function();
+			}
+		}
+		void post(std::function<void()> work) {
+			if (reactor != nullptr) {
+				reactor->post(std::move(work));
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				queue.push_back(std::move(work));
+			}
+			wakeup->send();
+		}
 		/**
-		 * Sets a timeout.
-		 *
-		 * @param callback   The function to call
-		 * @param timeout    The amount of time to wait before the callback is executed.
-		 *
-		 * @returns          A timer pointer you can access. Note that using it isn't required.
+		 * Whether the loop can be touched from this thread right now: it's the thread running the
+		 * loop, or the loop is our own and nothing has run it yet.
 		 */
-		std::shared_ptr<uvw::TimerHandle> setRawTimeout(RawTimerCallback callback, int timeout) {
+		bool canTouchLoop() const {
+			if (reactor != nullptr) {
+				return reactor->isLoopThread();
+			}
+			const std::thread::id thread = loopThread.load();
+			return thread == std::thread::id() || thread == std::this_thread::get_id();
+		}
+		/**
+		 * Runs the function now if this thread can touch the loop, otherwise posts it to the loop.
+		 */
+		void onLoop(std::function<void()> work) {
+			if (canTouchLoop()) {
+				work();
+			} else {
+				post(std::move(work));
+			}
+		}
+		void startTimer(std::shared_ptr<uvw::TimerHandle> timer, Millis timeout, Millis repeat) {
+			std::erase_if(timers, [](const Timer& tracked) {
+				return tracked.handle.expired();
+			});
+			timers.push_back({ timer, repeat, timeout, std::chrono::duration_cast<Millis>(loop->now()) + timeout });
+			if (!paused) {
+				timer->start(timeout, repeat);
+			}
+		}
+		std::shared_ptr<uvw::TimerHandle> createTimeout(RawTimerCallback callback, int timeout) {
 			auto timer = loop->resource<uvw::TimerHandle>();
 			timer->on<uvw::TimerEvent>([callback](const uvw::TimerEvent& event, auto& handle) {
 				callback(event, handle);
 				handle.close();
 				handle.stop();
 			});
-			timer->start(Millis(timeout), Millis(0));
+			startTimer(timer, Millis(timeout), Millis(0));
 			return timer;
 		}
-
-		void setTimeout(TimerCallback callback, int timeout) {
+		std::shared_ptr<uvw::TimerHandle> createInterval(RawTimerCallback callback, int interval, int timeout) {
 			auto timer = loop->resource<uvw::TimerHandle>();
 			timer->on<uvw::TimerEvent>([callback](const uvw::TimerEvent& event, auto& handle) {
-				callback();
-				handle.close();
-				handle.stop();
+				callback(event, handle);
+			});
+			startTimer(timer, Millis(timeout), Millis(interval));
+			return timer;
+		}
+	public:
+		LoopHelper() : LoopHelper(nullptr) { }
+		/**
+		 * Schedules onto the reactor's loop, or onto a loop of its own if reactor is nullptr.
+		 */
+		explicit LoopHelper(Reactor* reactor) : loop(reactor == nullptr ? uvw::Loop::create() : reactor->getLoop()), reactor(reactor) {
+			if (reactor == nullptr) {
+				// Nothing runs the loop yet, so this is the one time another thread can create a handle.
+				wakeup = loop->resource<uvw::AsyncHandle>();
+				wakeup->on<uvw::AsyncEvent>([this](const uvw::AsyncEvent&, uvw::AsyncHandle&) {
+					drain();
+				});
+				// Timers keep the loop alive, not this.
+				wakeup->unreference();
+			}
+		}
+
+		/**
+		 * Sets a timeout.
+		 *
+		 * @param callback   The function to call
+		 * @param timeout    The amount of time to wait before the callback is executed.
+		 *
+		 * @returns          A timer pointer you can access. Note that using it isn't required. Called from
+		 *                   a thread other than the one running the loop, the timer is created on the loop's
+		 *                   thread later, and this returns nullptr.
+		 */
+		std::shared_ptr<uvw::TimerHandle> setRawTimeout(RawTimerCallback callback, int timeout) {
+			if (!canTouchLoop()) {
+				post([this, callback, timeout]() {
+					createTimeout(callback, timeout);
+				});
+				return nullptr;
+			}
+			return createTimeout(callback, timeout);
+		}
+
+		void setTimeout(TimerCallback callback, int timeout) {
+			onLoop([this, callback, timeout]() {
+				createTimeout([callback](const uvw::TimerEvent&, uvw::TimerHandle&) {
+					callback();
+				}, timeout);
 			});
-			timer->start(Millis(timeout), Millis(0));
 		}
 
 		/**
@@ -54,23 +169,41 @@ class LoopHelper {
 		 * @param interval    The rate to call the function at, in milliseconds
 		 * @param timeout     The timeout before the first call
 		 * @returns           A timer pointer you can access. Note that using it isn't required. The handle is also passed
-		 *                    to the callback as the second parameter
+		 *                    to the callback as the second parameter. nullptr from outside the loop's thread, like
+		 *                    setRawTimeout.
 		 */
 		std::shared_ptr<uvw::TimerHandle> setRawInterval(RawTimerCallback callback, int interval, int timeout = -1) {
 			if (timeout < 0) timeout = interval;
 
-			auto timer = loop->resource<uvw::TimerHandle>();
-			timer->on<uvw::TimerEvent>(callback);
-			timer->start(Millis(timeout), Millis(interval));
-
-			return timer;
+			if (!canTouchLoop()) {
+				post([this, callback, interval, timeout]() {
+					createInterval(callback, interval, timeout);
+				});
+				return nullptr;
+			}
+			return createInterval(callback, interval, timeout);
 		}
 		void setInterval(TimerCallback callback, int interval) {
-			auto timer = loop->resource<uvw::TimerHandle>();
-			timer->on<uvw::TimerEvent>([callback](const uvw::TimerEvent& event, auto& handle) {
-				callback();
+			onLoop([this, callback, interval]() {
+				createInterval([callback](const uvw::TimerEvent&, uvw::TimerHandle&) {
+					callback();
+				}, interval, interval);
+			});
+		}
+		/**
+		 * Calls the function once per loop iteration, right after I/O has been processed.
+		 */
+		void setCheck(TimerCallback callback) {
+			onLoop([this, callback]() {
+				auto check = loop->resource<uvw::CheckHandle>();
+				check->on<uvw::CheckEvent>([callback](const uvw::CheckEvent& event, auto& handle) {
+					callback();
+				});
+				if (!paused) {
+					check->start();
+				}
+				checks.push_back(check);
 			});
-			timer->start(Millis(interval), Millis(interval));
 		}
 
 		/**
@@ -80,6 +213,12 @@ class LoopHelper {
 		 * @returns          A canceleable WorkReq
 		 */
 		std::shared_ptr<uvw::WorkReq> createJob(std::function<void()> callback) {
+			if (!canTouchLoop()) {
+				post([this, callback]() {
+					loop->resource<uvw::WorkReq>(callback)->queue();
+				});
+				return nullptr;
+			}
 			auto job = loop->resource<uvw::WorkReq>(callback);
 			job->queue();
 			return job;
@@ -94,26 +233,95 @@ class LoopHelper {
 		 * sure). For an instance, you might end up with
 		 */
 		void execRaw(std::function<void(const uvw::AsyncEvent& event, uvw::AsyncHandle& handle)> callback) {
-			auto asyncHandle = loop->resource<uvw::AsyncHandle>();
-			asyncHandle->on<uvw::AsyncEvent>([callback](const auto& evt, auto& handle) {
-				callback(evt, handle);
-				handle.close();
+			onLoop([this, callback]() {
+				auto asyncHandle = loop->resource<uvw::AsyncHandle>();
+				asyncHandle->on<uvw::AsyncEvent>([callback](const auto& evt, auto& handle) {
+					callback(evt, handle);
+					handle.close();
+				});
+				asyncHandle->send();
 			});
-			asyncHandle->send();
 		}
 		void exec(std::function<void()> callback) {
-			auto asyncHandle = loop->resource<uvw::AsyncHandle>();
-			asyncHandle->on<uvw::AsyncEvent>([callback](const auto& evt, auto& handle) {
-				callback();
-				handle.close();
-			});
-			asyncHandle->send();
+			post(std::move(callback));
 		}
 
 		void run() {
+			loopThread = std::this_thread::get_id();
 			loop->run<uvw::Loop::Mode::ONCE>();
 		}
 
+		/**
+		 * Stops every timer and check of this helper until resume(). Timeouts keep the time they had
+		 * left, intervals start over.
+		 */
+		void pause() {
+			if (paused.exchange(true)) {
+				return;
+			}
+			onLoop([this]() {
+				const Millis now = std::chrono::duration_cast<Millis>(loop->now());
+				for (Timer& timer : timers) {
+					auto handle = timer.handle.lock();
+					if (!handle || handle->closing() || !handle->active()) {
+						continue;
+					}
+					handle->stop();
+					timer.remaining = timer.repeat.count() > 0 ? timer.repeat : std::max(Millis(0), timer.due - now);
+				}
+				for (auto& weak : checks) {
+					if (auto check = weak.lock(); check && !check->closing()) {
+						check->stop();
+					}
+				}
+			});
+		}
+		void resume() {
+			if (!paused.exchange(false)) {
+				return;
+			}
+			onLoop([this]() {
+				const Millis now = std::chrono::duration_cast<Millis>(loop->now());
+				for (Timer& timer : timers) {
+					auto handle = timer.handle.lock();
+					if (!handle || handle->closing() || handle->active()) {
+						continue;
+					}
+					timer.due = now + timer.remaining;
+					handle->start(timer.remaining, timer.repeat);
+				}
+				for (auto& weak : checks) {
+					if (auto check = weak.lock(); check && !check->closing()) {
+						check->start();
+					}
+				}
+			});
+		}
+		bool isPaused() const {
+			return paused;
+		}
+		bool isShared() const {
+			return reactor != nullptr;
+		}
+		/**
+		 * Closes every timer and check this helper started. Only needed on shared loops,
+		 * a dedicated loop just stops being run. Must be called from the loop's thread.
+		 */
+		void closeAll() {
+			for (auto& timer : timers) {
+				if (auto handle = timer.handle.lock(); handle && !handle->closing()) {
+					handle->close();
+				}
+			}
+			timers.clear();
+			for (auto& weak : checks) {
+				if (auto check = weak.lock(); check && !check->closing()) {
+					check->close();
+				}
+			}
+			checks.clear();
+		}
+
 		/**
 		 * This method should only be used for extensions on uvw not defined by this class.
 		 */
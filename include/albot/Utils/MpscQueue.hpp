@@ -0,0 +1,108 @@
+#pragma once
+
+#ifndef ALBOT_MPSC_QUEUE_HPP_
+#define ALBOT_MPSC_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/**
+ * A bounded, lock-free queue for any number of producers and a single consumer.
+ *
+ * This is Dmitry Vyukov's bounded queue: every cell carries a sequence number that tells
+ * producers whether it's free and the consumer whether it's been filled, so neither side
+ * ever waits on the other. When it's full, push fails instead of blocking.
+ */
+template <typename T>
+class MpscQueue {
+	private:
+		struct Cell {
+			std::atomic<size_t> sequence;
+			T value;
+		};
+		std::unique_ptr<Cell[]> cells;
+		size_t mask;
+		// Kept on separate cache lines, producers and the consumer don't share a line.
+		alignas(64) std::atomic<size_t> head = 0;
+		alignas(64) std::atomic<size_t> tail = 0;
+	public:
+		/**
+		 * @param capacity  Rounded up to a power of two.
+		 */
+		explicit MpscQueue(size_t capacity) {
+			size_t size = 2;
+			while (size < capacity) {
+				size <<= 1;
+			}
+			cells = std::make_unique<Cell[]>(size);
+			mask = size - 1;
+			for (size_t i = 0; i < size; i++) {
+				cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+		MpscQueue(const MpscQueue&) = delete;
+		MpscQueue& operator=(const MpscQueue&) = delete;
+
+		/**
+		 * Safe to call from any thread.
+		 *
+		 * @returns  false if the queue is full. The value is left untouched.
+		 */
+		bool push(T&& value) {
+			size_t position = head.load(std::memory_order_relaxed);
+			Cell* cell;
+			while (true) {
+				cell = &cells[position & mask];
+				size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				intptr_t difference = intptr_t(sequence) - intptr_t(position);
+				if (difference == 0) {
+					if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						break;
+					}
+				} else if (difference < 0) {
+					return false;
+				} else {
+					position = head.load(std::memory_order_relaxed);
+				}
+			}
+			cell->value = std::move(value);
+			cell->sequence.store(position + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * Consumer thread only.
+		 *
+		 * @returns  false if there was nothing to take.
+		 */
+		bool pop(T& out) {
+			size_t position = tail.load(std::memory_order_relaxed);
+			Cell& cell = cells[position & mask];
+			if (cell.sequence.load(std::memory_order_acquire) != position + 1) {
+				return false;
+			}
+			out = std::move(cell.value);
+			// Don't hold on to whatever the value owns until the cell comes around again.
+			cell.value = T();
+			cell.sequence.store(position + mask + 1, std::memory_order_release);
+			tail.store(position + 1, std::memory_order_relaxed);
+			return true;
+		}
+
+		/**
+		 * Approximate while producers are pushing.
+		 */
+		size_t size() const {
+			size_t taken = tail.load(std::memory_order_relaxed);
+			size_t pushed = head.load(std::memory_order_relaxed);
+			return pushed > taken ? pushed - taken : 0;
+		}
+		size_t capacity() const {
+			return mask + 1;
+		}
+};
+
+#endif /* ALBOT_MPSC_QUEUE_HPP_ */
@@ -0,0 +1,162 @@
+#pragma once
+
+#ifndef ALBOT_RATE_GOVERNOR_HPP_
+#define ALBOT_RATE_GOVERNOR_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <string_view>
+
+#include "albot/Utils/Timer.hpp"
+
+/**
+ * Token buckets in front of everything a socket sends, so the client slows itself down
+ * before the server throttles (or disconnects) it.
+ *
+ * Every event goes through the global bucket, and through its own bucket if it has a limit.
+ * The last `criticalReserve` tokens of the global bucket can only be spent by critical events,
+ * so heals and potions still go out when everything else is being held back.
+ *
+ * Not thread safe, except for the metrics: the socket only uses it while holding its send lock.
+ */
+class RateGovernor {
+	public:
+		enum Priority : uint8_t {
+			// Sent as soon as there's any token left. Heals, potions, login.
+			CRITICAL,
+			// Delayed until there are tokens to spare.
+			NORMAL,
+			// Dropped when there are no tokens to spare.
+			LOW,
+			PRIORITY_COUNT
+		};
+		enum Decision : uint8_t {
+			SEND,
+			DELAY,
+			DROP
+		};
+		struct Limit {
+			double perSecond;
+			double burst;
+		};
+	private:
+		struct Bucket {
+			Limit limit;
+			double tokens;
+			Types::TimePoint last;
+
+			Bucket(Limit limit) : limit(limit), tokens(limit.burst), last(Types::Clock::now()) {
+			}
+			void refill(Types::TimePoint now) {
+				double seconds = std::chrono::duration<double>(now - last).count();
+				if (seconds > 0) {
+					tokens = std::min(limit.burst, tokens + seconds * limit.perSecond);
+					last = now;
+				}
+			}
+		};
+		Bucket global;
+		double criticalReserve;
+		std::map<std::string, Bucket, std::less<>> events;
+		std::map<std::string, Priority, std::less<>> priorities;
+
+		std::array<std::atomic<size_t>, PRIORITY_COUNT> sent = {};
+		std::array<std::atomic<size_t>, PRIORITY_COUNT> delayed = {};
+		std::array<std::atomic<size_t>, PRIORITY_COUNT> dropped = {};
+	public:
+		// A delayed command older than this is dropped instead of sent late. Critical commands are
+		// never dropped, a late heal is still better than none.
+		std::chrono::milliseconds maxDelay = std::chrono::milliseconds(1000);
+
+		/**
+		 * The defaults stay well under what Adventure Land tolerates from a single character.
+		 *
+		 * @param global           The limit over every event combined.
+		 * @param criticalReserve  Tokens of the global bucket only critical events may use.
+		 */
+		RateGovernor(Limit global = { 25, 50 }, double criticalReserve = 10) : global(global), criticalReserve(criticalReserve) {
+			setLimit("move", { 10, 20 });
+			setPriority("heal", CRITICAL);
+			setPriority("use", CRITICAL);
+			setPriority("auth", CRITICAL);
+			setPriority("loaded", CRITICAL);
+			setPriority("say", LOW);
+			setPriority("emotion", LOW);
+			setPriority("ping_trig", LOW);
+		}
+
+		void setLimit(std::string_view event, Limit limit) {
+			events.insert_or_assign(std::string(event), Bucket(limit));
+		}
+		void setPriority(std::string_view event, Priority priority) {
+			priorities.insert_or_assign(std::string(event), priority);
+		}
+		/**
+		 * @returns  The priority set for the event, NORMAL if none was.
+		 */
+		Priority getPriority(std::string_view event) const {
+			auto it = priorities.find(event);
+			return it == priorities.end() ? NORMAL : it->second;
+		}
+
+		/**
+		 * Takes a token for the event if the buckets allow it.
+		 *
+		 * @returns  SEND if a token was taken. Otherwise DROP for low priority events, DELAY for the rest.
+		 */
+		Decision acquire(std::string_view event, Priority priority, Types::TimePoint now = Types::Clock::now()) {
+			global.refill(now);
+			Bucket* bucket = nullptr;
+			auto it = events.find(event);
+			if (it != events.end()) {
+				bucket = &it->second;
+				bucket->refill(now);
+			}
+			double floor = priority == CRITICAL ? 0 : criticalReserve;
+			if (global.tokens < floor + 1 || (bucket != nullptr && bucket->tokens < 1)) {
+				if (priority == LOW) {
+					dropped[priority]++;
+					return DROP;
+				}
+				delayed[priority]++;
+				return DELAY;
+			}
+			global.tokens -= 1;
+			if (bucket != nullptr) {
+				bucket->tokens -= 1;
+			}
+			sent[priority]++;
+			return SEND;
+		}
+		/**
+		 * @returns  Whether a command that has waited this long should be given up on, see maxDelay.
+		 */
+		bool hasExpired(Priority priority, Types::Clock::duration waited) const {
+			return priority != CRITICAL && waited > maxDelay;
+		}
+		/**
+		 * Records a delayed command that was given up on, see maxDelay.
+		 */
+		void expire(Priority priority) {
+			dropped[priority]++;
+		}
+
+		size_t getSentCount(Priority priority) const {
+			return sent[priority];
+		}
+		/**
+		 * Counts every time a command had to wait for a flush, so one command can be counted several times.
+		 */
+		size_t getDelayedCount(Priority priority) const {
+			return delayed[priority];
+		}
+		size_t getDroppedCount(Priority priority) const {
+			return dropped[priority];
+		}
+};
+
+#endif /* ALBOT_RATE_GOVERNOR_HPP_ */
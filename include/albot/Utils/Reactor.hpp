@@ -0,0 +1,90 @@
+#pragma once
+
+#ifndef ALBOT_REACTOR_HPP_
+#define ALBOT_REACTOR_HPP_
+
+#include "uvw.hpp"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * One libuv loop, and one thread running it, shared by every bot that opts in.
+ *
+ * Without it each BotSkeleton runs its own loop on its own thread. With it, the bots' timers
+ * and per-iteration flushes all live on this loop, so N characters cost one loop thread instead
+ * of N. Only the loop threads are shared: every websocket still runs its own IXWebSocket thread,
+ * since IXWebSocket can't be driven from an outside event loop.
+ *
+ * The thread blocks in the loop until something is due. libuv isn't thread safe, so other
+ * threads never touch the loop: they post() their work, which wakes the loop and runs there.
+ */
+class Reactor {
+	private:
+		std::shared_ptr<uvw::Loop> loop;
+		// Wakes the loop up to run what was posted. Also keeps it running while nothing else is due.
+		std::shared_ptr<uvw::AsyncHandle> wakeup;
+		std::mutex queueMutex;
+		std::vector<std::function<void()>> queue;
+		// Held while starting the thread, and by the thread while it decides to exit.
+		std::mutex stateMutex;
+		std::thread thread;
+		bool running = false;
+		std::atomic<bool> exiting = false;
+		std::atomic<std::thread::id> loopThread;
+		std::atomic<size_t> attached = 0;
+
+		Reactor();
+		void runLoop();
+		void drain();
+	public:
+		Reactor(const Reactor&) = delete;
+		Reactor& operator=(const Reactor&) = delete;
+		~Reactor();
+
+		/**
+		 * The reactor every bot in this process shares.
+		 */
+		static Reactor& shared();
+
+		/**
+		 * Only to be used from the loop's thread, see isLoopThread().
+		 */
+		std::shared_ptr<uvw::Loop> getLoop() {
+			return loop;
+		}
+		/**
+		 * Runs the function on the loop's thread, in the order it was posted. Work posted while the
+		 * reactor isn't running waits for start().
+		 */
+		void post(std::function<void()> work);
+		bool isLoopThread() const {
+			return std::this_thread::get_id() == loopThread.load();
+		}
+		/**
+		 * Registers a bot. The reactor keeps running until every attached bot has detached.
+		 */
+		void attach();
+		void detach();
+		/**
+		 * Starts the reactor thread, if it isn't running yet. Once every bot has detached the
+		 * thread exits, and the next start() replaces it.
+		 */
+		void start();
+		/**
+		 * The thread running the loop, for callers that want to wait on it.
+		 * Every bot on the reactor hands out the same thread, so check joinable() before joining.
+		 */
+		std::thread& getThread() {
+			return thread;
+		}
+		size_t getAttachedCount() const {
+			return attached;
+		}
+};
+
+#endif /* ALBOT_REACTOR_HPP_ */
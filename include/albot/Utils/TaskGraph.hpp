@@ -0,0 +1,178 @@
+#pragma once
+
+#ifndef ALBOT_TASKGRAPH_HPP_
+#define ALBOT_TASKGRAPH_HPP_
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Tasks with dependencies between them, each started on a thread of its own as soon as everything
+ * it depends on has succeeded. A task fails by returning false or throwing; whatever depends on a
+ * failed task is skipped.
+ *
+ * Every task is timed from the start of run(), and the timings are logged once everything is done.
+ */
+class TaskGraph {
+	public:
+		typedef size_t Id;
+
+		enum State {
+			PENDING,
+			RUNNING,
+			SUCCEEDED,
+			FAILED,
+			SKIPPED
+		};
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		struct Task {
+			std::string name;
+			std::function<bool()> work;
+			std::vector<Id> dependencies;
+			State state = PENDING;
+			// In milliseconds since run() started.
+			double startedAt = 0;
+			double finishedAt = 0;
+		};
+
+		std::shared_ptr<spdlog::logger> logger;
+		std::vector<Task> tasks;
+		std::mutex mutex;
+		std::condition_variable finished;
+		Clock::time_point start;
+
+		double now() const {
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+
+		/**
+		 * @returns  PENDING while a dependency still has to finish, SUCCEEDED once all of them have,
+		 *           or SKIPPED if one didn't.
+		 */
+		State readiness(const Task& task) const {
+			State readiness = SUCCEEDED;
+			for (Id dependency : task.dependencies) {
+				switch (tasks[dependency].state) {
+					case FAILED:
+					case SKIPPED:
+						return SKIPPED;
+					case SUCCEEDED:
+						break;
+					default:
+						readiness = PENDING;
+				}
+			}
+			return readiness;
+		}
+
+		void execute(Id id) {
+			bool succeeded = false;
+			try {
+				succeeded = tasks[id].work();
+			} catch (const std::exception& e) {
+				logger->error("{} threw: {}", tasks[id].name, e.what());
+			} catch (...) {
+				logger->error("{} threw.", tasks[id].name);
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			Task& task = tasks[id];
+			task.finishedAt = now();
+			task.state = succeeded ? SUCCEEDED : FAILED;
+			if (succeeded) {
+				logger->info("{} done in {:.1f} ms.", task.name, task.finishedAt - task.startedAt);
+			} else {
+				logger->error("{} failed after {:.1f} ms.", task.name, task.finishedAt - task.startedAt);
+			}
+			finished.notify_all();
+		}
+	public:
+		explicit TaskGraph(std::shared_ptr<spdlog::logger> logger) : logger(std::move(logger)) {}
+
+		/**
+		 * Adds a task. It can only depend on tasks added before it, which also rules out cycles.
+		 */
+		Id add(std::string name, std::function<bool()> work, std::vector<Id> dependencies = {}) {
+			tasks.push_back({ std::move(name), std::move(work), std::move(dependencies) });
+			return tasks.size() - 1;
+		}
+
+		State getState(Id id) const {
+			return tasks[id].state;
+		}
+
+		/**
+		 * Runs every task and waits for all of them.
+		 *
+		 * @returns  Whether every task succeeded.
+		 */
+		bool run() {
+			std::vector<std::thread> threads;
+			std::unique_lock<std::mutex> lock(mutex);
+			start = Clock::now();
+			while (true) {
+				bool progressed = true;
+				// Skipping a task can make others skippable, so go over them until nothing changes.
+				while (progressed) {
+					progressed = false;
+					for (Id id = 0; id < tasks.size(); id++) {
+						Task& task = tasks[id];
+						if (task.state != PENDING) {
+							continue;
+						}
+						const State readiness = this->readiness(task);
+						if (readiness == SKIPPED) {
+							task.state = SKIPPED;
+							logger->warn("Skipping {}, something it needs failed.", task.name);
+							progressed = true;
+						} else if (readiness == SUCCEEDED) {
+							task.state = RUNNING;
+							task.startedAt = now();
+							threads.emplace_back(&TaskGraph::execute, this, id);
+						}
+					}
+				}
+				bool running = false;
+				for (const Task& task : tasks) {
+					running |= task.state == RUNNING;
+				}
+				if (!running) {
+					break;
+				}
+				finished.wait(lock);
+			}
+			lock.unlock();
+			for (std::thread& thread : threads) {
+				thread.join();
+			}
+
+			bool succeeded = true;
+			double total = 0;
+			logger->info("{:<32} {:>10} {:>10}", "Task", "started", "took");
+			for (const Task& task : tasks) {
+				if (task.state == SUCCEEDED || task.state == FAILED) {
+					logger->info("{:<32} {:>7.1f} ms {:>7.1f} ms{}", task.name, task.startedAt, task.finishedAt - task.startedAt,
+						task.state == FAILED ? " (failed)" : "");
+					total = std::max(total, task.finishedAt);
+				} else {
+					logger->info("{:<32} {:>10} {:>10}", task.name, "-", "skipped");
+				}
+				succeeded &= task.state == SUCCEEDED;
+			}
+			logger->info("Everything took {:.1f} ms.", total);
+			return succeeded;
+		}
+};
+
+#endif /* ALBOT_TASKGRAPH_HPP_ */
@@ -0,0 +1,89 @@
+#pragma once
+
+#ifndef ALBOT_WIRECAPTURE_HPP_
+#define ALBOT_WIRECAPTURE_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+/**
+ * A compact binary log of raw websocket frames, for reproducing real traffic offline.
+ *
+ * The file starts with the magic `ALWC` and a u32 version. Every record after that is:
+ *
+ *     u8 direction | u64 nanoseconds since the capture started | u64 character id | u32 size | size bytes
+ *
+ * All integers are little endian. Timestamps come from a monotonic clock.
+ */
+namespace WireCapture {
+	enum Direction : uint8_t {
+		INBOUND = 0,
+		OUTBOUND = 1
+	};
+
+	struct Record {
+		Direction direction;
+		std::chrono::nanoseconds time;
+		uint64_t characterId;
+		std::string frame;
+	};
+
+	class Recorder {
+		private:
+			std::mutex guard;
+			std::ofstream out;
+			std::chrono::steady_clock::time_point start;
+		public:
+			explicit Recorder(const std::string& path);
+
+			/**
+			 * Every socket recording to the same path shares one recorder, so several
+			 * characters end up interleaved in a single capture.
+			 */
+			static std::shared_ptr<Recorder> open(const std::string& path);
+
+			bool isOpen() const {
+				return out.is_open();
+			}
+			/**
+			 * Appends a frame. Safe to call from any thread.
+			 */
+			void write(Direction direction, uint64_t characterId, std::string_view frame);
+			void flush();
+	};
+
+	class Reader {
+		private:
+			std::ifstream in;
+			bool valid = false;
+		public:
+			explicit Reader(const std::string& path);
+
+			/**
+			 * @returns  false if the file couldn't be opened, or isn't a capture of a supported version.
+			 */
+			bool isValid() const {
+				return valid;
+			}
+			/**
+			 * @returns  false at the end of the capture, or on a truncated record.
+			 */
+			bool next(Record& record);
+	};
+
+	/**
+	 * Feeds every record of the capture to `callback`, in order.
+	 *
+	 * @param realtime  Wait between records as long as was recorded, instead of going as fast as possible.
+	 * @returns         The number of records replayed.
+	 */
+	size_t replay(Reader& reader, bool realtime, const std::function<void(const Record&)>& callback);
+}
+
+#endif /* ALBOT_WIRECAPTURE_HPP_ */
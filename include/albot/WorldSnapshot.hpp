@@ -0,0 +1,31 @@
+#pragma once
+
+#ifndef ALBOT_WORLDSNAPSHOT_HPP_
+#define ALBOT_WORLDSNAPSHOT_HPP_
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "albot/EntityStore.hpp"
+#include "albot/Utils/Timer.hpp"
+
+/**
+ * The world as one bot saw it at the end of a tick. Published by the bot's loop, see
+ * SocketWrapper::getSnapshot. Never modified once published, so any thread can read it
+ * for as long as it holds on to it.
+ */
+struct WorldSnapshot {
+	// Counts the snapshots published by the socket, starting at 1.
+	uint64_t tick = 0;
+	// The journal generation the snapshot was taken in, see ChangeJournal.
+	uint64_t generation = 0;
+	Types::TimePoint takenAt;
+	nlohmann::json character;
+	EntityStore entities;
+	std::map<std::string, nlohmann::json> chests;
+};
+
+#endif /* ALBOT_WORLDSNAPSHOT_HPP_ */
@@ -38,9 +38,9 @@ namespace ALBot {
 
 	extern void build_code(const std::string& name, const std::vector<std::string> names, const std::vector<ClassEnum::CLASS>& classes);
 
-	extern void start_service(int index);
+	extern bool start_service(int index);
 
-	extern void start_character(int index);
+	extern bool start_character(int index);
 
 	extern void login();
 };
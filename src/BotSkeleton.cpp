@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <condition_variable>
+#include <functional>
 #include <iostream>
 #include <string>
 
@@ -7,73 +9,52 @@
 #include "albot/MovementMath.hpp"
 #include "albot/Utils/ParsingUtils.hpp"
 
-BotSkeleton::BotSkeleton(const CharacterGameInfo& id): Bot(id), loop(), wrapper(std::to_string(info.character->id), this->info.server->url, *this), uvThread([this]() {
-			while (running) {
-				loop_running.wait(false); // wait until it has changed FROM false to true.
-				if(!running) {
-					break;
-				}
-				loop.run();
-				std::this_thread::sleep_for(std::chrono::milliseconds(1));
-			}
-			this->disconnect();
-		}) {
+BotSkeleton::BotSkeleton(const CharacterGameInfo& id): Bot(id),
+		loop(id.sharedReactor ? &Reactor::shared() : nullptr),
+		wrapper(std::to_string(info.character->id), this->info.server->url, *this),
+		uvThread(id.sharedReactor ? std::thread() : std::thread(&BotSkeleton::runDedicatedLoop, this)) {
+    if (loop.isShared()) {
+        Reactor::shared().attach();
+        // Other bots keep the loop running, so ours has to sit out until we're connected.
+        loop.pause();
+        // Everything the timers of this iteration wanted to send goes out together.
+        loop.setCheck([this]() {
+            wrapper.flushCommands();
+        });
+    }
     loop.setInterval([this]() {
         this->processInternals();
     }, 1000.0 / 60.0); 
 }
 
-const Types::TimePoint epoch;
-
-
-bool within_xy_range(double o_x, double o_y, const nlohmann::json& entity) {
-	double x = entity["x"].get<double>();
-	double y = entity["y"].get<double>();
-	if (o_x - 700 < x && x < o_x + 700 && o_y - 500 < y && y < o_y + 500) {
-		return true;
+void BotSkeleton::runDedicatedLoop() {
+	while (running) {
+		loop_running.wait(false); // wait until it has changed FROM false to true.
+		if(!running) {
+			break;
+		}
+		loop.run();
+		// Everything the timers of this iteration wanted to send goes out together.
+		wrapper.flushCommands();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
 	}
-	return false;
+	this->disconnect();
 }
 
-void BotSkeleton::processInternals() {
-    if (last == epoch) last = Types::Clock::now();
-
-		std::map<std::string, nlohmann::json> updateEntities;
-
-   		nlohmann::json updatePlayer;
-		{
-			// The intermediate map is used to reduce the amount of data races.
-			// Now, it's only between the socket, and this function. This specific
-			// tiny code snippet uses a mutex, that interacts with the inserting
-			// and updating function (entities event). This blocks changes. 
-			// Additionally, a copy is stored in this function, which lets the socket
-			// continue processing right after the copy and clearing of the previous
-			// entities have been handled
-			// This function is also run from a loop, which is blocking in terms of 
-			// other loops and timers. This means while this function is processing, 
-			// no loops will be accessing the entities map. 
-			// Thread safety first, kids!
-			std::lock_guard<std::mutex> lock(this->wrapper.getEntityGuard());
-			updateEntities = std::move(wrapper.getUpdateEntities());
-			updatePlayer = std::move(wrapper.getUpdateCharacter());
-			wrapper.getUpdateEntities().clear();
-			wrapper.getUpdateCharacter().clear();
-		}
+std::thread& BotSkeleton::getThread() {
+	return loop.isShared() ? Reactor::shared().getThread() : uvThread;
+}
+
+const Types::TimePoint epoch;
 
-		// Shouldn't need to delete entities.
-		// wrapper->deleteEntities();
 
-		auto& entities = wrapper.getEntities();
-		for (auto& [id, data] : updateEntities) {
-			if (entities.find(id) != entities.end()) {
-				entities[id].update(data);
-			} else entities[id] = data;
-		}
-		if (!updatePlayer.is_null()) {
-			wrapper.getCharacter().update(updatePlayer);
-		}
+void BotSkeleton::processInternals(Types::TimePoint now) {
+    if (last == epoch) last = now;
 
-		auto now = Types::Clock::now();
+		// The socket thread only queues what it receives, everything is applied here, on the loop.
+		// Timers and intervals run on this same thread, so nothing else writes to the world
+		// while bot code reads it.
+		wrapper.applyInbound();
 
 		const double delta = std::chrono::duration_cast<std::chrono::milliseconds>(now - last).count();
 		last = now;
@@ -94,104 +75,123 @@ void BotSkeleton::processInternals() {
 				MovementMath::moveEntity(entity, cDelta);
 				MovementMath::stopLogic(entity);
 			}
-			double o_x = getX();
-			double o_y = getY();
-			auto& entities = wrapper.getEntities();
-			const std::string player_map = getMap();
-			for (auto it = entities.begin(); it != entities.end();) {
-				auto& [id, entity] = *it;
-				bool REMOVE = false;
-				if (entity.is_null()) {
-					REMOVE = true;
-				} else if (entity.value("dead", false)) {
-					REMOVE = true;
-				} else if (!within_xy_range(o_x, o_y, entity)) {
-					REMOVE = true;
-				} else if (entity.value("rip", false)) {
-					REMOVE = true;
-				} else {
-					auto it = entity.find("map");
-					if (it != entity.end()) {
-						if (it->get<std::string>() != player_map) {
-							REMOVE = true;
-						}
-					} else {
-						REMOVE = true;
-					}
-				}
-				if (REMOVE) {
-					it = entities.erase(it);
-				} else {
-					++it;
-				}
-			}
-			for (auto& [id, entity] : wrapper.getEntities()) {
+			cDelta -= 50;
+		}
 
-				if (entity.find("speed") == entity.end() && entity["type"] == "monster") {
-					std::string type = entity["mtype"];
-					entity["speed"] = this->info.G->getData()["monsters"][type]["speed"].get<double>();
-				}
-				if (!entity.value("rip", false) && !entity.value("dead", false) && entity.value("moving", false)) {
-					if (entity.value("move_num", 0l) != entity.value("engaged_move", 0l) ||
-						(entity.find("ref_speed") != entity.end() && entity["ref_speed"] != entity["speed"])) {
-						entity["ref_speed"] = entity["speed"];
-						entity["from_x"] = entity["x"];
-						entity["from_y"] = entity["y"];
-						std::pair<double, double> vxy = MovementMath::calculateVelocity(entity);
-						entity["vx"] = vxy.first;
-						entity["vy"] = vxy.second;
-
-						entity["engaged_move"] = entity["move_num"];
-					}
-
-					MovementMath::moveEntity(entity, cDelta);
-					MovementMath::stopLogic(entity); // Processes whether we're done moving or not.
-				}
+		// Other entities don't need stepping, their positions follow the store's clock.
+		auto& entities = wrapper.getEntities();
+		entities.advance(delta);
+
+		double o_x = getX();
+		double o_y = getY();
+		// Out of range or on another map, found through the grid. Dead and rip ones, wherever they are.
+		std::vector<size_t> culled = entities.rowsOutside(getMap(), o_x - 700, o_y - 500, o_x + 700, o_y + 500);
+		for (size_t row = 0; row < entities.size(); row++) {
+			const EntityStore::Entity entity = entities[row];
+			if (entity.isDead() || entity.isRip()) {
+				culled.push_back(row);
 			}
-
-			cDelta -= 50;
 		}
+		// Highest row first, since erasing moves the last row into the erased one.
+		std::sort(culled.begin(), culled.end(), std::greater<size_t>());
+		culled.erase(std::unique(culled.begin(), culled.end()), culled.end());
+		for (size_t row : culled) {
+			wrapper.getJournal().remove(entities[row].getId());
+			entities.erase(row);
+		}
+		wrapper.publishSnapshot(now);
+		wrapper.getJournal().advance();
 }
 
 
 void BotSkeleton::onDisconnect(std::string reason) {
 	mLogger->info("Disconnected: {}", reason);
+	// A close we started ourselves, or the end of a reconnection attempt. Neither means the bot
+	// should stop: the attempt's timeout schedules the next one.
+	if (closing || connectionState == RECONNECTING) {
+		return;
+	}
 	if(reason == "Abnormal closure") {
-		mLogger->info("Attempting reconnection.");
-		loop_running = false;
-		std::thread([this]() {
-			mLogger->info("{}", (size_t) this->wrapper.getReadyState());
-			mLogger->info("Disconnecting.");
-			this->disconnect();
-			mLogger->info("Reconnecting.");
-			this->connect();
-			mLogger->info("Connected.");
-		}).detach();
+		// Bot code keeps running on the last known world while we reconnect. This is called from
+		// the socket's own thread, which can't stop the socket, so the rest happens on the loop.
+		if (connectionState.exchange(RECONNECTING) != RECONNECTING) {
+			disconnectedAt = Types::Clock::now();
+			loop.exec([this]() {
+				scheduleReconnect();
+			});
+		}
 	} else {
 		mLogger->info("Stopping.");
 		this->stop();
 	}
 }
+
+void BotSkeleton::scheduleReconnect() {
+	if (!running) {
+		return;
+	}
+	const size_t attempt = ++reconnectAttempt;
+	std::chrono::milliseconds delay = reconnectBackoff.next();
+	mLogger->info("Reconnecting in {} ms (attempt {}).", delay.count(), reconnectBackoff.getAttempts());
+	loop.setTimeout([this, attempt]() {
+		if (!running || connectionState != RECONNECTING || attempt != reconnectAttempt) {
+			return;
+		}
+		// Stopping the socket waits for its thread, which only ever posts to the loop, never
+		// waits on it. The close it reports is ignored by onDisconnect.
+		this->disconnect();
+		this->connect();
+		// An attempt that fails during the handshake doesn't always close the socket, so it's
+		// given up on if the game hasn't started within the timeout.
+		loop.setTimeout([this, attempt]() {
+			if (running && connectionState == RECONNECTING && attempt == reconnectAttempt) {
+				mLogger->warn("Reconnection attempt {} timed out.", reconnectBackoff.getAttempts());
+				scheduleReconnect();
+			}
+		}, reconnectTimeout);
+	}, delay.count());
+}
+
 void BotSkeleton::onConnect() {
+	if (connectionState.exchange(CONNECTED) == RECONNECTING) {
+		mLogger->info("Reconnected after {} ms and {} attempts.",
+			std::chrono::duration_cast<std::chrono::milliseconds>(Types::Clock::now() - disconnectedAt).count(),
+			reconnectBackoff.getAttempts());
+		loop.exec([this]() {
+			reconnectBackoff.reset();
+		});
+	}
 	loop_running = true;
 	loop_running.notify_all();
+	loop.resume();
 }
 
 void BotSkeleton::connect() {
+    if (loop.isShared()) {
+        Reactor::shared().start();
+    }
     wrapper.connect();
 };
 
 void BotSkeleton::disconnect() {
+	closing = true;
 	wrapper.close();
+	closing = false;
 }
 void BotSkeleton::stop() {
-	running = false;
+	if (!running.exchange(false)) {
+		return;
+	}
+	if (loop.isShared()) {
+		// There's no thread of our own to wind down, so take our handles off the reactor instead.
+		loop.exec([this]() {
+			this->disconnect();
+			loop.closeAll();
+			Reactor::shared().detach();
+		});
+	}
 };
 
-nlohmann::json& BotSkeleton::getUpdateCharacter() {
-	return wrapper.getUpdateCharacter();
-}
-
 nlohmann::json& BotSkeleton::getCharacter() {
 	return wrapper.getCharacter();
 }
\ No newline at end of file
@@ -0,0 +1,514 @@
+#include "albot/EntityDecoder.hpp"
+#include "albot/ServiceInterface.hpp"
+
+MonsterTable::MonsterTable(const GameData* G) : tables(G == nullptr ? nullptr : G->shareTables()) {
+}
+
+bool EntityRecord::setNumber(std::string_view key, double value) {
+	if (key == "x") { x = value; fields |= X; }
+	else if (key == "y") { y = value; fields |= Y; }
+	else if (key == "going_x") { going_x = value; fields |= GOING_X; }
+	else if (key == "going_y") { going_y = value; fields |= GOING_Y; }
+	else if (key == "hp") { hp = long(value); fields |= HP; }
+	else if (key == "speed") { speed = value; fields |= SPEED; }
+	else if (key == "move_num") { move_num = long(value); fields |= MOVE_NUM; }
+	else if (key == "max_hp") { max_hp = long(value); fields |= MAX_HP; }
+	else if (key == "mp") { mp = long(value); fields |= MP; }
+	else if (key == "max_mp") { max_mp = long(value); fields |= MAX_MP; }
+	else if (key == "level") { level = long(value); fields |= LEVEL; }
+	// The backend sometimes sends rip as an integer. This client expects a bool.
+	else if (key == "rip") { rip = value == 1; fields |= RIP; }
+	else if (key == "moving") { moving = value != 0; fields |= MOVING; }
+	else return false;
+	return true;
+}
+
+void EntityRecord::fillDefaults(const MonsterTable& monsters) {
+	if (kind != MONSTER || !has(TYPE)) {
+		return;
+	}
+	if (!has(MAX_HP)) {
+		const auto* entry = monsters.find(type);
+		if (entry != nullptr) {
+			max_hp = entry->hp;
+			fields |= MAX_HP;
+		}
+	}
+	if (!has(HP) && has(MAX_HP)) {
+		hp = max_hp;
+		fields |= HP;
+	}
+}
+
+void EntityBatch::finish(std::string_view expectedMap) {
+	if (!expectedMap.empty() && !map.empty() && map != expectedMap) {
+		wrongMap = true;
+	}
+	if (wrongMap) {
+		records.clear();
+		return;
+	}
+	for (EntityRecord& record : records) {
+		record.in = in;
+		record.map = map;
+		record.fields |= EntityRecord::LOCATION;
+	}
+}
+
+void EntityRecord::merge(EntityRecord&& other) {
+	if (kind == UNKNOWN_KIND) {
+		kind = other.kind;
+	}
+	if (other.has(X)) x = other.x;
+	if (other.has(Y)) y = other.y;
+	if (other.has(GOING_X)) going_x = other.going_x;
+	if (other.has(GOING_Y)) going_y = other.going_y;
+	if (other.has(SPEED)) speed = other.speed;
+	if (other.has(HP)) hp = other.hp;
+	if (other.has(MAX_HP)) max_hp = other.max_hp;
+	if (other.has(MP)) mp = other.mp;
+	if (other.has(MAX_MP)) max_mp = other.max_mp;
+	if (other.has(LEVEL)) level = other.level;
+	if (other.has(MOVE_NUM)) move_num = other.move_num;
+	if (other.has(MOVING)) moving = other.moving;
+	if (other.has(RIP)) rip = other.rip;
+	if (other.has(DEAD)) dead = other.dead;
+	if (other.has(TARGET)) target = std::move(other.target);
+	if (other.has(TYPE)) type = std::move(other.type);
+	if (other.has(LOCATION)) {
+		in = std::move(other.in);
+		map = std::move(other.map);
+	}
+	if (other.has(EXTRA)) {
+		if (has(EXTRA)) {
+			extra.update(other.extra);
+		} else {
+			extra = std::move(other.extra);
+		}
+	}
+	fields |= other.fields;
+}
+
+namespace {
+	/**
+	 * Sets entity[key] unless it already holds the value, so unchanged fields cost neither
+	 * an allocation nor a bit in the change mask.
+	 *
+	 * @returns  true if the entity changed.
+	 */
+	template <typename T>
+	bool assign(nlohmann::json& entity, const char* key, const T& value) {
+		auto it = entity.find(key);
+		if (it == entity.end()) {
+			entity.emplace(key, value);
+			return true;
+		}
+		if (*it == value) {
+			return false;
+		}
+		*it = value;
+		return true;
+	}
+}
+
+uint32_t EntityRecord::fieldOf(std::string_view key) {
+	if (key == "x") return X;
+	if (key == "y") return Y;
+	if (key == "going_x") return GOING_X;
+	if (key == "going_y") return GOING_Y;
+	if (key == "speed") return SPEED;
+	if (key == "hp") return HP;
+	if (key == "max_hp") return MAX_HP;
+	if (key == "mp") return MP;
+	if (key == "max_mp") return MAX_MP;
+	if (key == "level") return LEVEL;
+	if (key == "move_num") return MOVE_NUM;
+	if (key == "moving") return MOVING;
+	if (key == "rip") return RIP;
+	if (key == "dead") return DEAD;
+	if (key == "target") return TARGET;
+	if (key == "mtype" || key == "ctype") return TYPE;
+	if (key == "in" || key == "map") return LOCATION;
+	return EXTRA;
+}
+
+uint32_t EntityRecord::apply(nlohmann::json& entity) const {
+	if (!entity.is_object()) {
+		entity = nlohmann::json::object();
+	}
+	uint32_t changed = 0;
+	if (!id.empty()) assign(entity, "id", id);
+	if (kind == CHARACTER) {
+		assign(entity, "type", "character");
+		// Used for, among other things, canMove. This contains the character bounding box
+		// h = horizontal, v = vertical, vn = vertical negative
+		if (!entity.contains("base")) {
+			entity["base"] = { {"h", 8}, {"v", 7}, {"vn", 2} };
+		}
+		if (has(TYPE) && assign(entity, "ctype", type)) changed |= TYPE;
+	} else if (kind == MONSTER) {
+		assign(entity, "type", "monster");
+		if (has(TYPE) && assign(entity, "mtype", type)) changed |= TYPE;
+	}
+	if (has(LOCATION)) {
+		// Both have to be assigned, || would skip map whenever in changed.
+		bool inChanged = assign(entity, "in", in);
+		bool mapChanged = assign(entity, "map", map);
+		if (inChanged || mapChanged) changed |= LOCATION;
+	}
+	if (has(X) && assign(entity, "x", x)) changed |= X;
+	if (has(Y) && assign(entity, "y", y)) changed |= Y;
+	if (has(GOING_X) && assign(entity, "going_x", going_x)) changed |= GOING_X;
+	if (has(GOING_Y) && assign(entity, "going_y", going_y)) changed |= GOING_Y;
+	if (has(SPEED) && assign(entity, "speed", speed)) changed |= SPEED;
+	if (has(HP) && assign(entity, "hp", hp)) changed |= HP;
+	if (has(MAX_HP) && assign(entity, "max_hp", max_hp)) changed |= MAX_HP;
+	if (has(MP) && assign(entity, "mp", mp)) changed |= MP;
+	if (has(MAX_MP) && assign(entity, "max_mp", max_mp)) changed |= MAX_MP;
+	if (has(LEVEL) && assign(entity, "level", level)) changed |= LEVEL;
+	if (has(MOVE_NUM) && assign(entity, "move_num", move_num)) changed |= MOVE_NUM;
+	if (has(MOVING) && assign(entity, "moving", moving)) changed |= MOVING;
+	if (has(RIP) && assign(entity, "rip", rip)) changed |= RIP;
+	if (has(DEAD) && assign(entity, "dead", dead)) changed |= DEAD;
+	if (has(TARGET)) {
+		bool targetChanged = target.empty() ? assign(entity, "target", nullptr) : assign(entity, "target", target);
+		if (targetChanged) changed |= TARGET;
+	}
+	if (has(EXTRA)) {
+		for (const auto& [key, value] : extra.items()) {
+			if (assign(entity, key.c_str(), value)) changed |= EXTRA;
+		}
+	}
+	return changed;
+}
+
+namespace EntityDecoder {
+	/**
+	 * Builds a JSON value out of SAX events. Used for the parts of a payload
+	 * that don't have a typed home.
+	 */
+	class JsonBuilder {
+		private:
+			nlohmann::json* root = nullptr;
+			std::vector<nlohmann::json*> stack;
+			std::string key;
+		public:
+			void begin(nlohmann::json& target) {
+				root = &target;
+				stack.clear();
+			}
+			nlohmann::json* place(nlohmann::json&& value) {
+				if (stack.empty()) {
+					*root = std::move(value);
+					return root;
+				}
+				nlohmann::json& top = *stack.back();
+				if (top.is_array()) {
+					top.push_back(std::move(value));
+					return &top.back();
+				}
+				return &(top[key] = std::move(value));
+			}
+			void start_object() {
+				stack.push_back(place(nlohmann::json::object()));
+			}
+			void start_array() {
+				stack.push_back(place(nlohmann::json::array()));
+			}
+			void end() {
+				stack.pop_back();
+			}
+			void set_key(std::string& value) {
+				key = std::move(value);
+			}
+			bool done() const {
+				return stack.empty();
+			}
+	};
+
+	enum Scope : uint8_t {
+		WRAPPER,
+		ENTITIES,
+		PLAYERS,
+		MONSTERS,
+		ENTITY
+	};
+
+	/**
+	 * Streams entity payloads into an EntityBatch.
+	 * Keys with a typed field in EntityRecord are written directly; everything else
+	 * is either collected into `extra`/`rest` or skipped.
+	 */
+	class EntitySax : public nlohmann::json_sax<nlohmann::json> {
+		private:
+			EntityBatch& batch;
+			const MonsterTable& monsters;
+			std::string_view expectedMap;
+			bool wrapped;
+			std::vector<Scope> scopes;
+			std::string currentKey;
+			EntityRecord current;
+			JsonBuilder builder;
+			bool capturing = false;
+			size_t skipDepth = 0;
+
+			void capture(nlohmann::json& target) {
+				builder.begin(target);
+				capturing = true;
+			}
+
+			nlohmann::json& extraSlot() {
+				if (!current.has(EntityRecord::EXTRA)) {
+					current.extra = nlohmann::json::object();
+					current.fields |= EntityRecord::EXTRA;
+				}
+				return current.extra[currentKey];
+			}
+
+			template<typename T>
+			bool scalar(T&& value, double number, bool is_number) {
+				if (skipDepth > 0) {
+					return true;
+				}
+				if (capturing) {
+					builder.place(nlohmann::json(std::forward<T>(value)));
+					capturing = !builder.done();
+					return true;
+				}
+				if (scopes.empty()) {
+					return true;
+				}
+				switch (scopes.back()) {
+					case WRAPPER:
+						batch.rest[currentKey] = std::forward<T>(value);
+						break;
+					case ENTITY:
+						if (!is_number || !current.setNumber(currentKey, number)) {
+							extraSlot() = std::forward<T>(value);
+						}
+						break;
+					default:
+						break;
+				}
+				return true;
+			}
+
+			void finishRecord() {
+				if (current.id.empty()) {
+					return;
+				}
+				current.kind = scopes.back() == PLAYERS ? EntityRecord::CHARACTER : EntityRecord::MONSTER;
+				current.fillDefaults(monsters);
+				batch.records.push_back(std::move(current));
+			}
+
+			bool checkMap() {
+				if (!expectedMap.empty() && !batch.map.empty() && batch.map != expectedMap) {
+					batch.wrongMap = true;
+					// Stop parsing, nothing else in this payload is useful.
+					return false;
+				}
+				return true;
+			}
+		public:
+			EntitySax(EntityBatch& batch, const MonsterTable& monsters, std::string_view expectedMap, bool wrapped)
+				: batch(batch), monsters(monsters), expectedMap(expectedMap), wrapped(wrapped) {
+			}
+
+			bool null() override {
+				if (!capturing && skipDepth == 0 && !scopes.empty() && scopes.back() == ENTITY && currentKey == "target") {
+					current.target.clear();
+					current.fields |= EntityRecord::TARGET;
+					return true;
+				}
+				return scalar(nullptr, 0, false);
+			}
+			bool boolean(bool value) override {
+				return scalar(value, value ? 1 : 0, true);
+			}
+			bool number_integer(number_integer_t value) override {
+				return scalar(value, double(value), true);
+			}
+			bool number_unsigned(number_unsigned_t value) override {
+				return scalar(value, double(value), true);
+			}
+			bool number_float(number_float_t value, const string_t&) override {
+				return scalar(value, value, true);
+			}
+			bool string(string_t& value) override {
+				if (!capturing && skipDepth == 0 && !scopes.empty()) {
+					if (scopes.back() == ENTITIES) {
+						if (currentKey == "type") batch.type = std::move(value);
+						else if (currentKey == "in") batch.in = std::move(value);
+						else if (currentKey == "map") {
+							batch.map = std::move(value);
+							return checkMap();
+						}
+						return true;
+					}
+					if (scopes.back() == ENTITY) {
+						if (currentKey == "id") {
+							current.id = std::move(value);
+							return true;
+						}
+						if (currentKey == "target") {
+							current.target = std::move(value);
+							current.fields |= EntityRecord::TARGET;
+							return true;
+						}
+						// Monsters send their mtype as `type`, characters send `ctype`.
+						if ((currentKey == "type" && scopes[scopes.size() - 2] == MONSTERS) || currentKey == "ctype") {
+							current.type = std::move(value);
+							current.fields |= EntityRecord::TYPE;
+							return true;
+						}
+						if (currentKey == "type") {
+							return true;
+						}
+					}
+				}
+				return scalar(std::move(value), 0, false);
+			}
+			bool binary(binary_t&) override {
+				return true;
+			}
+			bool start_object(std::size_t) override {
+				if (skipDepth > 0) {
+					skipDepth++;
+					return true;
+				}
+				if (capturing) {
+					builder.start_object();
+					return true;
+				}
+				if (scopes.empty()) {
+					scopes.push_back(wrapped ? WRAPPER : ENTITIES);
+					return true;
+				}
+				switch (scopes.back()) {
+					case WRAPPER:
+						if (currentKey == "entities") {
+							scopes.push_back(ENTITIES);
+						} else {
+							capture(batch.rest[currentKey]);
+							builder.start_object();
+						}
+						break;
+					case PLAYERS:
+					case MONSTERS:
+						current = EntityRecord();
+						scopes.push_back(ENTITY);
+						break;
+					case ENTITY:
+						capture(extraSlot());
+						builder.start_object();
+						break;
+					default:
+						skipDepth = 1;
+				}
+				return true;
+			}
+			bool key(string_t& value) override {
+				if (skipDepth > 0) {
+					return true;
+				}
+				if (capturing) {
+					builder.set_key(value);
+				} else {
+					currentKey = std::move(value);
+				}
+				return true;
+			}
+			bool end_object() override {
+				if (skipDepth > 0) {
+					skipDepth--;
+					return true;
+				}
+				if (capturing) {
+					builder.end();
+					capturing = !builder.done();
+					return true;
+				}
+				if (!scopes.empty()) {
+					Scope scope = scopes.back();
+					scopes.pop_back();
+					if (scope == ENTITY) {
+						finishRecord();
+					}
+				}
+				return true;
+			}
+			bool start_array(std::size_t) override {
+				if (skipDepth > 0) {
+					skipDepth++;
+					return true;
+				}
+				if (capturing) {
+					builder.start_array();
+					return true;
+				}
+				if (scopes.empty()) {
+					skipDepth = 1;
+					return true;
+				}
+				switch (scopes.back()) {
+					case WRAPPER:
+						capture(batch.rest[currentKey]);
+						builder.start_array();
+						break;
+					case ENTITIES:
+						if (currentKey == "players") {
+							scopes.push_back(PLAYERS);
+						} else if (currentKey == "monsters") {
+							scopes.push_back(MONSTERS);
+						} else {
+							skipDepth = 1;
+						}
+						break;
+					case ENTITY:
+						capture(extraSlot());
+						builder.start_array();
+						break;
+					default:
+						skipDepth = 1;
+				}
+				return true;
+			}
+			bool end_array() override {
+				if (skipDepth > 0) {
+					skipDepth--;
+					return true;
+				}
+				if (capturing) {
+					builder.end();
+					capturing = !builder.done();
+					return true;
+				}
+				if (!scopes.empty()) {
+					scopes.pop_back();
+				}
+				return true;
+			}
+			bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override {
+				return false;
+			}
+	};
+
+	bool decode(std::string_view payload, EntityBatch& batch, const MonsterTable& monsters, std::string_view expectedMap, bool wrapped) {
+		EntitySax sax(batch, monsters, expectedMap, wrapped);
+		if (wrapped) {
+			batch.rest = nlohmann::json::object();
+		}
+		bool success = nlohmann::json::sax_parse(payload.begin(), payload.end(), &sax);
+		batch.finish(expectedMap);
+		return success || batch.wrongMap;
+	}
+
+	bool decodeEntities(std::string_view payload, EntityBatch& batch, const MonsterTable& monsters, std::string_view expectedMap) {
+		return decode(payload, batch, monsters, expectedMap, false);
+	}
+
+	bool decodeWrapped(std::string_view payload, EntityBatch& batch, const MonsterTable& monsters) {
+		return decode(payload, batch, monsters, {}, true);
+	}
+}
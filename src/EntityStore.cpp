@@ -0,0 +1,503 @@
+#include "albot/EntityStore.hpp"
+#include "albot/MovementKernel.hpp"
+#include "albot/MovementMath.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <tuple>
+
+namespace {
+	/**
+	 * Sets the column value unless it already holds it.
+	 *
+	 * @returns  true if it changed.
+	 */
+	template <typename T, typename V>
+	bool assign(T& slot, const V& value) {
+		if (slot == value) {
+			return false;
+		}
+		slot = value;
+		return true;
+	}
+
+	template <typename T>
+	void swapPop(std::vector<T>& column, size_t row) {
+		if (row != column.size() - 1) {
+			column[row] = std::move(column.back());
+		}
+		column.pop_back();
+	}
+}
+
+size_t EntityStore::insert(const std::string& id) {
+	const size_t row = ids.size();
+	ids.push_back(id);
+	kinds.push_back(EntityRecord::UNKNOWN_KIND);
+	types.emplace_back();
+	ins.emplace_back();
+	maps.emplace_back();
+	targets.emplace_back();
+	x.push_back(0);
+	y.push_back(0);
+	goingX.push_back(0);
+	goingY.push_back(0);
+	fromX.push_back(0);
+	fromY.push_back(0);
+	vx.push_back(0);
+	vy.push_back(0);
+	speed.push_back(0);
+	movedAt.push_back(clock);
+	arriveAt.push_back(clock);
+	hp.push_back(0);
+	maxHp.push_back(0);
+	mp.push_back(0);
+	maxMp.push_back(0);
+	level.push_back(0);
+	moveNum.push_back(0);
+	fields.push_back(0);
+	flags.push_back(0);
+	statuses.emplace_back();
+	extras.emplace_back();
+	uint32_t slot;
+	if (freeSlots.empty()) {
+		// More than a million entities at once would overflow Handle::SLOT_BITS; a map never gets near that.
+		// Retired slots count too, but it takes billions of entities to retire that many.
+		slot = uint32_t(slots.size());
+		slots.emplace_back();
+	} else {
+		slot = freeSlots.front();
+		freeSlots.pop_front();
+	}
+	slots[slot].row = row;
+	handles.emplace_back(slot, slots[slot].generation);
+	index.insert(id, slot);
+	cellKeys.push_back(SpatialGrid::NO_CELL);
+	return row;
+}
+
+uint32_t EntityStore::internMap(const std::string& map) {
+	if (const uint32_t* id = mapIds.find(map)) {
+		return *id;
+	}
+	const uint32_t id = uint32_t(mapPopulation.size());
+	mapIds.insert(map, id);
+	mapPopulation.push_back(0);
+	return id;
+}
+
+size_t EntityStore::findMap(std::string_view map) const {
+	const uint32_t* id = mapIds.find(map);
+	return id == nullptr ? npos : *id;
+}
+
+void EntityStore::regrid(size_t row, uint32_t map) {
+	const SpatialGrid::CellKey key = grid.keyOf(map, x[row], y[row]);
+	SpatialGrid::CellKey& current = cellKeys[row];
+	if (key == current) {
+		return;
+	}
+	const uint32_t slot = handles[row].getSlot();
+	if (current != SpatialGrid::NO_CELL) {
+		grid.remove(current, slot);
+		mapPopulation[SpatialGrid::mapOf(current)]--;
+	}
+	grid.insert(key, slot);
+	mapPopulation[map]++;
+	current = key;
+}
+
+void EntityStore::release(uint32_t slot) {
+	Slot& entry = slots[slot];
+	entry.row = npos;
+	entry.generation = (entry.generation + 1) & Handle::GENERATION_MASK;
+	// Wrapping around would bring back generations old handles still hold, so the slot is never
+	// used again. It takes GENERATION_MASK entities to retire one.
+	if (entry.generation == 0) {
+		return;
+	}
+	freeSlots.push_back(slot);
+}
+
+uint32_t EntityStore::apply(const EntityRecord& record) {
+	size_t row = indexOf(record.id);
+	if (row == npos) {
+		row = insert(record.id);
+	}
+	return apply(row, record);
+}
+
+uint32_t EntityStore::apply(size_t row, const EntityRecord& record) {
+	// Whatever the record says is as of now, the segment so far is over.
+	materialize(row);
+	uint32_t changed = 0;
+	if (record.kind != EntityRecord::UNKNOWN_KIND) {
+		kinds[row] = record.kind;
+	}
+	if (record.has(EntityRecord::TYPE) && assign(types[row], record.type)) changed |= EntityRecord::TYPE;
+	if (record.has(EntityRecord::LOCATION)) {
+		// Both have to be assigned, || would skip map whenever in changed.
+		bool inChanged = assign(ins[row], record.in);
+		bool mapChanged = assign(maps[row], record.map);
+		if (inChanged || mapChanged) changed |= EntityRecord::LOCATION;
+	}
+	if (record.has(EntityRecord::X) && assign(x[row], record.x)) changed |= EntityRecord::X;
+	if (record.has(EntityRecord::Y) && assign(y[row], record.y)) changed |= EntityRecord::Y;
+	if (record.has(EntityRecord::GOING_X) && assign(goingX[row], record.going_x)) changed |= EntityRecord::GOING_X;
+	if (record.has(EntityRecord::GOING_Y) && assign(goingY[row], record.going_y)) changed |= EntityRecord::GOING_Y;
+	if (record.has(EntityRecord::SPEED) && assign(speed[row], record.speed)) changed |= EntityRecord::SPEED;
+	if (record.has(EntityRecord::HP) && assign(hp[row], record.hp)) changed |= EntityRecord::HP;
+	if (record.has(EntityRecord::MAX_HP) && assign(maxHp[row], record.max_hp)) changed |= EntityRecord::MAX_HP;
+	if (record.has(EntityRecord::MP) && assign(mp[row], record.mp)) changed |= EntityRecord::MP;
+	if (record.has(EntityRecord::MAX_MP) && assign(maxMp[row], record.max_mp)) changed |= EntityRecord::MAX_MP;
+	if (record.has(EntityRecord::LEVEL) && assign(level[row], record.level)) changed |= EntityRecord::LEVEL;
+	if (record.has(EntityRecord::MOVE_NUM) && assign(moveNum[row], record.move_num)) changed |= EntityRecord::MOVE_NUM;
+	if (record.has(EntityRecord::TARGET) && assign(targets[row], record.target)) changed |= EntityRecord::TARGET;
+	const uint32_t before = flags[row];
+	if (record.has(EntityRecord::MOVING)) {
+		flags[row] = record.moving ? flags[row] | MOVING : flags[row] & ~MOVING;
+		if ((before ^ flags[row]) & MOVING) changed |= EntityRecord::MOVING;
+	}
+	if (record.has(EntityRecord::RIP)) {
+		flags[row] = record.rip ? flags[row] | RIP : flags[row] & ~RIP;
+		if ((before ^ flags[row]) & RIP) changed |= EntityRecord::RIP;
+	}
+	if (record.has(EntityRecord::DEAD)) {
+		flags[row] = record.dead ? flags[row] | DEAD : flags[row] & ~DEAD;
+		if ((before ^ flags[row]) & DEAD) changed |= EntityRecord::DEAD;
+	}
+	if (record.has(EntityRecord::EXTRA)) {
+		for (const auto& [key, value] : record.extra.items()) {
+			if (key == "s") {
+				if (assign(statuses[row], value)) changed |= EntityRecord::EXTRA;
+				continue;
+			}
+			if (key == "amoving") {
+				flags[row] = value.is_boolean() && value.get<bool>() ? flags[row] | AMOVING : flags[row] & ~AMOVING;
+			}
+			nlohmann::json& extra = extras[row];
+			if (!extra.is_object()) {
+				extra = nlohmann::json::object();
+			}
+			auto it = extra.find(key);
+			if (it == extra.end()) {
+				extra.emplace(key, value);
+			} else if (!assign(*it, value)) {
+				continue;
+			}
+			changed |= EntityRecord::EXTRA;
+		}
+	}
+	fields[row] |= record.fields;
+	const uint32_t motion = EntityRecord::X | EntityRecord::Y | EntityRecord::GOING_X | EntityRecord::GOING_Y
+		| EntityRecord::SPEED | EntityRecord::MOVE_NUM | EntityRecord::MOVING | EntityRecord::RIP | EntityRecord::DEAD;
+	if ((changed & motion) != 0) {
+		engage(row);
+	}
+	const bool relocated = cellKeys[row] == SpatialGrid::NO_CELL || (changed & EntityRecord::LOCATION) != 0;
+	regrid(row, relocated ? internMap(maps[row]) : SpatialGrid::mapOf(cellKeys[row]));
+	return changed;
+}
+
+void EntityStore::setDefaultSpeed(size_t row, double value) {
+	materialize(row);
+	speed[row] = value;
+	fields[row] |= EntityRecord::SPEED;
+	engage(row);
+}
+
+void EntityStore::engage(size_t row) {
+	uint32_t& flag = flags[row];
+	if ((flag & (MOVING | RIP | DEAD)) != MOVING) {
+		flag &= ~ENGAGED;
+		return;
+	}
+	fromX[row] = x[row];
+	fromY[row] = y[row];
+	std::tie(vx[row], vy[row]) = MovementMath::calculateVelocity(fromX[row], fromY[row], goingX[row], goingY[row], speed[row]);
+	movedAt[row] = clock;
+	const double distance = std::hypot(goingX[row] - fromX[row], goingY[row] - fromY[row]);
+	arriveAt[row] = speed[row] > 0 ? clock + distance / speed[row] * 1000.0 : std::numeric_limits<double>::infinity();
+	maxSpeed = std::max(maxSpeed, speed[row]);
+	flag |= ENGAGED;
+}
+
+void EntityStore::materialize(size_t row) {
+	uint32_t& flag = flags[row];
+	if ((flag & (MOVING | RIP | DEAD | ENGAGED)) != (MOVING | ENGAGED)) {
+		return;
+	}
+	std::tie(x[row], y[row]) = positionAt(row, clock);
+	movedAt[row] = clock;
+	if (clock >= arriveAt[row] && (flag & AMOVING) == 0) {
+		flag &= ~MOVING;
+	}
+}
+
+void EntityStore::erase(size_t row) {
+	if (cellKeys[row] != SpatialGrid::NO_CELL) {
+		grid.remove(cellKeys[row], handles[row].getSlot());
+		mapPopulation[SpatialGrid::mapOf(cellKeys[row])]--;
+	}
+	index.erase(ids[row]);
+	release(handles[row].getSlot());
+	if (row != ids.size() - 1) {
+		slots[handles.back().getSlot()].row = row;
+	}
+	swapPop(ids, row);
+	swapPop(kinds, row);
+	swapPop(types, row);
+	swapPop(ins, row);
+	swapPop(maps, row);
+	swapPop(targets, row);
+	swapPop(x, row);
+	swapPop(y, row);
+	swapPop(goingX, row);
+	swapPop(goingY, row);
+	swapPop(fromX, row);
+	swapPop(fromY, row);
+	swapPop(vx, row);
+	swapPop(vy, row);
+	swapPop(speed, row);
+	swapPop(movedAt, row);
+	swapPop(arriveAt, row);
+	swapPop(hp, row);
+	swapPop(maxHp, row);
+	swapPop(mp, row);
+	swapPop(maxMp, row);
+	swapPop(level, row);
+	swapPop(moveNum, row);
+	swapPop(fields, row);
+	swapPop(flags, row);
+	swapPop(statuses, row);
+	swapPop(extras, row);
+	swapPop(handles, row);
+	swapPop(cellKeys, row);
+}
+
+void EntityStore::clear() {
+	ids.clear();
+	kinds.clear();
+	types.clear();
+	ins.clear();
+	maps.clear();
+	targets.clear();
+	x.clear();
+	y.clear();
+	goingX.clear();
+	goingY.clear();
+	fromX.clear();
+	fromY.clear();
+	vx.clear();
+	vy.clear();
+	speed.clear();
+	movedAt.clear();
+	arriveAt.clear();
+	hp.clear();
+	maxHp.clear();
+	mp.clear();
+	maxMp.clear();
+	level.clear();
+	moveNum.clear();
+	fields.clear();
+	flags.clear();
+	statuses.clear();
+	extras.clear();
+	for (const Handle& handle : handles) {
+		release(handle.getSlot());
+	}
+	handles.clear();
+	index.clear();
+	cellKeys.clear();
+	grid.clear();
+	std::fill(mapPopulation.begin(), mapPopulation.end(), 0);
+}
+
+void EntityStore::advance(double delta) {
+	clock += delta;
+	if (clock - settledAt >= SETTLE_INTERVAL) {
+		settle();
+	}
+}
+
+void EntityStore::settle() {
+	arrivals.resize(size());
+	const MovementKernel::Columns columns = {
+		x.data(), y.data(), vx.data(), vy.data(), goingX.data(), goingY.data(), movedAt.data(), arriveAt.data(),
+		flags.data(), arrivals.data(), size()
+	};
+	const uint32_t active = MOVING | RIP | DEAD | ENGAGED;
+	MovementKernel::settle(columns, clock, active, MOVING | ENGAGED);
+
+	maxSpeed = 0;
+	for (size_t row = 0; row < size(); row++) {
+		uint32_t& flag = flags[row];
+		if ((flag & active) != (MOVING | ENGAGED)) {
+			continue;
+		}
+		if (arrivals[row] != 0 && (flag & AMOVING) == 0) {
+			flag &= ~MOVING;
+		} else {
+			maxSpeed = std::max(maxSpeed, speed[row]);
+		}
+		regrid(row, SpatialGrid::mapOf(cellKeys[row]));
+	}
+	settledAt = clock;
+}
+
+nlohmann::json EntityStore::toJson(size_t row) const {
+	nlohmann::json entity = extras[row].is_object() ? extras[row] : nlohmann::json::object();
+	const uint32_t present = fields[row];
+	entity["id"] = ids[row];
+	if (kinds[row] == EntityRecord::CHARACTER) {
+		entity["type"] = "character";
+		entity["base"] = { {"h", 8}, {"v", 7}, {"vn", 2} };
+		if (present & EntityRecord::TYPE) entity["ctype"] = types[row];
+	} else if (kinds[row] == EntityRecord::MONSTER) {
+		entity["type"] = "monster";
+		if (present & EntityRecord::TYPE) entity["mtype"] = types[row];
+	}
+	if (present & EntityRecord::LOCATION) {
+		entity["in"] = ins[row];
+		entity["map"] = maps[row];
+	}
+	const auto [currentX, currentY] = positionAt(row, clock);
+	entity["x"] = currentX;
+	entity["y"] = currentY;
+	if (present & EntityRecord::GOING_X) entity["going_x"] = goingX[row];
+	if (present & EntityRecord::GOING_Y) entity["going_y"] = goingY[row];
+	if (present & EntityRecord::SPEED) entity["speed"] = speed[row];
+	if (present & EntityRecord::HP) entity["hp"] = hp[row];
+	if (present & EntityRecord::MAX_HP) entity["max_hp"] = maxHp[row];
+	if (present & EntityRecord::MP) entity["mp"] = mp[row];
+	if (present & EntityRecord::MAX_MP) entity["max_mp"] = maxMp[row];
+	if (present & EntityRecord::LEVEL) entity["level"] = level[row];
+	if (present & EntityRecord::MOVE_NUM) entity["move_num"] = moveNum[row];
+	entity["moving"] = isMovingAt(row, clock);
+	if (present & EntityRecord::RIP) entity["rip"] = (flags[row] & RIP) != 0;
+	if (present & EntityRecord::DEAD) entity["dead"] = (flags[row] & DEAD) != 0;
+	if (present & EntityRecord::TARGET) {
+		if (targets[row].empty()) {
+			entity["target"] = nullptr;
+		} else {
+			entity["target"] = targets[row];
+		}
+	}
+	if (!statuses[row].is_null()) {
+		entity["s"] = statuses[row];
+	}
+	if (flags[row] & ENGAGED) {
+		entity["from_x"] = fromX[row];
+		entity["from_y"] = fromY[row];
+		entity["vx"] = vx[row];
+		entity["vy"] = vy[row];
+	}
+	return entity;
+}
+
+std::vector<EntityStore::Entity> EntityStore::queryRect(std::string_view map, double minX, double minY, double maxX, double maxY) const {
+	std::vector<Entity> found;
+	const size_t mapId = findMap(map);
+	if (mapId == npos) {
+		return found;
+	}
+	const double drift = getDrift();
+	grid.forEachInRect(uint32_t(mapId), minX - drift, minY - drift, maxX + drift, maxY + drift, [&](uint32_t slot) {
+		const size_t row = slots[slot].row;
+		const auto [atX, atY] = positionAt(row, clock);
+		if (minX <= atX && atX <= maxX && minY <= atY && atY <= maxY) {
+			found.emplace_back(*this, row);
+		}
+	});
+	return found;
+}
+
+std::vector<EntityStore::Entity> EntityStore::queryRadius(std::string_view map, double centerX, double centerY, double radius) const {
+	std::vector<Entity> found;
+	const size_t mapId = findMap(map);
+	if (mapId == npos) {
+		return found;
+	}
+	const double radiusSquared = radius * radius;
+	const double reach = radius + getDrift();
+	grid.forEachInRect(uint32_t(mapId), centerX - reach, centerY - reach, centerX + reach, centerY + reach, [&](uint32_t slot) {
+		const size_t row = slots[slot].row;
+		const auto [atX, atY] = positionAt(row, clock);
+		const double dx = atX - centerX;
+		const double dy = atY - centerY;
+		if (dx * dx + dy * dy <= radiusSquared) {
+			found.emplace_back(*this, row);
+		}
+	});
+	return found;
+}
+
+std::vector<EntityStore::Entity> EntityStore::nearestK(std::string_view map, double centerX, double centerY, size_t k) const {
+	const size_t mapId = findMap(map);
+	if (mapId == npos || k == 0) {
+		return {};
+	}
+	const size_t population = mapPopulation[mapId];
+	std::vector<std::pair<double, size_t>> candidates;
+	const double drift = getDrift();
+	// Widen the search until it holds k entities, or everything on the map. Whatever lies
+	// outside the radius is further away than anything inside it.
+	for (double radius = grid.getCellSize(); ; radius *= 2) {
+		candidates.clear();
+		const double radiusSquared = radius * radius;
+		const double reach = radius + drift;
+		grid.forEachInRect(uint32_t(mapId), centerX - reach, centerY - reach, centerX + reach, centerY + reach, [&](uint32_t slot) {
+			const size_t row = slots[slot].row;
+			const auto [atX, atY] = positionAt(row, clock);
+			const double dx = atX - centerX;
+			const double dy = atY - centerY;
+			const double distanceSquared = dx * dx + dy * dy;
+			if (distanceSquared <= radiusSquared) {
+				candidates.emplace_back(distanceSquared, row);
+			}
+		});
+		if (candidates.size() >= k || candidates.size() >= population) {
+			break;
+		}
+	}
+	const size_t count = std::min(k, candidates.size());
+	std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end());
+	std::vector<Entity> found;
+	found.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		found.emplace_back(*this, candidates[i].second);
+	}
+	return found;
+}
+
+std::vector<size_t> EntityStore::rowsOutside(std::string_view map, double minX, double minY, double maxX, double maxY) const {
+	std::vector<size_t> outside;
+	const size_t mapId = findMap(map);
+	const double size = grid.getCellSize();
+	// With a unit of slack, since rounding can put a point a hair outside of its cell.
+	const double slack = 1 + getDrift();
+	grid.forEachCell([&](SpatialGrid::CellKey key, const std::vector<uint32_t>& cell) {
+		if (SpatialGrid::mapOf(key) != mapId) {
+			for (uint32_t slot : cell) {
+				outside.push_back(slots[slot].row);
+			}
+			return;
+		}
+		const double cellMinX = double(SpatialGrid::cellXOf(key)) * size;
+		const double cellMinY = double(SpatialGrid::cellYOf(key)) * size;
+		if (minX < cellMinX - slack && cellMinX + size + slack < maxX && minY < cellMinY - slack && cellMinY + size + slack < maxY) {
+			return;
+		}
+		for (uint32_t slot : cell) {
+			const size_t row = slots[slot].row;
+			const auto [atX, atY] = positionAt(row, clock);
+			if (!(minX < atX && atX < maxX && minY < atY && atY < maxY)) {
+				outside.push_back(row);
+			}
+		}
+	});
+	std::sort(outside.begin(), outside.end(), std::greater<size_t>());
+	return outside;
+}
@@ -0,0 +1,309 @@
+#include "albot/GameDataCache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace {
+	constexpr char MAGIC[8] = { 'A', 'L', 'B', 'O', 'T', 'G', 'D', '\0' };
+	constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+	constexpr size_t ALIGNMENT = 8;
+
+	constexpr long ItemStats::* ITEM_STATS[] = {
+		&ItemStats::attack, &ItemStats::armor, &ItemStats::resistance, &ItemStats::hp, &ItemStats::mp, &ItemStats::speed,
+		&ItemStats::str, &ItemStats::intelligence, &ItemStats::dex, &ItemStats::vit, &ItemStats::crit
+	};
+	static_assert(std::size(ITEM_STATS) == std::size(GameDataCache::ItemRecord{}.stats));
+
+	// How big one element of every section is, for checking that the sections hold whole records.
+	constexpr size_t RECORD_SIZES[GameDataCache::SECTION_COUNT] = {
+		1, 1, sizeof(GameDataCache::MonsterRecord), sizeof(GameDataCache::SkillRecord), sizeof(GameDataCache::ItemRecord),
+		sizeof(GameDataCache::MapRecord), sizeof(GameDataCache::Line), sizeof(GameDataCache::Spawn)
+	};
+
+	double number(const nlohmann::json& object, const char* key) {
+		auto it = object.find(key);
+		return it != object.end() && it->is_number() ? it->get<double>() : 0.0;
+	}
+
+	bool isValid(const GameDataCache::Header& header, size_t length, int64_t version) {
+		if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.format != GameDataCache::FORMAT ||
+			header.byteOrder != BYTE_ORDER_MARK || header.version != version || header.size != length) {
+			return false;
+		}
+		for (size_t section = 0; section < GameDataCache::SECTION_COUNT; section++) {
+			const GameDataCache::SectionRef& ref = header.sections[section];
+			if (ref.offset < sizeof(GameDataCache::Header) || ref.offset % ALIGNMENT != 0 || ref.offset > length ||
+				ref.size > length - ref.offset || ref.size % RECORD_SIZES[section] != 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Lays the sections out one after another behind the header.
+	 */
+	class Writer {
+		private:
+			std::vector<std::vector<uint8_t>> sections = std::vector<std::vector<uint8_t>>(GameDataCache::SECTION_COUNT);
+			std::string strings;
+		public:
+			GameDataCache::StringRef intern(std::string_view string) {
+				GameDataCache::StringRef ref { uint32_t(strings.size()), uint32_t(string.size()) };
+				strings.append(string);
+				return ref;
+			}
+			template <typename Record>
+			void append(GameDataCache::Section section, const Record& record) {
+				const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+				sections[section].insert(sections[section].end(), bytes, bytes + sizeof(Record));
+			}
+			template <typename Record>
+			uint32_t count(GameDataCache::Section section) const {
+				return uint32_t(sections[section].size() / sizeof(Record));
+			}
+			void setDocument(std::vector<uint8_t> document) {
+				sections[GameDataCache::DOCUMENT] = std::move(document);
+			}
+
+			std::vector<uint8_t> finish(int64_t version) {
+				sections[GameDataCache::STRINGS].assign(strings.begin(), strings.end());
+				GameDataCache::Header header {};
+				std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+				header.format = GameDataCache::FORMAT;
+				header.byteOrder = BYTE_ORDER_MARK;
+				header.version = version;
+				uint64_t offset = sizeof(GameDataCache::Header);
+				for (size_t section = 0; section < GameDataCache::SECTION_COUNT; section++) {
+					offset = (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+					header.sections[section] = { offset, sections[section].size() };
+					offset += sections[section].size();
+				}
+				header.size = offset;
+
+				std::vector<uint8_t> file(offset, 0);
+				std::memcpy(file.data(), &header, sizeof(header));
+				for (size_t section = 0; section < GameDataCache::SECTION_COUNT; section++) {
+					if (!sections[section].empty()) {
+						std::memcpy(file.data() + header.sections[section].offset, sections[section].data(), sections[section].size());
+					}
+				}
+				return file;
+			}
+	};
+
+	void writeTables(Writer& writer, const GameTables& tables) {
+		for (const MonsterInfo& monster : tables.getMonsters()) {
+			GameDataCache::MonsterRecord record {};
+			record.name = writer.intern(monster.name);
+			record.damageType = writer.intern(monster.damageType);
+			record.hp = monster.hp;
+			record.attack = monster.attack;
+			record.xp = monster.xp;
+			record.armor = monster.armor;
+			record.resistance = monster.resistance;
+			record.speed = monster.speed;
+			record.range = monster.range;
+			record.frequency = monster.frequency;
+			writer.append(GameDataCache::MONSTERS, record);
+		}
+		for (const SkillInfo& skill : tables.getSkills()) {
+			GameDataCache::SkillRecord record {};
+			record.name = writer.intern(skill.name);
+			record.share = writer.intern(skill.share);
+			record.type = writer.intern(skill.type);
+			record.cooldown = skill.cooldown;
+			record.range = skill.range;
+			record.mp = skill.mp;
+			writer.append(GameDataCache::SKILLS, record);
+		}
+		for (const ItemInfo& item : tables.getItems()) {
+			GameDataCache::ItemRecord record {};
+			record.name = writer.intern(item.name);
+			record.type = writer.intern(item.type);
+			record.slot = writer.intern(item.slot);
+			record.value = item.value;
+			record.tier = item.tier;
+			for (size_t i = 0; i < std::size(ITEM_STATS); i++) {
+				record.stats[i] = item.stats.*ITEM_STATS[i];
+			}
+			writer.append(GameDataCache::ITEMS, record);
+		}
+	}
+
+	void writeLines(Writer& writer, const nlohmann::json& lines) {
+		for (const nlohmann::json& line : lines) {
+			if (line.is_array() && line.size() >= 3) {
+				writer.append(GameDataCache::LINES, GameDataCache::Line { line[0].get<int16_t>(), line[1].get<int16_t>(), line[2].get<int16_t>() });
+			}
+		}
+	}
+
+	void writeGeometry(Writer& writer, const nlohmann::json& G) {
+		auto geometry = G.find("geometry");
+		if (geometry == G.end() || !geometry->is_object()) {
+			return;
+		}
+		auto maps = G.find("maps");
+		for (const auto& [name, value] : geometry->items()) {
+			auto xLines = value.find("x_lines");
+			auto yLines = value.find("y_lines");
+			if (xLines == value.end() || !xLines->is_array() || yLines == value.end() || !yLines->is_array()) {
+				continue;
+			}
+			GameDataCache::MapRecord record {};
+			record.name = writer.intern(name);
+			record.minX = number(value, "min_x");
+			record.minY = number(value, "min_y");
+			record.maxX = number(value, "max_x");
+			record.maxY = number(value, "max_y");
+			record.xLines = writer.count<GameDataCache::Line>(GameDataCache::LINES);
+			writeLines(writer, *xLines);
+			record.xLineCount = writer.count<GameDataCache::Line>(GameDataCache::LINES) - record.xLines;
+			record.yLines = writer.count<GameDataCache::Line>(GameDataCache::LINES);
+			writeLines(writer, *yLines);
+			record.yLineCount = writer.count<GameDataCache::Line>(GameDataCache::LINES) - record.yLines;
+			record.spawns = writer.count<GameDataCache::Spawn>(GameDataCache::SPAWNS);
+			if (maps != G.end() && maps->contains(name)) {
+				const nlohmann::json& map = maps->at(name);
+				if (auto spawns = map.find("spawns"); spawns != map.end() && spawns->is_array()) {
+					for (const nlohmann::json& spawn : *spawns) {
+						if (spawn.is_array() && spawn.size() >= 2) {
+							writer.append(GameDataCache::SPAWNS, GameDataCache::Spawn { spawn[0].get<double>(), spawn[1].get<double>() });
+						}
+					}
+				}
+			}
+			record.spawnCount = writer.count<GameDataCache::Spawn>(GameDataCache::SPAWNS) - record.spawns;
+			writer.append(GameDataCache::MAPS, record);
+		}
+	}
+
+	template <typename T>
+	std::span<const T> slice(std::span<const T> all, uint32_t offset, uint32_t count) {
+		if (uint64_t(offset) + count > all.size()) {
+			return {};
+		}
+		return all.subspan(offset, count);
+	}
+}
+
+GameDataCache::~GameDataCache() {
+	if (base != nullptr) {
+		munmap(const_cast<uint8_t*>(base), length);
+	}
+}
+
+std::shared_ptr<const GameDataCache> GameDataCache::open(const std::string& path, int64_t version) {
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return nullptr;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(Header)) {
+		close(fd);
+		return nullptr;
+	}
+	const size_t length = size_t(info.st_size);
+	void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping keeps the file alive on its own.
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		return nullptr;
+	}
+	std::shared_ptr<const GameDataCache> cache(new GameDataCache(static_cast<const uint8_t*>(mapped), length));
+	if (!isValid(cache->header(), length, version)) {
+		return nullptr;
+	}
+	return cache;
+}
+
+bool GameDataCache::write(const std::string& path, int64_t version, const nlohmann::json& G) {
+	Writer writer;
+	writer.setDocument(nlohmann::json::to_msgpack(G));
+	writeTables(writer, GameTables(G));
+	writeGeometry(writer, G);
+	const std::vector<uint8_t> file = writer.finish(version);
+
+	const std::string temporary = path + ".tmp";
+	std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(file.data()), std::streamsize(file.size()));
+	out.close();
+	if (out.fail()) {
+		std::remove(temporary.c_str());
+		return false;
+	}
+	return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+GameTables GameDataCache::loadTables() const {
+	GameTable<MonsterInfo> monsters;
+	for (const MonsterRecord& record : records<MonsterRecord>(MONSTERS)) {
+		MonsterInfo info;
+		info.name = string(record.name);
+		info.hp = long(record.hp);
+		info.speed = record.speed;
+		info.range = record.range;
+		info.attack = long(record.attack);
+		info.xp = long(record.xp);
+		info.armor = long(record.armor);
+		info.resistance = long(record.resistance);
+		info.frequency = record.frequency;
+		info.damageType = string(record.damageType);
+		monsters.add(std::move(info));
+	}
+	GameTable<SkillInfo> skills;
+	for (const SkillRecord& record : records<SkillRecord>(SKILLS)) {
+		SkillInfo info;
+		info.name = string(record.name);
+		info.cooldown = record.cooldown;
+		info.mp = long(record.mp);
+		info.range = record.range;
+		info.share = string(record.share);
+		info.type = string(record.type);
+		skills.add(std::move(info));
+	}
+	GameTable<ItemInfo> items;
+	for (const ItemRecord& record : records<ItemRecord>(ITEMS)) {
+		ItemInfo info;
+		info.name = string(record.name);
+		info.type = string(record.type);
+		info.slot = string(record.slot);
+		info.value = long(record.value);
+		info.tier = long(record.tier);
+		for (size_t i = 0; i < std::size(ITEM_STATS); i++) {
+			info.stats.*ITEM_STATS[i] = long(record.stats[i]);
+		}
+		items.add(std::move(info));
+	}
+	return GameTables(std::move(monsters), std::move(skills), std::move(items));
+}
+
+GameDataCache::MapGeometry GameDataCache::getMap(size_t index) const {
+	const MapRecord& record = records<MapRecord>(MAPS)[index];
+	const std::span<const Line> lines = records<Line>(LINES);
+	return {
+		string(record.name), record.minX, record.minY, record.maxX, record.maxY,
+		slice(lines, record.xLines, record.xLineCount), slice(lines, record.yLines, record.yLineCount),
+		slice(records<Spawn>(SPAWNS), record.spawns, record.spawnCount)
+	};
+}
+
+bool GameDataCache::findMap(std::string_view name, MapGeometry& geometry) const {
+	const std::span<const MapRecord> maps = records<MapRecord>(MAPS);
+	for (size_t i = 0; i < maps.size(); i++) {
+		if (string(maps[i].name) == name) {
+			geometry = getMap(i);
+			return true;
+		}
+	}
+	return false;
+}
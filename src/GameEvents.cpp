@@ -0,0 +1,312 @@
+#include "albot/GameEvents.hpp"
+
+#include <cstdint>
+
+namespace GameEvents {
+	namespace {
+		inline bool is_space(char c) {
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+		}
+
+		int hex_value(char c) {
+			if (c >= '0' && c <= '9') {
+				return c - '0';
+			}
+			if (c >= 'a' && c <= 'f') {
+				return c - 'a' + 10;
+			}
+			if (c >= 'A' && c <= 'F') {
+				return c - 'A' + 10;
+			}
+			return -1;
+		}
+
+		bool read_hex4(std::string_view str, size_t pos, uint32_t& value) {
+			if (pos + 4 > str.length()) {
+				return false;
+			}
+			value = 0;
+			for (size_t i = pos; i < pos + 4; i++) {
+				const int digit = hex_value(str[i]);
+				if (digit < 0) {
+					return false;
+				}
+				value = (value << 4) | uint32_t(digit);
+			}
+			return true;
+		}
+
+		void append_utf8(std::string& out, uint32_t codepoint) {
+			if (codepoint < 0x80) {
+				out.push_back(char(codepoint));
+			} else if (codepoint < 0x800) {
+				out.push_back(char(0xC0 | (codepoint >> 6)));
+				out.push_back(char(0x80 | (codepoint & 0x3F)));
+			} else if (codepoint < 0x10000) {
+				out.push_back(char(0xE0 | (codepoint >> 12)));
+				out.push_back(char(0x80 | ((codepoint >> 6) & 0x3F)));
+				out.push_back(char(0x80 | (codepoint & 0x3F)));
+			} else {
+				out.push_back(char(0xF0 | (codepoint >> 18)));
+				out.push_back(char(0x80 | ((codepoint >> 12) & 0x3F)));
+				out.push_back(char(0x80 | ((codepoint >> 6) & 0x3F)));
+				out.push_back(char(0x80 | (codepoint & 0x3F)));
+			}
+		}
+
+		/**
+		 * Reads every member of the payload, handing each one to `field`.
+		 */
+		template <typename Field>
+		bool read_fields(std::string_view payload, std::string& scratch, Field field) {
+			FieldReader reader(payload, scratch);
+			std::string_view key;
+			std::string_view value;
+			bool isString = false;
+			while (reader.next(key, value, isString)) {
+				field(key, value, isString);
+			}
+			return reader.isValid();
+		}
+	}
+
+	FieldReader::FieldReader(std::string_view object, std::string& scratch) : json(object), scratch(scratch) {
+		scratch.clear();
+		// Unescaping never makes a string longer, so this is enough for every string in the object.
+		scratch.reserve(object.length());
+		while (pos < json.length() && is_space(json[pos])) {
+			pos++;
+		}
+		valid = pos < json.length() && json[pos] == '{';
+		pos++;
+	}
+
+	bool FieldReader::readString(std::string_view& value) {
+		// pos is on the opening quote.
+		const size_t start = ++pos;
+		while (pos < json.length() && json[pos] != '"' && json[pos] != '\\') {
+			pos++;
+		}
+		if (pos >= json.length()) {
+			return false;
+		}
+		if (json[pos] == '"') {
+			value = json.substr(start, pos - start);
+			pos++;
+			return true;
+		}
+		// Escaped: everything is copied into scratch from here on.
+		const size_t from = scratch.length();
+		scratch.append(json.substr(start, pos - start));
+		while (pos < json.length() && json[pos] != '"') {
+			if (json[pos] != '\\') {
+				scratch.push_back(json[pos++]);
+				continue;
+			}
+			if (++pos >= json.length()) {
+				return false;
+			}
+			switch (json[pos]) {
+				case '"': scratch.push_back('"'); break;
+				case '\\': scratch.push_back('\\'); break;
+				case '/': scratch.push_back('/'); break;
+				case 'b': scratch.push_back('\b'); break;
+				case 'f': scratch.push_back('\f'); break;
+				case 'n': scratch.push_back('\n'); break;
+				case 'r': scratch.push_back('\r'); break;
+				case 't': scratch.push_back('\t'); break;
+				case 'u': {
+					uint32_t codepoint = 0;
+					if (!read_hex4(json, pos + 1, codepoint)) {
+						return false;
+					}
+					pos += 4;
+					// A surrogate pair is two escapes in a row.
+					uint32_t low = 0;
+					if (codepoint >= 0xD800 && codepoint < 0xDC00 && pos + 2 < json.length() && json[pos + 1] == '\\' &&
+						json[pos + 2] == 'u' && read_hex4(json, pos + 3, low) && low >= 0xDC00 && low < 0xE000) {
+						codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+						pos += 6;
+					}
+					append_utf8(scratch, codepoint);
+				} break;
+				default:
+					return false;
+			}
+			pos++;
+		}
+		if (pos >= json.length()) {
+			return false;
+		}
+		pos++;
+		value = std::string_view(scratch).substr(from);
+		return true;
+	}
+
+	bool FieldReader::skipValue() {
+		if (pos >= json.length()) {
+			return false;
+		}
+		if (json[pos] == '"') {
+			std::string_view ignored;
+			const size_t mark = scratch.length();
+			const bool read = readString(ignored);
+			// Nothing points at what a skipped string left in scratch.
+			scratch.resize(mark);
+			return read;
+		}
+		if (json[pos] != '{' && json[pos] != '[') {
+			// A number or a literal runs up to the next delimiter.
+			while (pos < json.length() && json[pos] != ',' && json[pos] != '}' && json[pos] != ']' && !is_space(json[pos])) {
+				pos++;
+			}
+			return true;
+		}
+		size_t depth = 0;
+		while (pos < json.length()) {
+			const char c = json[pos];
+			if (c == '"') {
+				// Strings can hold brackets, skip them as a whole.
+				while (++pos < json.length() && json[pos] != '"') {
+					if (json[pos] == '\\') {
+						pos++;
+					}
+				}
+			} else if (c == '{' || c == '[') {
+				depth++;
+			} else if (c == '}' || c == ']') {
+				if (--depth == 0) {
+					pos++;
+					return true;
+				}
+			}
+			pos++;
+		}
+		return false;
+	}
+
+	bool FieldReader::next(std::string_view& key, std::string_view& value, bool& isString) {
+		if (!valid) {
+			return false;
+		}
+		while (pos < json.length() && (is_space(json[pos]) || json[pos] == ',')) {
+			pos++;
+		}
+		if (pos >= json.length()) {
+			valid = false;
+			return false;
+		}
+		if (json[pos] == '}') {
+			return false;
+		}
+		if (json[pos] != '"' || !readString(key)) {
+			valid = false;
+			return false;
+		}
+		while (pos < json.length() && is_space(json[pos])) {
+			pos++;
+		}
+		if (pos >= json.length() || json[pos] != ':') {
+			valid = false;
+			return false;
+		}
+		pos++;
+		while (pos < json.length() && is_space(json[pos])) {
+			pos++;
+		}
+		const size_t start = pos;
+		isString = pos < json.length() && json[pos] == '"';
+		if (isString ? !readString(value) : !skipValue()) {
+			valid = false;
+			return false;
+		}
+		raw = json.substr(start, pos - start);
+		if (!isString) {
+			value = raw;
+		}
+		return true;
+	}
+
+	bool read(std::string_view payload, std::string& scratch, Cm& event) {
+		event = Cm();
+		FieldReader reader(payload, scratch);
+		std::string_view key;
+		std::string_view value;
+		bool isString = false;
+		while (reader.next(key, value, isString)) {
+			if (key == "name" && isString) {
+				event.name = value;
+			} else if (key == "message") {
+				event.message = reader.getRaw();
+			}
+		}
+		return reader.isValid();
+	}
+	bool read(std::string_view payload, std::string& scratch, Pm& event) {
+		event = Pm();
+		return read_fields(payload, scratch, [&event](std::string_view key, std::string_view value, bool isString) {
+			if (!isString) {
+				return;
+			}
+			if (key == "owner") {
+				event.owner = value;
+			} else if (key == "to") {
+				event.to = value;
+			} else if (key == "message") {
+				event.message = value;
+			}
+		});
+	}
+	bool read(std::string_view payload, std::string& scratch, ChatLog& event) {
+		event = ChatLog();
+		return read_fields(payload, scratch, [&event](std::string_view key, std::string_view value, bool isString) {
+			if (!isString) {
+				return;
+			}
+			if (key == "owner") {
+				event.owner = value;
+			} else if (key == "message") {
+				event.message = value;
+			} else if (key == "id") {
+				event.id = value;
+			}
+		});
+	}
+	bool read(std::string_view payload, std::string& scratch, PartyInvite& event) {
+		event = PartyInvite();
+		return read_fields(payload, scratch, [&event](std::string_view key, std::string_view value, bool isString) {
+			if (isString && key == "name") {
+				event.name = value;
+			}
+		});
+	}
+	bool read(std::string_view payload, std::string& scratch, PartyRequest& event) {
+		event = PartyRequest();
+		return read_fields(payload, scratch, [&event](std::string_view key, std::string_view value, bool isString) {
+			if (isString && key == "name") {
+				event.name = value;
+			}
+		});
+	}
+	bool read(std::string_view payload, std::string& scratch, Disappear& event) {
+		event = Disappear();
+		return read_fields(payload, scratch, [&event](std::string_view key, std::string_view value, bool isString) {
+			if (!isString) {
+				return;
+			}
+			if (key == "id") {
+				event.id = value;
+			} else if (key == "reason") {
+				event.reason = value;
+			}
+		});
+	}
+	bool read(std::string_view payload, std::string& scratch, Death& event) {
+		event = Death();
+		return read_fields(payload, scratch, [&event](std::string_view key, std::string_view value, bool isString) {
+			if (isString && key == "id") {
+				event.id = value;
+			}
+		});
+	}
+}
@@ -6,19 +6,23 @@
 #include <Poco/URI.h>
 #include <fmt/os.h>
 #include <pthread.h>
+#include <chrono>
 #include <fstream>
 #include <ranges>
 #include <regex>
 
+#include "albot/GameDataCache.hpp"
 #include "albot/HttpWrapper.hpp"
 #include "albot/MapProcessing/MapProcessing.hpp"
 
 std::string HttpWrapper::NAME_MACROS = "";
+std::string HttpWrapper::base_url = "http://host.docker.internal";
 nlohmann::json* HttpWrapper::config = nullptr;
 std::shared_ptr<spdlog::logger> HttpWrapper::mLogger =
     spdlog::stdout_color_mt("HttpWrapper");
 GameData HttpWrapper::data = GameData();
 int HttpWrapper::online_version = 0;
+std::mutex HttpWrapper::cookie_mutex;
 std::string HttpWrapper::password = "";
 std::string HttpWrapper::email = "";
 std::string HttpWrapper::session_cookie = "";
@@ -50,7 +54,7 @@ bool HttpWrapper::get_cached_game_version(int& version) {
 bool HttpWrapper::get_game_version(int& version) {
   std::string raw_data;
   mLogger->info("Fetching current game version...");
-  if (HttpWrapper::do_request("http://host.docker.internal/", raw_data)) {
+  if (HttpWrapper::do_request(base_url + "/", raw_data)) {
     std::regex version_regex =
         std::regex("data\\.js\\?v=([0-9]+)\"", std::regex::extended);
     std::smatch sm;
@@ -98,13 +102,41 @@ void HttpWrapper::handleGameJson(MutableGameData& data) {
                 final);
 }
 
+bool HttpWrapper::write_binary_cache(int version) {
+  if (!GameDataCache::write("data.bin", version, HttpWrapper::data.getData())) {
+    mLogger->warn("Failed to write data.bin.");
+    return false;
+  }
+  std::shared_ptr<const GameDataCache> cache =
+      GameDataCache::open("data.bin", version);
+  if (cache == nullptr) {
+    mLogger->warn("Failed to map the data.bin just written.");
+    return false;
+  }
+  HttpWrapper::data = GameData(HttpWrapper::data, cache);
+  return true;
+}
+
 bool HttpWrapper::get_game_data() {
   mLogger->info("Getting game data.");
+  const auto start = std::chrono::steady_clock::now();
+  auto elapsed = [&start]() {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
   int current_version = HttpWrapper::online_version;
   int cached_version = 0;
   if (get_cached_game_version(cached_version)) {
     if (cached_version == current_version ||
         config->at("servicesOnly").get<bool>()) {
+      if (std::shared_ptr<const GameDataCache> cache =
+              GameDataCache::open("data.bin", cached_version)) {
+        HttpWrapper::data = GameData(cache);
+        mLogger->info("Cache version {} is valid. Mapped {} KiB in {:.2f} ms.",
+                      cached_version, cache->getSize() / 1024, elapsed());
+        return true;
+      }
       std::ifstream cached_file("data.json");
       if (cached_file.fail() || !cached_file.is_open()) {
         mLogger->warn("Local cache invalid. Fetching.");
@@ -113,6 +145,9 @@ bool HttpWrapper::get_game_data() {
         mLogger->info("Cache version {} is valid.", cached_version);
         HttpWrapper::data = cached_file;
         cached_file.close();
+        mLogger->info("Parsed data.json in {:.2f} ms.", elapsed());
+        // A cache from before data.bin existed, or one that got damaged.
+        write_binary_cache(cached_version);
         return true;
       }
     } else {
@@ -121,7 +156,7 @@ bool HttpWrapper::get_game_data() {
           current_version, cached_version);
     }
     std::string raw_data;
-    if (HttpWrapper::do_request("http://host.docker.internal/data.js",
+    if (HttpWrapper::do_request(base_url + "/data.js",
                                 raw_data)) {
       mLogger->info("Data fetched! Trimming...");
       raw_data = raw_data.substr(6, raw_data.length() - 8);
@@ -129,14 +164,15 @@ bool HttpWrapper::get_game_data() {
       MutableGameData data = MutableGameData(raw_data);
       HttpWrapper::handleGameJson(data);
       HttpWrapper::data = data;
-      mLogger->info("Data parsed! Writing cache...");
+      mLogger->info("Data parsed in {:.2f} ms! Writing cache...", elapsed());
       fmt::v8::ostream cache_file = fmt::output_file("data.json");
       cache_file.print("{}", data.getData().dump());
       cache_file.close();
+      write_binary_cache(current_version);
       fmt::v8::ostream version_cache = fmt::output_file("GAME_VERSION");
       version_cache.print("{}", current_version);
       version_cache.close();
-      mLogger->info("Cache written!");
+      mLogger->info("Cache written! Cold start took {:.2f} ms.", elapsed());
       return true;
     } else {
       mLogger->error("Fetching data failed! Aborting.");
@@ -164,6 +200,10 @@ bool HttpWrapper::get_config(nlohmann::json& config) {
       mLogger->warn("No services detected.");
       config["services"] = nlohmann::json::array();
     }
+    if (config.contains("url")) {
+      HttpWrapper::base_url = config["url"].get<std::string>();
+      mLogger->info("Using {} instead of the game website.", base_url);
+    }
     HttpWrapper::config = &config;
     mLogger->info("Config reading success!");
     return true;
@@ -192,8 +232,11 @@ bool HttpWrapper::do_post(
   Poco::Net::HTTPResponse response;
 
   request.setContentLength(args.size());
-  if (!session_cookie.empty()) {
-    request.setCookies(HttpWrapper::cookie);
+  {
+    std::lock_guard<std::mutex> lock(cookie_mutex);
+    if (!session_cookie.empty()) {
+      request.setCookies(HttpWrapper::cookie);
+    }
   }
   Poco::Net::HTMLForm form;
   form.add("method", method);
@@ -232,8 +275,11 @@ bool HttpWrapper::do_head(
   Poco::Net::HTTPResponse response;
 
   request.setContentLength(args.size());
-  if (!session_cookie.empty()) {
-    request.setCookies(HttpWrapper::cookie);
+  {
+    std::lock_guard<std::mutex> lock(cookie_mutex);
+    if (!session_cookie.empty()) {
+      request.setCookies(HttpWrapper::cookie);
+    }
   }
   session.sendRequest(request) << args;
 
@@ -259,8 +305,11 @@ bool HttpWrapper::do_request(
   Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, path,
                                  Poco::Net::HTTPMessage::HTTP_1_1);
   Poco::Net::HTTPResponse response;
-  if (!session_cookie.empty()) {
-    request.setCookies(HttpWrapper::cookie);
+  {
+    std::lock_guard<std::mutex> lock(cookie_mutex);
+    if (!session_cookie.empty()) {
+      request.setCookies(HttpWrapper::cookie);
+    }
   }
   session.sendRequest(request);
   std::istream& rs = session.receiveResponse(response);
@@ -273,6 +322,20 @@ bool HttpWrapper::do_request(
   return response.getStatus() == Poco::Net::HTTPResponse::HTTP_OK;
 }
 bool HttpWrapper::login() {
+  return HttpWrapper::fetch_game_version() && HttpWrapper::sign_in();
+}
+bool HttpWrapper::fetch_game_version() {
+  // Attempt to connect to the server. TODO: Get support for HTTP HEADERS verb.
+  if (HttpWrapper::get_game_version(HttpWrapper::online_version)) {
+    mLogger->info("Successfully connected to server! {}",
+                  HttpWrapper::online_version);
+    return true;
+  } else {
+    mLogger->error("Unable to connect to the website. Aborting.");
+    return false;
+  }
+}
+bool HttpWrapper::sign_in() {
   mLogger->info("Attempting to log in...");
   std::ifstream envfile(".env");
   if (envfile.is_open()) {
@@ -283,42 +346,33 @@ bool HttpWrapper::login() {
     std::getline(envfile, HttpWrapper::password);
     size_t passwordPos = HttpWrapper::password.find("password=");
     HttpWrapper::password = HttpWrapper::password.substr(passwordPos + 9);
-    // Attempt to connect to the server. Since we don't need to copy the
-    // output, We pass a nullptr for the output. TODO: Get support for HTTP
-    // HEADERS verb.
-    if (HttpWrapper::get_game_version(HttpWrapper::online_version)) {
-      mLogger->info("Successfully connected to server! {}",
-                    HttpWrapper::online_version);
-      std::string args = fmt::format(
-          "{{\"email\":\"{}\",\"password\":\"{}\",\"only_login\":true}}", email,
-          password);
-      std::vector<Poco::Net::HTTPCookie> cookies;
-      // Again, we don't *really* care about the output the server sends us...
-      // We just want the cookies.
-      std::string out;
-      if (HttpWrapper::api_method("signup_or_login", args, out, cookies)) {
-        for (size_t i = 0; i < cookies.size(); i++) {
-          Poco::Net::HTTPCookie _cookie = cookies[i];
-          if (_cookie.getName() == "auth") {
-            HttpWrapper::session_cookie = _cookie.getValue();
-            HttpWrapper::cookie.set("auth", session_cookie);
-            size_t pos = session_cookie.find('-');
-            HttpWrapper::userID = HttpWrapper::session_cookie.substr(0, pos);
-            HttpWrapper::auth = HttpWrapper::session_cookie.substr(
-                pos + 1, HttpWrapper::session_cookie.length());
-            mLogger->info("Logged in!");
-            return true;
-          }
+    std::string args = fmt::format(
+        "{{\"email\":\"{}\",\"password\":\"{}\",\"only_login\":true}}", email,
+        password);
+    std::vector<Poco::Net::HTTPCookie> cookies;
+    // We don't *really* care about the output the server sends us...
+    // We just want the cookies.
+    std::string out;
+    if (HttpWrapper::api_method("signup_or_login", args, out, cookies)) {
+      for (size_t i = 0; i < cookies.size(); i++) {
+        Poco::Net::HTTPCookie _cookie = cookies[i];
+        if (_cookie.getName() == "auth") {
+          std::lock_guard<std::mutex> lock(cookie_mutex);
+          HttpWrapper::session_cookie = _cookie.getValue();
+          HttpWrapper::cookie.set("auth", session_cookie);
+          size_t pos = session_cookie.find('-');
+          HttpWrapper::userID = HttpWrapper::session_cookie.substr(0, pos);
+          HttpWrapper::auth = HttpWrapper::session_cookie.substr(
+              pos + 1, HttpWrapper::session_cookie.length());
+          mLogger->info("Logged in!");
+          return true;
         }
-        mLogger->error("Unable to find login auth cookie. Aborting.");
-        return false;
       }
-      mLogger->error("Unable to connect to login API. Aborting.");
-      return false;
-    } else {
-      mLogger->error("Unable to connect to the website. Aborting.");
+      mLogger->error("Unable to find login auth cookie. Aborting.");
       return false;
     }
+    mLogger->error("Unable to connect to login API. Aborting.");
+    return false;
   } else {
     mLogger->error(".env file does not exist! Aborting.");
     return false;
@@ -483,6 +537,6 @@ bool HttpWrapper::api_method(
     std::optional<std::reference_wrapper<std::vector<Poco::Net::HTTPCookie>>>
         cookies) {
   return HttpWrapper::do_post(
-      fmt::format("http://host.docker.internal/api/{}", method), args, method,
+      fmt::format("{}/api/{}", base_url, method), args, method,
       out, cookies);
 }
\ No newline at end of file
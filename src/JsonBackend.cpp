@@ -0,0 +1,38 @@
+#include "albot/JsonBackend.hpp"
+
+/**
+ * The SAX decoder from EntityDecoder. Available in every build.
+ */
+class NlohmannBackend : public JsonBackend {
+	public:
+		std::string_view getName() const override {
+			return "nlohmann";
+		}
+		bool decodeEntities(std::string_view payload, EntityBatch& batch, const MonsterTable& monsters, std::string_view expectedMap) override {
+			return EntityDecoder::decodeEntities(payload, batch, monsters, expectedMap);
+		}
+		bool decodeWrapped(std::string_view payload, EntityBatch& batch, const MonsterTable& monsters) override {
+			return EntityDecoder::decodeWrapped(payload, batch, monsters);
+		}
+};
+
+std::unique_ptr<JsonBackend> JsonBackend::create(std::string_view name) {
+#ifdef ALBOT_HAS_SIMDJSON
+	if (name.empty() || name == "simdjson") {
+		return createSimdJsonBackend();
+	}
+#endif
+	if (name.empty() || name == "nlohmann") {
+		return std::make_unique<NlohmannBackend>();
+	}
+	return nullptr;
+}
+
+std::vector<std::string_view> JsonBackend::getAvailable() {
+	return {
+#ifdef ALBOT_HAS_SIMDJSON
+		"simdjson",
+#endif
+		"nlohmann"
+	};
+}
@@ -0,0 +1,175 @@
+#include "albot/MovementKernel.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define ALBOT_KERNEL_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+// The AVX2 path is compiled for AVX2 on its own, and only taken if the CPU has it.
+#define ALBOT_KERNEL_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+namespace {
+	size_t settleScalar(const MovementKernel::Columns& c, size_t begin, double time, uint32_t activeMask, uint32_t activeValue) {
+		size_t arrivals = 0;
+		for (size_t i = begin; i < c.count; i++) {
+			uint8_t arrived = 0;
+			if ((c.flags[i] & activeMask) == activeValue) {
+				if (time >= c.arriveAt[i]) {
+					c.x[i] = c.goingX[i];
+					c.y[i] = c.goingY[i];
+					arrived = 1;
+					arrivals++;
+				} else {
+					const double elapsed = time - c.movedAt[i];
+					c.x[i] = c.x[i] + c.vx[i] * elapsed / 1000.0;
+					c.y[i] = c.y[i] + c.vy[i] * elapsed / 1000.0;
+				}
+				c.movedAt[i] = time;
+			}
+			c.arrived[i] = arrived;
+		}
+		return arrivals;
+	}
+
+#ifdef ALBOT_KERNEL_SSE2
+	inline __m128d select(__m128d mask, __m128d whenSet, __m128d otherwise) {
+		return _mm_or_pd(_mm_and_pd(mask, whenSet), _mm_andnot_pd(mask, otherwise));
+	}
+
+	size_t settleSse2(const MovementKernel::Columns& c, double time, uint32_t activeMask, uint32_t activeValue) {
+		const __m128d now = _mm_set1_pd(time);
+		const __m128d thousand = _mm_set1_pd(1000.0);
+		const __m128i vmask = _mm_set1_epi32(int(activeMask));
+		const __m128i vvalue = _mm_set1_epi32(int(activeValue));
+		size_t arrivals = 0;
+		size_t i = 0;
+		for (; i + 2 <= c.count; i += 2) {
+			const __m128i flags = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(c.flags + i));
+			const __m128i active32 = _mm_cmpeq_epi32(_mm_and_si128(flags, vmask), vvalue);
+			const __m128d active = _mm_castsi128_pd(_mm_unpacklo_epi32(active32, active32));
+			if (_mm_movemask_pd(active) == 0) {
+				c.arrived[i] = 0;
+				c.arrived[i + 1] = 0;
+				continue;
+			}
+			const __m128d x = _mm_loadu_pd(c.x + i);
+			const __m128d y = _mm_loadu_pd(c.y + i);
+			const __m128d movedAt = _mm_loadu_pd(c.movedAt + i);
+			const __m128d elapsed = _mm_sub_pd(now, movedAt);
+			const __m128d arrived = _mm_and_pd(active, _mm_cmpge_pd(now, _mm_loadu_pd(c.arriveAt + i)));
+			__m128d nextX = _mm_add_pd(x, _mm_div_pd(_mm_mul_pd(_mm_loadu_pd(c.vx + i), elapsed), thousand));
+			__m128d nextY = _mm_add_pd(y, _mm_div_pd(_mm_mul_pd(_mm_loadu_pd(c.vy + i), elapsed), thousand));
+			nextX = select(arrived, _mm_loadu_pd(c.goingX + i), nextX);
+			nextY = select(arrived, _mm_loadu_pd(c.goingY + i), nextY);
+			_mm_storeu_pd(c.x + i, select(active, nextX, x));
+			_mm_storeu_pd(c.y + i, select(active, nextY, y));
+			_mm_storeu_pd(c.movedAt + i, select(active, now, movedAt));
+			const int bits = _mm_movemask_pd(arrived);
+			c.arrived[i] = bits & 1;
+			c.arrived[i + 1] = (bits >> 1) & 1;
+			arrivals += (bits & 1) + ((bits >> 1) & 1);
+		}
+		return arrivals + settleScalar(c, i, time, activeMask, activeValue);
+	}
+#endif
+
+#ifdef ALBOT_KERNEL_AVX2
+	__attribute__((target("avx2")))
+	size_t settleAvx2(const MovementKernel::Columns& c, double time, uint32_t activeMask, uint32_t activeValue) {
+		const __m256d now = _mm256_set1_pd(time);
+		const __m256d thousand = _mm256_set1_pd(1000.0);
+		const __m128i vmask = _mm_set1_epi32(int(activeMask));
+		const __m128i vvalue = _mm_set1_epi32(int(activeValue));
+		size_t arrivals = 0;
+		size_t i = 0;
+		for (; i + 4 <= c.count; i += 4) {
+			const __m128i flags = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c.flags + i));
+			const __m128i active32 = _mm_cmpeq_epi32(_mm_and_si128(flags, vmask), vvalue);
+			// Sign extension turns every all-ones lane into an all-ones 64-bit lane.
+			const __m256d active = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(active32));
+			if (_mm256_movemask_pd(active) == 0) {
+				c.arrived[i] = 0;
+				c.arrived[i + 1] = 0;
+				c.arrived[i + 2] = 0;
+				c.arrived[i + 3] = 0;
+				continue;
+			}
+			const __m256d x = _mm256_loadu_pd(c.x + i);
+			const __m256d y = _mm256_loadu_pd(c.y + i);
+			const __m256d movedAt = _mm256_loadu_pd(c.movedAt + i);
+			const __m256d elapsed = _mm256_sub_pd(now, movedAt);
+			const __m256d arrived = _mm256_and_pd(active, _mm256_cmp_pd(now, _mm256_loadu_pd(c.arriveAt + i), _CMP_GE_OS));
+			__m256d nextX = _mm256_add_pd(x, _mm256_div_pd(_mm256_mul_pd(_mm256_loadu_pd(c.vx + i), elapsed), thousand));
+			__m256d nextY = _mm256_add_pd(y, _mm256_div_pd(_mm256_mul_pd(_mm256_loadu_pd(c.vy + i), elapsed), thousand));
+			nextX = _mm256_blendv_pd(nextX, _mm256_loadu_pd(c.goingX + i), arrived);
+			nextY = _mm256_blendv_pd(nextY, _mm256_loadu_pd(c.goingY + i), arrived);
+			_mm256_storeu_pd(c.x + i, _mm256_blendv_pd(x, nextX, active));
+			_mm256_storeu_pd(c.y + i, _mm256_blendv_pd(y, nextY, active));
+			_mm256_storeu_pd(c.movedAt + i, _mm256_blendv_pd(movedAt, now, active));
+			const int bits = _mm256_movemask_pd(arrived);
+			for (size_t lane = 0; lane < 4; lane++) {
+				c.arrived[i + lane] = (bits >> lane) & 1;
+			}
+			arrivals += __builtin_popcount(bits);
+		}
+		return arrivals + settleScalar(c, i, time, activeMask, activeValue);
+	}
+#endif
+}
+
+bool MovementKernel::isSupported(Isa isa) {
+	switch (isa) {
+		case SCALAR:
+			return true;
+		case SSE2:
+#ifdef ALBOT_KERNEL_SSE2
+			return true;
+#else
+			return false;
+#endif
+		case AVX2:
+#ifdef ALBOT_KERNEL_AVX2
+			return __builtin_cpu_supports("avx2");
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
+MovementKernel::Isa MovementKernel::best() {
+	static const Isa isa = isSupported(AVX2) ? AVX2 : isSupported(SSE2) ? SSE2 : SCALAR;
+	return isa;
+}
+
+const char* MovementKernel::getName(Isa isa) {
+	switch (isa) {
+		case SCALAR:
+			return "scalar";
+		case SSE2:
+			return "sse2";
+		case AVX2:
+			return "avx2";
+	}
+	return "unknown";
+}
+
+size_t MovementKernel::settle(const Columns& columns, double time, uint32_t activeMask, uint32_t activeValue, Isa isa) {
+	if (!isSupported(isa)) {
+		isa = SCALAR;
+	}
+	switch (isa) {
+#ifdef ALBOT_KERNEL_AVX2
+		case AVX2:
+			return settleAvx2(columns, time, activeMask, activeValue);
+#endif
+#ifdef ALBOT_KERNEL_SSE2
+		case SSE2:
+			return settleSse2(columns, time, activeMask, activeValue);
+#endif
+		default:
+			return settleScalar(columns, 0, time, activeMask, activeValue);
+	}
+}
@@ -0,0 +1,218 @@
+#include "albot/JsonBackend.hpp"
+
+#include <simdjson.h>
+
+/**
+ * Decodes entity payloads with simdjson's On Demand API: the payload is indexed with SIMD
+ * instructions, and values are only materialized when a typed field asks for them.
+ * Produces exactly the same batches as the nlohmann SAX decoder.
+ */
+class SimdJsonBackend : public JsonBackend {
+	private:
+		simdjson::ondemand::parser parser;
+		// simdjson reads up to SIMDJSON_PADDING bytes past the end of its input, and frames
+		// coming from the websocket have no such guarantee. Copied here, and reused between frames.
+		std::string scratch;
+
+		simdjson::padded_string_view pad(std::string_view payload) {
+			if (scratch.capacity() < payload.size() + simdjson::SIMDJSON_PADDING) {
+				scratch.reserve(payload.size() + simdjson::SIMDJSON_PADDING);
+			}
+			scratch.assign(payload.data(), payload.size());
+			return simdjson::padded_string_view(scratch.data(), scratch.size(), scratch.capacity());
+		}
+
+		/**
+		 * A number that has already been read, keeping integers integers like nlohmann would.
+		 */
+		static nlohmann::json toJson(simdjson::ondemand::number number) {
+			switch (number.get_number_type()) {
+				case simdjson::ondemand::number_type::signed_integer:
+					return number.get_int64();
+				case simdjson::ondemand::number_type::unsigned_integer:
+					return number.get_uint64();
+				default:
+					return number.get_double();
+			}
+		}
+
+		static void setExtra(EntityRecord& record, std::string_view key, nlohmann::json value) {
+			if (!record.has(EntityRecord::EXTRA)) {
+				record.extra = nlohmann::json::object();
+				record.fields |= EntityRecord::EXTRA;
+			}
+			record.extra[std::string(key)] = std::move(value);
+		}
+
+		/**
+		 * Copies a value without a typed home into the DOM, without going through text again.
+		 */
+		static nlohmann::json toJson(simdjson::ondemand::value value) {
+			switch (value.type()) {
+				case simdjson::ondemand::json_type::object: {
+					nlohmann::json object = nlohmann::json::object();
+					for (simdjson::ondemand::field field : value.get_object()) {
+						std::string key(field.unescaped_key().value());
+						object[std::move(key)] = toJson(field.value());
+					}
+					return object;
+				}
+				case simdjson::ondemand::json_type::array: {
+					nlohmann::json array = nlohmann::json::array();
+					for (simdjson::ondemand::value element : value.get_array()) {
+						array.push_back(toJson(element));
+					}
+					return array;
+				}
+				case simdjson::ondemand::json_type::number:
+					return toJson(simdjson::ondemand::number(value.get_number()));
+				case simdjson::ondemand::json_type::string:
+					return std::string_view(value.get_string());
+				case simdjson::ondemand::json_type::boolean:
+					return bool(value.get_bool());
+				default:
+					return nullptr;
+			}
+		}
+
+		static void decodeRecord(simdjson::ondemand::object object, EntityRecord& record, bool monster) {
+			for (simdjson::ondemand::field field : object) {
+				std::string_view key = field.unescaped_key();
+				simdjson::ondemand::value value = field.value();
+				switch (value.type()) {
+					// On Demand only lets a value be read once, so scalars that miss a typed field go
+					// into the extras from what was already read.
+					case simdjson::ondemand::json_type::number: {
+						simdjson::ondemand::number number = value.get_number();
+						if (!record.setNumber(key, number.as_double())) {
+							setExtra(record, key, toJson(number));
+						}
+						continue;
+					}
+					case simdjson::ondemand::json_type::boolean: {
+						const bool flag = value.get_bool();
+						if (!record.setNumber(key, flag ? 1 : 0)) {
+							setExtra(record, key, flag);
+						}
+						continue;
+					}
+					case simdjson::ondemand::json_type::null:
+						if (key == "target") {
+							record.target.clear();
+							record.fields |= EntityRecord::TARGET;
+							continue;
+						}
+						break;
+					case simdjson::ondemand::json_type::string:
+						if (key == "id") {
+							record.id = std::string_view(value.get_string());
+							continue;
+						}
+						if (key == "target") {
+							record.target = std::string_view(value.get_string());
+							record.fields |= EntityRecord::TARGET;
+							continue;
+						}
+						// Monsters send their mtype as `type`, characters send `ctype`.
+						if ((key == "type" && monster) || key == "ctype") {
+							record.type = std::string_view(value.get_string());
+							record.fields |= EntityRecord::TYPE;
+							continue;
+						}
+						if (key == "type") {
+							continue;
+						}
+						break;
+					default:
+						break;
+				}
+				setExtra(record, key, toJson(value));
+			}
+		}
+
+		/**
+		 * @returns  false if the batch turned out to be for another map. Parsing stops there.
+		 */
+		static bool decodeBody(simdjson::ondemand::object object, EntityBatch& batch, const MonsterTable& monsters, std::string_view expectedMap) {
+			for (simdjson::ondemand::field field : object) {
+				std::string_view key = field.unescaped_key();
+				simdjson::ondemand::value value = field.value();
+				bool players = key == "players";
+				if (players || key == "monsters") {
+					if (value.type() != simdjson::ondemand::json_type::array) {
+						continue;
+					}
+					for (simdjson::ondemand::value element : value.get_array()) {
+						if (element.type() != simdjson::ondemand::json_type::object) {
+							continue;
+						}
+						EntityRecord record;
+						decodeRecord(element.get_object(), record, !players);
+						if (record.id.empty()) {
+							continue;
+						}
+						record.kind = players ? EntityRecord::CHARACTER : EntityRecord::MONSTER;
+						record.fillDefaults(monsters);
+						batch.records.push_back(std::move(record));
+					}
+					continue;
+				}
+				if (value.type() != simdjson::ondemand::json_type::string) {
+					continue;
+				}
+				if (key == "type") {
+					batch.type = std::string_view(value.get_string());
+				} else if (key == "in") {
+					batch.in = std::string_view(value.get_string());
+				} else if (key == "map") {
+					batch.map = std::string_view(value.get_string());
+					if (!expectedMap.empty() && batch.map != expectedMap) {
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+	public:
+		std::string_view getName() const override {
+			return "simdjson";
+		}
+
+		bool decodeEntities(std::string_view payload, EntityBatch& batch, const MonsterTable& monsters, std::string_view expectedMap) override {
+			try {
+				simdjson::ondemand::document document = parser.iterate(pad(payload));
+				decodeBody(document.get_object(), batch, monsters, expectedMap);
+			} catch (const simdjson::simdjson_error&) {
+				return false;
+			} catch (const nlohmann::json::exception&) {
+				return false;
+			}
+			batch.finish(expectedMap);
+			return true;
+		}
+
+		bool decodeWrapped(std::string_view payload, EntityBatch& batch, const MonsterTable& monsters) override {
+			try {
+				simdjson::ondemand::document document = parser.iterate(pad(payload));
+				for (simdjson::ondemand::field field : document.get_object()) {
+					std::string name(field.unescaped_key().value());
+					simdjson::ondemand::value value = field.value();
+					if (name == "entities" && value.type() == simdjson::ondemand::json_type::object) {
+						decodeBody(value.get_object(), batch, monsters, {});
+					} else {
+						batch.rest[name] = toJson(value);
+					}
+				}
+			} catch (const simdjson::simdjson_error&) {
+				return false;
+			} catch (const nlohmann::json::exception&) {
+				return false;
+			}
+			batch.finish({});
+			return true;
+		}
+};
+
+std::unique_ptr<JsonBackend> createSimdJsonBackend() {
+	return std::make_unique<SimdJsonBackend>();
+}
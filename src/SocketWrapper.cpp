@@ -1,7 +1,10 @@
 #include "albot/SocketWrapper.hpp"
 #include <algorithm>
+#include <cmath>
+#include <iterator>
 #include <iostream>
 #include <regex>
+#include <set>
 #include "albot/MovementMath.hpp"
 
 #include <spdlog/sinks/stdout_color_sinks.h>
@@ -18,14 +21,36 @@ inline T getOrElse(const nlohmann::json& n, K key, T defaultValue) {
     return n[key].template get<T>();
 }
 
+namespace {
+    void appendEscaped(std::string& out, std::string_view value) {
+        out += '"';
+        for (char c : value) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (uint8_t(c) < 0x20) {
+                        fmt::format_to(std::back_inserter(out), "\\u{:04x}", int(c));
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        out += '"';
+    }
+}
+
 SocketWrapper::SocketWrapper(std::string characterId, std::string fullUrl, Bot& player)
-    : webSocket(), player(player), characterId(characterId), hasReceivedFirstEntities(false) {
+    : webSocket(), player(player), characterId(characterId), hasReceivedFirstEntities(false), inbound(8192) {
     // In order to faciliate for websocket connection, a special URL needs to be used.
     // By adding this, the connection can be established as a websocket connection.
     // A real socket.io client likely uses this or something similar internally
     this->mLogger =
         spdlog::stdout_color_mt(player.info.character->name + ":SocketWrapper");
-    fullUrl = "host.docker.internal:8022";
+    fullUrl = player.info.socketUrl.empty() ? "host.docker.internal:8022" : player.info.socketUrl;
     std::cout << "full URL " << fullUrl << std::endl;
     fullUrl += "/socket.io/?EIO=4&transport=websocket";
     if (fullUrl.find("ws://") == std::string::npos) {
@@ -34,8 +59,15 @@ SocketWrapper::SocketWrapper(std::string characterId, std::string fullUrl, Bot&
       this->webSocket.setUrl(fullUrl);
     }
     this->webSocket.disableAutomaticReconnection();  // turn off
+    setCompression(player.info.compression);
+    if (!player.info.capturePath.empty()) {
+        setRecorder(WireCapture::Recorder::open(player.info.capturePath));
+    }
     this->pingInterval = 4000;
     lastPing = std::chrono::high_resolution_clock::now();
+    monsterTable = MonsterTable(player.info.G);
+    jsonBackend = JsonBackend::create();
+    mLogger->info("Decoding inbound events with {}", jsonBackend->getName());
 
     initializeSystem();
 }
@@ -43,67 +75,130 @@ SocketWrapper::~SocketWrapper() {
     webSocket.close();
 }
 
-void SocketWrapper::sanitizeInput(nlohmann::json& entity) {
-    if (entity.find("rip") != entity.end()) {
-        if (entity["rip"].is_number()) {
-            entity["rip"] = (int(entity["rip"]) == 1);
-        }
+void SocketWrapper::setCompression(bool enabled) {
+    compression = enabled;
+    // Server and client both get the full 32 KiB window, and keep it between messages:
+    // start, entities and new_map repeat the same keys over and over.
+    this->webSocket.setPerMessageDeflateOptions(ix::WebSocketPerMessageDeflateOptions(enabled, false, false, 15, 15));
+}
+
+void SocketWrapper::setRecorder(std::shared_ptr<WireCapture::Recorder> recorder) {
+    if (recorder && !recorder->isOpen()) {
+        this->mLogger->error("Can't write the wire capture, recording is disabled.");
+        recorder = nullptr;
     }
+    this->recorder = recorder;
 }
 
-void SocketWrapper::handle_entities(const nlohmann::json& event) {
-    const std::string MAP = event["map"].get<std::string>();
-    const std::string IN = event["in"].get<std::string>();
-    if (event.find("players") != event.end()) {
-        nlohmann::json players = event["players"];
-        for (auto& player : players) {
+void SocketWrapper::setReplaying(bool replaying) {
+    this->replaying = replaying;
+}
 
-            sanitizeInput(player);
-            player["in"] = IN;
-            player["map"] = MAP;
-            player["type"] = "character";
-            player["base"] = { {"h", 8}, {"v", 7}, {"vn", 2} };
-            auto id = player["id"].get<std::string>();
+void SocketWrapper::replayMessage(const std::string& frame) {
+    messageReceiver(std::make_unique<ix::WebSocketMessage>(ix::WebSocketMessageType::Message, frame, frame.size(),
+        ix::WebSocketErrorInfo(), ix::WebSocketOpenInfo(), ix::WebSocketCloseInfo()));
+}
 
-            if (id == this->player.name) {
-                this->player.updateCharacter(player);
-            }
-            // Avoid data loss by updating the JSON rather than overwriting
-            if (this->updatedEntities.find(id) == updatedEntities.end())
-                this->updatedEntities[id] = player;
-            else {
-                this->updatedEntities[id].update(player);
-            }
-        }
+void SocketWrapper::send(const std::string& frame) {
+    if (replaying) {
+        return;
     }
+    if (recorder) {
+        recorder->write(WireCapture::OUTBOUND, player.id, frame);
+    }
+    ix::WebSocketSendInfo info = this->webSocket.send(frame);
+    if (info.success) {
+        compressionStats.outboundMessages++;
+        compressionStats.outboundBytes += info.payloadSize;
+        compressionStats.outboundWireBytes += info.wireSize;
+    }
+}
 
-    if (event.find("monsters") != event.end()) {
-        nlohmann::json monsters = event["monsters"];
-
-        for (auto& monster : monsters) {
-            auto id = monster["id"].get<std::string>();
+void SocketWrapper::logCompressionStats() {
+    const CompressionStats& stats = compressionStats;
+    this->mLogger->info("permessage-deflate {}. In: {} messages, {} bytes on the wire, {} inflated (ratio {:.2f}). Out: {} messages, {} bytes on the wire, {} deflated (ratio {:.2f}).",
+        stats.negotiated ? "negotiated" : (compression ? "declined by the server" : "disabled"),
+        stats.inboundMessages.load(), stats.inboundWireBytes.load(), stats.inboundBytes.load(), stats.getInboundRatio(),
+        stats.outboundMessages.load(), stats.outboundWireBytes.load(), stats.outboundBytes.load(), stats.getOutboundRatio());
+}
 
-            sanitizeInput(monster);
-            monster["in"] = IN;
-            monster["map"] = MAP;
-            monster["mtype"] = monster["type"].get<std::string>();
-            monster["type"] = "monster";
+void SocketWrapper::post(std::function<void()> update) {
+    if (!inbound.push({ Types::Clock::now(), std::move(update) })) {
+        inboundOverflowCount++;
+        // The world is missing a change now. Until the resend comes in, whatever arrives is
+        // still applied, it's just not guaranteed to be the whole picture.
+        if (!requestedResync) {
+            requestedResync = true;
+            this->mLogger->error("The bot's loop fell {} changes behind, asking the server to send everything again.", inbound.capacity());
+            emit("send_updates", nlohmann::json::object());
+        }
+        return;
+    }
+    size_t depth = inbound.size();
+    size_t highWater = inboundHighWater.load(std::memory_order_relaxed);
+    while (depth > highWater && !inboundHighWater.compare_exchange_weak(highWater, depth, std::memory_order_relaxed)) {
+    }
+}
 
-            if (monster.find("max_hp") == monster.end()) {
-                monster["max_hp"] = this->player.info.G->getData()["monsters"][std::string(monster["mtype"])]["hp"];
-            }
+size_t SocketWrapper::applyInbound() {
+    InboundUpdate update;
+    size_t applied = 0;
+    while (inbound.pop(update)) {
+        applyLatency.record(Types::Clock::now() - update.queuedAt);
+        update.apply();
+        applied++;
+    }
+    return applied;
+}
 
-            if (monster.find("hp") == monster.end()) {
-                monster["hp"] = monster["max_hp"];
+void SocketWrapper::applyEntities(const EntityBatch& batch, bool snapshot) {
+    if (snapshot) {
+        // After a (re)connect or map change, whatever the snapshot doesn't mention is gone.
+        // Everything else is merged in place like any other update, so the world is never rebuilt.
+        std::set<std::string_view> ids;
+        for (const EntityRecord& record : batch.records) {
+            ids.insert(record.id);
+        }
+        // Backwards, since erasing moves the last row into the erased one.
+        for (size_t row = entities.size(); row-- > 0;) {
+            if (!ids.contains(entities[row].getId())) {
+                journal.remove(entities[row].getId());
+                entities.erase(row);
             }
+        }
+    }
+    for (const EntityRecord& record : batch.records) {
+        if (record.kind == EntityRecord::CHARACTER && record.id == this->player.name) {
+            nlohmann::json patch = nlohmann::json::object();
+            record.apply(patch);
+            patchCharacter(patch);
+        }
+        journal.record(record.id, entities.apply(record));
+        EntityStore::Entity entity = *entities.find(record.id);
+        if (entity.isMonster() && !entity.has(EntityRecord::SPEED)) {
+            const auto* monster = monsterTable.find(entity.getType());
+            entities.setDefaultSpeed(entity.getRow(), monster != nullptr ? monster->speed : 0.0);
+        }
+    }
+}
 
-            if (this->updatedEntities.find(id) == updatedEntities.end())
-                this->updatedEntities[id] = monster;
-            else {
-                this->updatedEntities[id].update(monster);
-            }
+void SocketWrapper::patchCharacter(const nlohmann::json& patch) {
+    if (!character.is_object()) {
+        character = nlohmann::json::object();
+    }
+    uint32_t changed = 0;
+    for (const auto& [key, value] : patch.items()) {
+        auto it = character.find(key);
+        if (it == character.end()) {
+            character.emplace(key, value);
+        } else if (*it != value) {
+            *it = value;
+        } else {
+            continue;
         }
+        changed |= EntityRecord::fieldOf(key);
     }
+    journal.record(this->player.name, changed);
 }
 void SocketWrapper::initializeSystem() {
     this->webSocket.setOnMessageCallback(
@@ -111,120 +206,148 @@ void SocketWrapper::initializeSystem() {
 
     // Loading
 
-    this->registerEventCallback("welcome", [this](const nlohmann::json&) {
+    this->registerEventCallback(EventEnum::WELCOME, [this](const nlohmann::json&) {
         this->emit("loaded", { {"success", 1}, {"width",1920},{"height",1080},{"scale",2} });
         this->login(this->player.info);
     });
 
-    this->registerEventCallback("start", [this](const nlohmann::json& event) {
-        nlohmann::json entities = event["entities"];
-        // The start event contains necessary data to populate the character
-        nlohmann::json mut = event;
-
-        mut.erase("entities");
+    this->registerPayloadCallback(EventEnum::START, [this](std::string_view payload) {
+        // The start event contains necessary data to populate the character,
+        // and the entities around it. The latter are decoded straight into records.
+        EntityBatch batch;
+        if (!jsonBackend->decodeWrapped(payload, batch, monsterTable)) {
+            mLogger->error("Failed to decode start event.");
+            return;
+        }
+        nlohmann::json& mut = batch.rest;
         // Used for, among other things, canMove. This contains the character bounding box
         // h = horizontal, v = vertical, vn = vertical negative
         mut["base"] = { {"h", 8}, {"v", 7}, {"vn", 2} };
-        mLogger->info("Started in map {} ", event["map"].get<std::string>());
-        std::lock_guard<std::mutex> guard(entityGuard);
-        getUpdateEntities().clear();
-        handle_entities(entities);
-        this->player.updateCharacter(mut);
+        currentMap = mut["map"].get<std::string>();
+        mLogger->info("Started in map {} ", currentMap);
+        requestedResync = false;
+        post([this, batch = std::move(batch)]() {
+            applyEntities(batch, true);
+            patchCharacter(batch.rest);
+        });
+        // Queued first, so the loop this resumes starts with the snapshot.
         this->player.onConnect();
     });
     // Loading + gameplay
-    this->registerEventCallback("entities", [this](const nlohmann::json& event) {
-        std::lock_guard<std::mutex> guard(entityGuard);
-        std::string type = event["type"].get<std::string>();
-        if (type == "all") {
-            getUpdateEntities().clear();
+    this->registerPayloadCallback(EventEnum::ENTITIES, [this](std::string_view payload) {
+        EntityBatch batch;
+        // Entities for any map but ours are dropped while decoding.
+        if (!jsonBackend->decodeEntities(payload, batch, monsterTable, currentMap)) {
+            mLogger->error("Failed to decode entities event.");
+            return;
+        }
+        if (batch.wrongMap) {
+            return;
+        }
+        const bool snapshot = batch.type == "all";
+        if (snapshot) {
+            requestedResync = false;
         }
-        handle_entities(event);
+        post([this, batch = std::move(batch), snapshot]() {
+            applyEntities(batch, snapshot);
+        });
     });
 
     // Gameplay
 
     // Methods recording the disappearance of entities.
     // Death is also registered locally using this socket event
-    this->registerEventCallback("death", [this](const nlohmann::json& event) {
+    this->registerEventCallback(EventEnum::DEATH, [this](const nlohmann::json& event) {
         nlohmann::json copy = event;
         copy["death"] = true;
         onDisappear(copy);
     });
 
-    this->registerEventCallback("disappear", [this](const nlohmann::json& event) {
+    this->registerEventCallback(EventEnum::DISAPPEAR, [this](const nlohmann::json& event) {
         onDisappear(event);
     });
-    this->registerEventCallback("notthere", [this](const nlohmann::json& event) {
+    this->registerEventCallback(EventEnum::NOTTHERE, [this](const nlohmann::json& event) {
         onDisappear(event);
     });
 
     // Chests are recorded with the drop event
-    this->registerEventCallback("drop", [this](const nlohmann::json& event) {
-        std::lock_guard<std::mutex> guard(chestGuard);
-        chests.emplace(event["id"].get<std::string>(), event);
+    this->registerEventCallback(EventEnum::DROP, [this](const nlohmann::json& event) {
+        post([this, event]() {
+            chests.emplace(event["id"].get<std::string>(), event);
+        });
     });
-    this->registerEventCallback("chest_opened", [this](const nlohmann::json& event) {
-        std::lock_guard<std::mutex> guard(chestGuard);
-        chests.erase(event["id"].get<std::string>());
+    this->registerEventCallback(EventEnum::CHEST_OPENED, [this](const nlohmann::json& event) {
+        post([this, id = event["id"].get<std::string>()]() {
+            chests.erase(id);
+        });
     });
     // This contains updates to the player entity. Unlike other entities (AFAIK), these aren't
     // sent using the entities event.
-    this->registerEventCallback("player", [this](const nlohmann::json& event) {
-        std::lock_guard<std::mutex> guard(entityGuard);
-        nlohmann::json copy = event;
-        nlohmann::json& playerJson = player.getUpdateCharacter();
-        if (copy.contains("moving") && copy["moving"]) {
-            if (copy.contains("speed") && playerJson.contains("speed") && double(copy["speed"]) != double(playerJson["speed"])) {
-                copy["from_x"] = event["x"];
-                copy["from_y"] = event["y"];
-                std::pair<double, double> vxy = MovementMath::calculateVelocity(copy);
-                copy["vx"] = vxy.first;
-                copy["vy"] = vxy.second;
+    this->registerEventCallback(EventEnum::PLAYER, [this](const nlohmann::json& event) {
+        post([this, copy = event]() mutable {
+            nlohmann::json& playerJson = player.getCharacter();
+            if (copy.contains("moving") && copy["moving"]) {
+                if (copy.contains("speed") && playerJson.contains("speed") && double(copy["speed"]) != double(playerJson["speed"])) {
+                    copy["from_x"] = copy["x"];
+                    copy["from_y"] = copy["y"];
+                    std::pair<double, double> vxy = MovementMath::calculateVelocity(copy);
+                    copy["vx"] = vxy.first;
+                    copy["vy"] = vxy.second;
+                }
             }
-        }
-        player.updateCharacter(copy);
+            patchCharacter(copy);
+        });
     });
-    this->registerEventCallback("new_map", [this](const nlohmann::json& event) {
-        std::lock_guard<std::mutex> guard(entityGuard);
-        getUpdateEntities().clear();
-        handle_entities(event["entities"]);
-        player.updateCharacter({ {"map", event["name"].get<std::string>()},
+    this->registerPayloadCallback(EventEnum::NEW_MAP, [this](std::string_view payload) {
+        EntityBatch batch;
+        if (!jsonBackend->decodeWrapped(payload, batch, monsterTable)) {
+            mLogger->error("Failed to decode new_map event.");
+            return;
+        }
+        const nlohmann::json& event = batch.rest;
+        currentMap = event["name"].get<std::string>();
+        requestedResync = false;
+        nlohmann::json patch = { {"map", currentMap},
                 {"x", event["x"].get<int>()},
                 {"y", event["y"].get<int>()},
                 {"m", event["m"].get<int>()},
-                {"moving", false} });
+                {"moving", false} };
+        post([this, batch = std::move(batch), patch = std::move(patch)]() {
+            applyEntities(batch, true);
+            patchCharacter(patch);
+        });
         // this->deleteEntities();
     });
-    this->registerEventCallback("cm", [this](const nlohmann::json& event) {
-        player.onCm(event["name"].get<std::string>(), event["message"]);
+    this->registerEventCallback<EventEnum::CM>([this](const GameEvents::Cm& event) {
+        // The message is whatever the sender passed, so it's the one field that still needs a DOM.
+        player.onCm(std::string(event.name), nlohmann::json::parse(event.message, nullptr, false));
     });
-    this->registerEventCallback("pm", [this](const nlohmann::json& event) {
-        std::string owner = event["owner"].get<std::string>();
-        player.onPm(owner, event["message"].get<std::string>());
+    this->registerEventCallback<EventEnum::PM>([this](const GameEvents::Pm& event) {
+        player.onPm(std::string(event.owner), std::string(event.message));
     });
-    this->registerEventCallback("chat_log", [this](const nlohmann::json& event) {
-        player.onChat(event["owner"].get<std::string>(), event["message"].get<std::string>());
+    this->registerEventCallback<EventEnum::CHAT_LOG>([this](const GameEvents::ChatLog& event) {
+        player.onChat(std::string(event.owner), std::string(event.message));
     });
-    this->registerEventCallback("invite", [this](const nlohmann::json& event) {
-        player.onPartyInvite(event["name"].get<std::string>());
+    this->registerEventCallback<EventEnum::INVITE>([this](const GameEvents::PartyInvite& event) {
+        player.onPartyInvite(std::string(event.name));
     });
-    this->registerEventCallback("request", [this](const nlohmann::json& event) {
-        player.onPartyRequest(event["name"].get<std::string>());
+    this->registerEventCallback<EventEnum::REQUEST>([this](const GameEvents::PartyRequest& event) {
+        player.onPartyRequest(std::string(event.name));
     });
     /**
      * Position correction.
      */
-    this->registerEventCallback("correction", [this](const nlohmann::json& event) {
-        std::lock_guard<std::mutex> guard(entityGuard);
-        this->mLogger->warn("Location corrected: Client: ({}, {}), Server: ({}, {})", player.getX(), player.getY(), double(event["x"]), double(event["y"]));
-        player.updateCharacter(event);
+    this->registerEventCallback(EventEnum::CORRECTION, [this](const nlohmann::json& event) {
+        post([this, event]() {
+            this->mLogger->warn("Location corrected: Client: ({}, {}), Server: ({}, {})", player.getX(), player.getY(), double(event["x"]), double(event["y"]));
+            patchCharacter(event);
+        });
     });
-    this->registerEventCallback("party_update", [this](const nlohmann::json& event) {
+    this->registerEventCallback(EventEnum::PARTY_UPDATE, [this](const nlohmann::json& event) {
         player.setParty(event["party"]);
     });
 
-    this->registerEventCallback("game_error", [this](const nlohmann::json& event) {
+    this->registerEventCallback(EventEnum::GAME_ERROR, [this](const nlohmann::json& event) {
         this->mLogger->error(event.dump());
         if (event.is_string()) {
             auto evt = event.get<std::string>();
@@ -241,10 +364,27 @@ void SocketWrapper::initializeSystem() {
         }
     });
 
-    this->registerEventCallback("disconnect", [this](const nlohmann::json& event) {
+    // Latency
+    this->registerEventCallback(EventEnum::PING_ACK, [this](const nlohmann::json& event) {
+        auto id_it = event.find("id");
+        if (id_it == event.end() || !id_it->is_number_unsigned()) {
+            return;
+        }
+        uint64_t id = id_it->get<uint64_t>();
+        // Anything older than the ring has had its slot reused.
+        if (id >= nextPingId || nextPingId - id > pingsSent.size()) {
+            return;
+        }
+        rttLatency.record(Types::Clock::now() - pingsSent[id % pingsSent.size()]);
+    });
+    this->registerEventCallback(EventEnum::GAME_RESPONSE, [this](const nlohmann::json& event) {
+        onGameResponse(event);
+    });
+
+    this->registerEventCallback(EventEnum::DISCONNECT, [this](const nlohmann::json& event) {
         this->mLogger->error("Disconnected: {}", event.dump());
     });
-    this->registerEventCallback("disconnect_reason", [this](const nlohmann::json& event) {
+    this->registerEventCallback(EventEnum::DISCONNECT_REASON, [this](const nlohmann::json& event) {
         this->mLogger->error("Disconnection reason received: {}", event.dump());
     });
 }
@@ -262,31 +402,276 @@ void SocketWrapper::login(const CharacterGameInfo& info) {
 }
 
 void SocketWrapper::emit(const std::string& event, const nlohmann::json& json) {
-    if (this->webSocket.getReadyState() == ix::ReadyState::Open) {
-        this->webSocket.send(fmt::format("42[\"{}\",{}]", event, json.dump()));
-    } else {
-        this->mLogger->error("{} attempting to call emit on a socket that hasn't opened yet.", this->characterId);
-    }
+    std::lock_guard<std::mutex> guard(sendGuard);
+    sendBuffer.assign("42[");
+    appendEscaped(sendBuffer, event);
+    sendBuffer += ',';
+    sendBuffer += json.dump();
+    sendBuffer += ']';
+    emitFrame(event);
 }
 
 void SocketWrapper::emitRawJsonString(std::string event, std::string json) {
-    if (this->webSocket.getReadyState() == ix::ReadyState::Open) {
-        this->webSocket.send(fmt::format("42[\"{}\",{}]", event, json));
+    std::lock_guard<std::mutex> guard(sendGuard);
+    sendBuffer.assign("42[");
+    appendEscaped(sendBuffer, event);
+    sendBuffer += ',';
+    sendBuffer += json;
+    sendBuffer += ']';
+    emitFrame(event);
+}
+
+void SocketWrapper::emitFrame(std::string_view event) {
+    RateGovernor::Priority priority = rateGovernor.getPriority(event);
+    switch (rateGovernor.acquire(event, priority)) {
+        case RateGovernor::SEND:
+            if (canSend()) {
+                send(sendBuffer);
+                trackResponse(event, Types::Clock::now());
+            } else {
+                this->mLogger->error("{} attempting to call emit on a socket that hasn't opened yet.", this->characterId);
+            }
+            break;
+        case RateGovernor::DELAY:
+            stageFrame(OTHER_COMMAND, event, priority);
+            break;
+        case RateGovernor::DROP:
+            break;
+    }
+}
+
+void SocketWrapper::beginCommand(std::string_view event) {
+    sendBuffer.assign("42[");
+    appendEscaped(sendBuffer, event);
+    sendBuffer += ",{";
+}
+
+void SocketWrapper::appendField(std::string_view key, std::string_view value) {
+    if (sendBuffer.back() != '{') {
+        sendBuffer += ',';
+    }
+    appendEscaped(sendBuffer, key);
+    sendBuffer += ':';
+    appendEscaped(sendBuffer, value);
+}
+
+void SocketWrapper::appendField(std::string_view key, double value) {
+    if (sendBuffer.back() != '{') {
+        sendBuffer += ',';
+    }
+    appendEscaped(sendBuffer, key);
+    sendBuffer += ':';
+    // Same as nlohmann: JSON has no representation for these.
+    if (std::isfinite(value)) {
+        fmt::format_to(std::back_inserter(sendBuffer), "{}", value);
     } else {
-        this->mLogger->error("{} attempting to call emit on a socket that hasn't opened yet.", this->characterId);
+        sendBuffer += "null";
     }
 }
 
+void SocketWrapper::appendField(std::string_view key, long value) {
+    if (sendBuffer.back() != '{') {
+        sendBuffer += ',';
+    }
+    appendEscaped(sendBuffer, key);
+    sendBuffer += ':';
+    fmt::format_to(std::back_inserter(sendBuffer), "{}", value);
+}
+
+void SocketWrapper::stageCommand(CommandType type, std::string_view event, RateGovernor::Priority priority) {
+    sendBuffer += "}]";
+    if (type == SKILL_COMMAND || type == EQUIP_COMMAND) {
+        for (size_t i = 0; i < stagedCount; i++) {
+            const StagedCommand& staged = stagedCommands[i];
+            if (staged.type == type && !staged.superseded && staged.frame == sendBuffer) {
+                coalescedCommandCount++;
+                return;
+            }
+        }
+    } else if (type == MOVE_COMMAND) {
+        // Only the latest target matters, and it's sent where the last move was requested.
+        for (size_t i = 0; i < stagedCount; i++) {
+            StagedCommand& staged = stagedCommands[i];
+            if (staged.type == MOVE_COMMAND && !staged.superseded) {
+                staged.superseded = true;
+                coalescedCommandCount++;
+            }
+        }
+    }
+    stageFrame(type, event, priority);
+}
+
+void SocketWrapper::stageFrame(CommandType type, std::string_view event, RateGovernor::Priority priority) {
+    if (stagedCount == stagedCommands.size()) {
+        stagedCommands.emplace_back();
+    }
+    StagedCommand& staged = stagedCommands[stagedCount++];
+    staged.type = type;
+    staged.priority = priority;
+    staged.superseded = false;
+    staged.stagedAt = Types::Clock::now();
+    staged.event.assign(event);
+    std::swap(staged.frame, sendBuffer);
+}
+
+void SocketWrapper::flushCommands() {
+    std::lock_guard<std::mutex> guard(sendGuard);
+    if (stagedCount == 0) {
+        return;
+    }
+    if (!canSend()) {
+        // Bots keep running while the socket reconnects, there's no need to hear about it every tick.
+        if (!reportedClosed) {
+            this->mLogger->error("{} attempting to send {} commands on a socket that hasn't opened yet.", this->characterId, stagedCount);
+            reportedClosed = true;
+        }
+        stagedCount = 0;
+        return;
+    }
+    reportedClosed = false;
+    const Types::TimePoint now = Types::Clock::now();
+    // Commands the governor holds back are kept, in order, for the next flush.
+    size_t kept = 0;
+    for (size_t i = 0; i < stagedCount; i++) {
+        StagedCommand& staged = stagedCommands[i];
+        if (staged.superseded) {
+            continue;
+        }
+        if (rateGovernor.hasExpired(staged.priority, now - staged.stagedAt)) {
+            rateGovernor.expire(staged.priority);
+            continue;
+        }
+        switch (rateGovernor.acquire(staged.event, staged.priority, now)) {
+            case RateGovernor::SEND:
+                send(staged.frame);
+                trackResponse(staged.event, now);
+                sentCommandCount++;
+                break;
+            case RateGovernor::DELAY:
+                if (kept != i) {
+                    std::swap(stagedCommands[kept], staged);
+                }
+                kept++;
+                break;
+            case RateGovernor::DROP:
+                break;
+        }
+    }
+    stagedCount = kept;
+}
+
+void SocketWrapper::trackResponse(std::string_view event, Types::TimePoint sentAt) {
+    if (event != "attack" && event != "heal" && event != "skill" && event != "equip" && event != "use") {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(responseGuard);
+    auto it = pendingResponses.find(event);
+    if (it == pendingResponses.end()) {
+        it = pendingResponses.emplace(std::string(event), std::deque<Types::TimePoint>()).first;
+    }
+    // Commands the server never answers would otherwise pile up.
+    if (it->second.size() == 32) {
+        it->second.pop_front();
+    }
+    it->second.push_back(sentAt);
+}
+
+void SocketWrapper::onGameResponse(const nlohmann::json& event) {
+    const Types::TimePoint now = Types::Clock::now();
+    // Most responses name the command they answer in place, cooldowns name it in skill,
+    // and the rest prefix the response with it (attack_failed).
+    std::array<std::string_view, 3> candidates;
+    if (event.is_object()) {
+        auto place_it = event.find("place");
+        if (place_it != event.end() && place_it->is_string()) {
+            candidates[0] = place_it->get_ref<const std::string&>();
+        }
+        auto skill_it = event.find("skill");
+        if (skill_it != event.end() && skill_it->is_string()) {
+            candidates[1] = skill_it->get_ref<const std::string&>();
+        }
+        auto response_it = event.find("response");
+        if (response_it != event.end() && response_it->is_string()) {
+            candidates[2] = response_it->get_ref<const std::string&>();
+        }
+    } else if (event.is_string()) {
+        candidates[2] = event.get_ref<const std::string&>();
+    }
+    candidates[2] = candidates[2].substr(0, candidates[2].find('_'));
+
+    std::lock_guard<std::mutex> guard(responseGuard);
+    for (std::string_view command : candidates) {
+        if (command.empty()) {
+            continue;
+        }
+        auto it = pendingResponses.find(command);
+        if (it != pendingResponses.end() && !it->second.empty()) {
+            responseLatency.record(now - it->second.front());
+            it->second.pop_front();
+            return;
+        }
+    }
+}
+
+void SocketWrapper::attack(std::string_view id) {
+    std::lock_guard<std::mutex> guard(sendGuard);
+    beginCommand("attack");
+    appendField("id", id);
+    stageCommand(ATTACK_COMMAND, "attack", rateGovernor.getPriority("attack"));
+}
+
+void SocketWrapper::heal(std::string_view id) {
+    std::lock_guard<std::mutex> guard(sendGuard);
+    beginCommand("heal");
+    appendField("id", id);
+    stageCommand(HEAL_COMMAND, "heal", rateGovernor.getPriority("heal"));
+}
+
+void SocketWrapper::skill(std::string_view name, std::string_view target) {
+    std::lock_guard<std::mutex> guard(sendGuard);
+    beginCommand("skill");
+    appendField("name", name);
+    if (!target.empty()) {
+        appendField("id", target);
+    }
+    stageCommand(SKILL_COMMAND, "skill", rateGovernor.getPriority("skill"));
+}
+
+void SocketWrapper::move(double x, double y, double going_x, double going_y, long m) {
+    std::lock_guard<std::mutex> guard(sendGuard);
+    beginCommand("move");
+    appendField("x", x);
+    appendField("y", y);
+    appendField("going_x", going_x);
+    appendField("going_y", going_y);
+    appendField("m", m);
+    stageCommand(MOVE_COMMAND, "move", rateGovernor.getPriority("move"));
+}
+
+void SocketWrapper::equip(size_t num, std::string_view slot) {
+    std::lock_guard<std::mutex> guard(sendGuard);
+    beginCommand("equip");
+    appendField("num", long(num));
+    if (!slot.empty()) {
+        appendField("slot", slot);
+    }
+    // Without a slot, this is how potions are used.
+    stageCommand(EQUIP_COMMAND, "equip", slot.empty() ? RateGovernor::CRITICAL : rateGovernor.getPriority("equip"));
+}
 
 void SocketWrapper::messageReceiver(const ix::WebSocketMessagePtr& message) {
     // this->mLogger->info("Received: '{}'", message->str);
-    if (pingInterval != 0 && message->type != ix::WebSocketMessageType::Close) {
+    if (message->type == ix::WebSocketMessageType::Message) {
+        frameReceivedAt = Types::Clock::now();
+        frameDispatched = false;
+    }
+    if (!replaying && message->type == ix::WebSocketMessageType::Message) {
         auto now = std::chrono::high_resolution_clock::now();
         auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastPing).count();
 
-        // The socket expects a ping every few milliseconds (currently, it's every 4000 milliseconds)
-        // This is sent through the websocket on the frame type 0
-        if (diff > pingInterval) {
+        // Engine.IO v4 servers ping us, so this is only used to measure the round trip,
+        // every 4000 milliseconds like the browser client.
+        if (diff > 4000) {
             lastPing = now;
             sendPing();
         }
@@ -294,6 +679,13 @@ void SocketWrapper::messageReceiver(const ix::WebSocketMessagePtr& message) {
 
     // All the Socket.IO events also come through as messages
     if (message->type == ix::WebSocketMessageType::Message) {
+        if (recorder) {
+            recorder->write(WireCapture::INBOUND, player.id, message->str);
+        }
+        compressionStats.inboundMessages++;
+        compressionStats.inboundWireBytes += message->wireSize;
+        compressionStats.inboundBytes += message->str.size();
+
         // Uncomment for data samples
         // this->mLogger->info("> {}", message->str);
 
@@ -303,154 +695,285 @@ void SocketWrapper::messageReceiver(const ix::WebSocketMessagePtr& message) {
             return;
         }
 
+        FrameParser::Frame frame;
+        if (!FrameParser::decode(messageStr, frame)) {
+            this->mLogger->error("Failed to parse message: \"{}\". Failed to find frame type", messageStr);
+            return;
+        }
+
         if (messageStr.length() == 1) {
-            int type = std::stoi(messageStr);
-            if (type == 0)
+            if (frame.frameType == FrameParser::OPEN)
                 this->mLogger->warn("Received empty connect message! Assuming 4000 milliseconds for the ping interval");
-            else if (type == 3) {
+            else if (frame.frameType == FrameParser::PONG) {
                 // pong
-            } else if (type == 2) {
+            } else if (frame.frameType == FrameParser::PING) {
                 // ping
-                this->webSocket.send("3");
+                send("3");
             }
 
             return;
         }
 
-        std::string args;
-        int likelyType = messageStr[0] - '0';      // frame type
-        int alternativeType = messageStr[1] - '0'; // message type
-
-        if (likelyType < 0 || likelyType > 9) {
-            this->mLogger->error("Failed to parse message: \"{}\". Failed to find frame type", messageStr);
-            return;
-        }
-        if (messageStr.length() == 2 && alternativeType >= 0 && alternativeType <= 9) {
+        if (messageStr.length() == 2 && messageStr[1] >= '0' && messageStr[1] <= '9') {
             this->mLogger->debug("Skipping code-only input: \"{}\"", messageStr);
             return;
         }
 
-        // To get the message itself, we need to parse the numbers.
-        // We know the string is two or more characters at this point.
-        // If alternativeType < 0 || alternativeType > 9, that means the character,
-        // when '0' is subtracted, isn't a number. For that to be the case, it would
-        // have to be in that range.
-        // Anyway, first condition hits if we have one digit, the second if there's two
-        if (alternativeType < 0 || alternativeType > 9)
-            args = messageStr.substr(1, messageStr.length() - 1);
-        else
-            args = messageStr.substr(2, messageStr.length() - 2);
-        switch (likelyType) {
-            case 0: {
-                    dispatchEvent("connect", {});
-                    this->webSocket.send("40");
-                    auto data = nlohmann::json::parse(args);
+        switch (frame.frameType) {
+            case FrameParser::OPEN: {
+                    dispatchEvent(EventEnum::CONNECT, {});
+                    send("40");
+                    auto data = nlohmann::json::parse(frame.body.begin(), frame.body.end());
                     pingInterval = data["pingInterval"].get<int>();
                     this->mLogger->info("Received connection data. Pinging required every {} ms", pingInterval);
                     this->mLogger->info("Ping interval changed from {} to {}", this->webSocket.getPingInterval(), pingInterval);
                     this->webSocket.setPingInterval(pingInterval);
                 } break;
-            case 1:
+            case FrameParser::CLOSE:
                 this->mLogger->info("Disconnected: {}", message->str);
-                dispatchEvent("disconnect", {});
+                dispatchEvent(EventEnum::DISCONNECT, {});
                 break;
-            case 2:
-                dispatchEvent("ping", {});
+            case FrameParser::PING:
+                dispatchEvent(EventEnum::PING, {});
                 break;
-            case 3:
-                dispatchEvent("pong", {});
+            case FrameParser::PONG:
+                dispatchEvent(EventEnum::PONG, {});
                 break;
-            case 4: {
+            case FrameParser::MESSAGE: {
                     if (rawCallbacks.size() > 0) {
                         for (auto& callback : rawCallbacks) {
                             callback(message);
                         }
                     }
-                    int type = -1;
-                    if (alternativeType >= 0 && alternativeType <= 9) type = alternativeType;
-                    nlohmann::json json = nlohmann::json::parse(args);
-
-                    if (type == -1) {
-                        // Dispatch message event.
-                        // Note about the socket.io standard: sending a plain text message using socket.send
-                        // should send an event called message with the message as the data. The fallback
-                        // exists mainly because I have no idea what I'm doing. This might never be used.
-                        dispatchEvent("message", json);
-                    }
-                    // type = 0 for the connect packet
-                    // type = 1 for the disconnect packet
-                    if(type == 0) {
-                        mLogger->info("Socket connected with SID {}", json["sid"].get<std::string>());
-                    } else if(type == 1) { 
-                        mLogger->info("Disconnected");
-                        this->player.onDisconnect("Unknown closure");
-                    } else if (type == 2) { // type = 2 for events
-                        if (json.type() == nlohmann::json::value_t::array && json.size() >= 1) {
-                            auto& event = json[0];
-                            if (event.type() == nlohmann::json::value_t::string) {
-                                std::string eventName = event.get<std::string>();
-                                if (json.size() == 1) {
-                                    // dispatch eventName, {}
-                                    dispatchEvent(eventName, {});
-                                } else {
-                                    auto data = json[1];
-                                    if (eventName == "error")
-                                        this->mLogger->info("Error received as a message! Dumping JSON:\n{}", json.dump(4));
-                                    dispatchEvent(eventName, data);
-                                }
+                    switch (frame.packetType) {
+                        case FrameParser::NO_PACKET:
+                            // Dispatch message event.
+                            // Note about the socket.io standard: sending a plain text message using socket.send
+                            // should send an event called message with the message as the data. The fallback
+                            // exists mainly because I have no idea what I'm doing. This might never be used.
+                            if (hasEventCallback(EventEnum::MESSAGE)) {
+                                dispatchEvent(EventEnum::MESSAGE, nlohmann::json::parse(frame.body.begin(), frame.body.end()));
+                            } else {
+                                dropEvent(EventEnum::MESSAGE, "message");
                             }
-                        }
-                    }
-                    // type = 3 for ack (AFAIK, not used)
-                    // type = 4 for errors (no idea how to handle, gotta revisit that when I have data)
-                    else if (type == 4) {
-                        this->mLogger->error("Error received from server:\n{}", json.dump(4));
-                    }
-                    // type = 5 for binary event (AFAIK, not used)
-                    // type = 6 for binary ack (AFAIK, not used)
-                    else if (type == 3 || type == 5 || type == 6) {
-                        this->mLogger->warn("Received an event of type {}. Please report this issue here: "
-                                      "https://github.com/LunarWatcher/AdventureLandCpp/issues/1 - Full websocket message: {}",
-                                      type, messageStr);
-                    } else {
-                        this->mLogger->warn("Unknown event received: {}", messageStr);
+                            break;
+                        case FrameParser::CONNECT:
+                            mLogger->info("Socket connected with SID {}", nlohmann::json::parse(frame.body.begin(), frame.body.end())["sid"].get<std::string>());
+                            break;
+                        case FrameParser::DISCONNECT:
+                            mLogger->info("Disconnected");
+                            this->player.onDisconnect("Unknown closure");
+                            break;
+                        case FrameParser::EVENT:
+                            receiveEvent(frame);
+                            break;
+                        case FrameParser::CONNECT_ERROR:
+                            this->mLogger->error("Error received from server:\n{}", nlohmann::json::parse(frame.body.begin(), frame.body.end()).dump(4));
+                            break;
+                        // type = 3 for ack (AFAIK, not used)
+                        // type = 5 for binary event (AFAIK, not used)
+                        // type = 6 for binary ack (AFAIK, not used)
+                        case FrameParser::ACK:
+                        case FrameParser::BINARY_EVENT:
+                        case FrameParser::BINARY_ACK:
+                            this->mLogger->warn("Received an event of type {}. Please report this issue here: "
+                                          "https://github.com/LunarWatcher/AdventureLandCpp/issues/1 - Full websocket message: {}",
+                                          (int) frame.packetType, messageStr);
+                            break;
+                        default:
+                            this->mLogger->warn("Unknown event received: {}", messageStr);
                     }
                 } break;
-            case 5:
-                dispatchEvent("upgrade", {});
+            case FrameParser::UPGRADE:
+                dispatchEvent(EventEnum::UPGRADE, {});
                 this->mLogger->info("Upgrade received: {}", messageStr);
                 // upgrade
                 break;
-            case 6:
-                dispatchEvent("noop", {});
+            case FrameParser::NOOP:
+                dispatchEvent(EventEnum::NOOP, {});
                 this->mLogger->info("noop received: {}", messageStr);
                 // noop
                 break;
+            default:
+                break;
         }
-
     } else if (message->type == ix::WebSocketMessageType::Error) {
         this->mLogger->error(message->errorInfo.reason);
     } else if (message->type == ix::WebSocketMessageType::Open) {
         this->mLogger->info("Connected");
+        // Counters are per connection.
+        compressionStats.reset();
+        rttLatency.reset();
+        dispatchLatency.reset();
+        responseLatency.reset();
+        auto extensions = message->openInfo.headers.find("Sec-WebSocket-Extensions");
+        compressionStats.negotiated = extensions != message->openInfo.headers.end() &&
+            extensions->second.find("permessage-deflate") != std::string::npos;
     } else if (message->type == ix::WebSocketMessageType::Close) {
         this->mLogger->info("Socket disconnected: {}", message->closeInfo.reason);
+        logCompressionStats();
+        this->mLogger->info("Latency p50/p99 (ms). Round trip: {:.1f}/{:.1f}, dispatch: {:.3f}/{:.3f}, game_response: {:.1f}/{:.1f}.",
+            rttLatency.getPercentile(50).count() / 1000.0, rttLatency.getPercentile(99).count() / 1000.0,
+            dispatchLatency.getPercentile(50).count() / 1000.0, dispatchLatency.getPercentile(99).count() / 1000.0,
+            responseLatency.getPercentile(50).count() / 1000.0, responseLatency.getPercentile(99).count() / 1000.0);
+        if (recorder) {
+            recorder->flush();
+        }
         this->player.onDisconnect(message->closeInfo.reason);
     }
 }
 
+void SocketWrapper::receiveEvent(const FrameParser::Frame& frame) {
+    // Whether the payload callbacks already ran, so the fallback below doesn't apply it twice.
+    bool decoded = false;
+    if (!frame.needsFullParse) {
+        const EventEnum::EVENT event = resolveEvent(frame.eventName);
+        // World state events are streamed into typed records without a DOM.
+        decoded = dispatchPayload(event, frame.payload);
+        // Peek before parsing: most of what the server pushes has no listener.
+        if (!hasEventCallback(event) && event != EventEnum::ERROR) {
+            if (!decoded) {
+                dropEvent(event, frame.eventName);
+            }
+            return;
+        }
+        if (frame.payload.empty()) {
+            dispatchEvent(event, {});
+            return;
+        }
+        // Parse the payload straight out of the websocket buffer. If it doesn't stand on
+        // its own (an event with several arguments), fall back to parsing the whole array.
+        nlohmann::json data;
+        if (jsonBackend->parseDocument(frame.payload, data)) {
+            if (event == EventEnum::ERROR)
+                this->mLogger->info("Error received as a message! Dumping JSON:\n{}", data.dump(4));
+            dispatchEvent(event, data);
+            return;
+        }
+    }
+    nlohmann::json json = nlohmann::json::parse(frame.body.begin(), frame.body.end());
+    if (json.type() == nlohmann::json::value_t::array && json.size() >= 1) {
+        auto& eventJson = json[0];
+        if (eventJson.type() == nlohmann::json::value_t::string) {
+            const std::string& eventName = eventJson.get_ref<const std::string&>();
+            const EventEnum::EVENT event = resolveEvent(eventName);
+            if (!decoded && json.size() > 1 && hasPayloadCallback(event)) {
+                dispatchPayload(event, json[1].dump());
+            }
+            if (json.size() == 1) {
+                // dispatch eventName, {}
+                dispatchEvent(event, {});
+            } else {
+                if (event == EventEnum::ERROR)
+                    this->mLogger->info("Error received as a message! Dumping JSON:\n{}", json.dump(4));
+                dispatchEvent(event, json[1]);
+            }
+        }
+    }
+}
+
+bool SocketWrapper::setJsonBackend(std::string_view name) {
+    std::unique_ptr<JsonBackend> backend = JsonBackend::create(name);
+    if (!backend) {
+        mLogger->error("JSON backend {} isn't available in this build.", name);
+        return false;
+    }
+    jsonBackend = std::move(backend);
+    return true;
+}
+
 void SocketWrapper::receiveLocalCm(std::string from, const nlohmann::json& message) {
     player.onCm(from, message);
 }
 
-void SocketWrapper::dispatchEvent(std::string eventName, const nlohmann::json& event) {
-    auto it = eventCallbacks.find(eventName);
-    if (it != eventCallbacks.end()) {
-        for (auto& callback : it->second) {
-            callback(event);
+EventEnum::EVENT SocketWrapper::resolveEvent(std::string_view eventName) const {
+    EventEnum::EVENT event = EventEnum::getEventId(eventName);
+    if (event != EventEnum::UNKNOWN) {
+        return event;
+    }
+    auto it = internedEvents.find(eventName);
+    return it == internedEvents.end() ? EventEnum::UNKNOWN : it->second;
+}
+
+EventEnum::EVENT SocketWrapper::internEvent(std::string_view eventName) {
+    EventEnum::EVENT event = resolveEvent(eventName);
+    if (event == EventEnum::UNKNOWN) {
+        event = EventEnum::EVENT(EventEnum::KNOWN_EVENT_COUNT + internedEvents.size());
+        internedEvents.emplace(eventName, event);
+    }
+    return event;
+}
+
+bool SocketWrapper::hasEventCallback(EventEnum::EVENT event) const {
+    return event < eventCallbacks.size() && !eventCallbacks[event].empty();
+}
+
+void SocketWrapper::dropEvent(EventEnum::EVENT event, std::string_view eventName) {
+    droppedEventCount++;
+    if (event == EventEnum::UNKNOWN) {
+        auto it = droppedUnknownEvents.find(eventName);
+        if (it == droppedUnknownEvents.end()) {
+            this->mLogger->debug("No listeners for \"{}\", dropping it without parsing.", eventName);
+            droppedUnknownEvents.emplace(eventName, 1);
+        } else {
+            it->second++;
+        }
+        return;
+    }
+    if (event >= droppedEvents.size()) {
+        droppedEvents.resize(event + 1, 0);
+    }
+    if (droppedEvents[event]++ == 0) {
+        this->mLogger->debug("No listeners for \"{}\", dropping it without parsing.", eventName);
+    }
+}
+
+size_t SocketWrapper::getDroppedEventCount() const {
+    return droppedEventCount;
+}
+
+size_t SocketWrapper::getDroppedEventCount(const std::string& eventName) const {
+    EventEnum::EVENT event = resolveEvent(eventName);
+    if (event == EventEnum::UNKNOWN) {
+        auto it = droppedUnknownEvents.find(eventName);
+        return it == droppedUnknownEvents.end() ? 0 : it->second;
+    }
+    return event < droppedEvents.size() ? droppedEvents[event] : 0;
+}
+
+bool SocketWrapper::hasPayloadCallback(EventEnum::EVENT event) const {
+    return event < payloadCallbacks.size() && !payloadCallbacks[event].empty();
+}
+
+bool SocketWrapper::dispatchPayload(EventEnum::EVENT event, std::string_view payload) {
+    if (!hasPayloadCallback(event)) {
+        return false;
+    }
+    markDispatched();
+    for (auto& callback : payloadCallbacks[event]) {
+        callback(payload);
+    }
+    return true;
+}
+
+void SocketWrapper::dispatchEvent(EventEnum::EVENT event, const nlohmann::json& data) {
+    if (event < eventCallbacks.size()) {
+        if (!eventCallbacks[event].empty()) {
+            markDispatched();
+        }
+        for (auto& callback : eventCallbacks[event]) {
+            callback(data);
         }
     }
 }
 
+void SocketWrapper::markDispatched() {
+    if (!frameDispatched) {
+        frameDispatched = true;
+        dispatchLatency.record(Types::Clock::now() - frameReceivedAt);
+    }
+}
+
 void SocketWrapper::deleteEntities() {
     // NO-OP. Unneeded.
 }
@@ -460,12 +983,34 @@ void SocketWrapper::registerRawMessageCallback(std::function<void(const ix::WebS
 }
 
 void SocketWrapper::registerEventCallback(const std::string& event, std::function<void(const nlohmann::json&)> callback) {
+    registerEventCallback(internEvent(event), callback);
+}
+
+void SocketWrapper::registerEventCallback(EventEnum::EVENT event, std::function<void(const nlohmann::json&)> callback) {
+    if (event >= eventCallbacks.size()) {
+        eventCallbacks.resize(event + 1);
+    }
     eventCallbacks[event].push_back(callback);
 }
 
+void SocketWrapper::registerPayloadCallback(EventEnum::EVENT event, PayloadCallback callback) {
+    if (event >= payloadCallbacks.size()) {
+        payloadCallbacks.resize(event + 1);
+    }
+    payloadCallbacks[event].push_back(callback);
+}
+
 void SocketWrapper::onDisappear(const nlohmann::json& event) {
-    std::lock_guard<std::mutex> mtx(this->entityGuard);
-    updatedEntities[event["id"].get<std::string>()].update({{"dead", true}});
+    post([this, id = event["id"].get<std::string>()]() {
+        // Entities we never heard of are of no interest.
+        size_t row = entities.indexOf(id);
+        if (row != EntityStore::npos) {
+            EntityRecord record;
+            record.dead = true;
+            record.fields = EntityRecord::DEAD;
+            journal.record(id, entities.apply(row, record));
+        }
+    });
 }
 
 void SocketWrapper::connect() {
@@ -475,27 +1020,56 @@ void SocketWrapper::connect() {
 
 void SocketWrapper::close() {
     this->webSocket.stop();
+    // Whatever was staged was meant for the connection that just closed.
+    {
+        std::lock_guard<std::mutex> guard(sendGuard);
+        stagedCount = 0;
+    }
+    std::lock_guard<std::mutex> guard(responseGuard);
+    pendingResponses.clear();
 }
 
 void SocketWrapper::sendPing() {
+    std::lock_guard<std::mutex> guard(sendGuard);
+    if (!canSend()) {
+        return;
+    }
+    // Not passed through the rate governor: holding it back would measure the governor, not the server.
+    uint64_t id = nextPingId++;
+    sendBuffer.assign("42[\"ping_trig\",{\"id\":");
+    fmt::format_to(std::back_inserter(sendBuffer), "{}}}]", id);
+    pingsSent[id % pingsSent.size()] = Types::Clock::now();
+    send(sendBuffer);
 }
 
-std::map<std::string, nlohmann::json>& SocketWrapper::getEntities() {
-    return entities;
+void SocketWrapper::publishSnapshot(Types::TimePoint now) {
+    std::shared_ptr<WorldSnapshot>& buffer = snapshotBuffers[snapshotTick % snapshotBuffers.size()];
+    // Nobody else can get a reference to it anymore, so if nobody holds one, it's ours to refill.
+    // Assigning over the old columns and maps reuses their storage.
+    if (!buffer || buffer.use_count() > 1) {
+        buffer = std::make_shared<WorldSnapshot>();
+    } else {
+        // use_count() is a relaxed load. The last reader let go of its copy with a release
+        // decrement; this fence pairs with it, so its reads of the buffer happen before our writes.
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    buffer->tick = ++snapshotTick;
+    buffer->generation = journal.getGeneration();
+    buffer->takenAt = now;
+    buffer->character = character;
+    buffer->entities = entities;
+    buffer->chests = chests;
+    snapshot.store(buffer, std::memory_order_release);
 }
 
-std::map<std::string, nlohmann::json>& SocketWrapper::getUpdateEntities() {
-    return updatedEntities;
+EntityStore& SocketWrapper::getEntities() {
+    return entities;
 }
 
 nlohmann::json& SocketWrapper::getCharacter() {
     return character;
 }
 
-nlohmann::json& SocketWrapper::getUpdateCharacter() {
-    return updatedCharacter;
-}
-
 std::map<std::string, nlohmann::json>& SocketWrapper::getChests() {
     return chests;
 }
@@ -0,0 +1,123 @@
+#include "albot/Utils/FrameParser.hpp"
+
+namespace FrameParser {
+	inline bool is_digit(char c) {
+		return c >= '0' && c <= '9';
+	}
+
+	inline bool is_space(char c) {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	inline size_t skip_space(std::string_view str, size_t pos) {
+		while (pos < str.length() && is_space(str[pos])) {
+			pos++;
+		}
+		return pos;
+	}
+
+	bool splitEvent(std::string_view body, Frame& frame) {
+		size_t pos = skip_space(body, 0);
+		if (pos >= body.length() || body[pos] != '[') {
+			return false;
+		}
+		pos = skip_space(body, pos + 1);
+		if (pos >= body.length() || body[pos] != '"') {
+			return false;
+		}
+		size_t name_start = ++pos;
+		// Scan for the closing quote. Escapes are rare enough in event names that
+		// we hand them back to the JSON parser instead of unescaping here.
+		while (pos < body.length() && body[pos] != '"') {
+			if (body[pos] == '\\') {
+				frame.needsFullParse = true;
+				pos++;
+			}
+			pos++;
+		}
+		if (pos >= body.length()) {
+			return false;
+		}
+		frame.eventName = body.substr(name_start, pos - name_start);
+
+		pos = skip_space(body, pos + 1);
+		if (pos >= body.length()) {
+			return false;
+		}
+		if (body[pos] == ']') {
+			frame.payload = std::string_view();
+			return true;
+		}
+		if (body[pos] != ',') {
+			return false;
+		}
+		pos = skip_space(body, pos + 1);
+
+		// The payload runs up to the closing bracket of the outer array.
+		size_t end = body.length();
+		while (end > pos && is_space(body[end - 1])) {
+			end--;
+		}
+		if (end <= pos || body[end - 1] != ']') {
+			return false;
+		}
+		end--;
+		while (end > pos && is_space(body[end - 1])) {
+			end--;
+		}
+		frame.payload = body.substr(pos, end - pos);
+		return true;
+	}
+
+	bool decode(std::string_view message, Frame& frame) {
+		frame = Frame();
+		if (message.empty() || !is_digit(message[0])) {
+			return false;
+		}
+		frame.frameType = FrameType(message[0] - '0');
+		if (frame.frameType != MESSAGE) {
+			frame.body = message.substr(1);
+			return true;
+		}
+		if (message.length() < 2 || !is_digit(message[1])) {
+			// Plain engine message, there's no Socket.IO packet in it.
+			frame.body = message.substr(1);
+			return true;
+		}
+		frame.packetType = PacketType(message[1] - '0');
+		size_t pos = 2;
+
+		if (frame.packetType == BINARY_EVENT || frame.packetType == BINARY_ACK) {
+			// <# of attachments>-
+			size_t dash = message.find('-', pos);
+			if (dash != std::string_view::npos) {
+				pos = dash + 1;
+			}
+		}
+		if (pos < message.length() && message[pos] == '/') {
+			size_t comma = message.find(',', pos);
+			if (comma == std::string_view::npos) {
+				frame.nsp = message.substr(pos);
+				frame.body = std::string_view();
+				return true;
+			}
+			frame.nsp = message.substr(pos, comma - pos);
+			pos = comma + 1;
+		}
+		if (pos < message.length() && is_digit(message[pos])) {
+			frame.ackId = 0;
+			while (pos < message.length() && is_digit(message[pos])) {
+				frame.ackId = frame.ackId * 10 + (message[pos] - '0');
+				pos++;
+			}
+		}
+		frame.body = message.substr(pos);
+
+		if (frame.packetType == EVENT && !frame.body.empty()) {
+			if (!splitEvent(frame.body, frame)) {
+				frame.needsFullParse = true;
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,87 @@
+#include "albot/Utils/Reactor.hpp"
+
+Reactor::Reactor() : loop(uvw::Loop::create()) {
+	wakeup = loop->resource<uvw::AsyncHandle>();
+	wakeup->on<uvw::AsyncEvent>([this](const uvw::AsyncEvent&, uvw::AsyncHandle&) {
+		drain();
+	});
+}
+
+Reactor::~Reactor() {
+	exiting = true;
+	post([this]() {
+		loop->stop();
+	});
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+Reactor& Reactor::shared() {
+	static Reactor reactor;
+	return reactor;
+}
+
+void Reactor::post(std::function<void()> work) {
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		queue.push_back(std::move(work));
+	}
+	// uv_async_send is the one libuv call that's safe from any thread. Sends that arrive before
+	// the loop wakes up are coalesced into a single AsyncEvent, hence the queue.
+	wakeup->send();
+}
+
+void Reactor::drain() {
+	std::vector<std::function<void()>> work;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		work.swap(queue);
+	}
+	for (auto& function : work) {
+		function();
+	}
+}
+
+void Reactor::attach() {
+	attached++;
+}
+
+void Reactor::detach() {
+	if (--attached == 0) {
+		// A bot may attach again before this runs, then the loop keeps going.
+		post([this]() {
+			if (attached == 0) {
+				loop->stop();
+			}
+		});
+	}
+}
+
+void Reactor::runLoop() {
+	loopThread = std::this_thread::get_id();
+	while (true) {
+		// Blocks until a timer is due, a socket posts something or the last bot detaches.
+		loop->run();
+		std::lock_guard<std::mutex> lock(stateMutex);
+		if (attached == 0 || exiting) {
+			running = false;
+			loopThread = std::thread::id();
+			return;
+		}
+	}
+}
+
+void Reactor::start() {
+	std::lock_guard<std::mutex> lock(stateMutex);
+	if (running) {
+		return;
+	}
+	// The last thread exited once every bot had detached. Nobody waited on it if the bots were
+	// replaced by new ones, so it's still joinable.
+	if (thread.joinable()) {
+		thread.join();
+	}
+	running = true;
+	thread = std::thread(&Reactor::runLoop, this);
+}
@@ -0,0 +1,104 @@
+#include "albot/Utils/WireCapture.hpp"
+
+#include <algorithm>
+#include <map>
+#include <thread>
+
+namespace WireCapture {
+	static constexpr char MAGIC[4] = { 'A', 'L', 'W', 'C' };
+	static constexpr uint32_t VERSION = 1;
+
+	template<typename T>
+	void writeInt(std::ofstream& out, T value) {
+		char bytes[sizeof(T)];
+		for (size_t i = 0; i < sizeof(T); i++) {
+			bytes[i] = char(uint64_t(value) >> (8 * i));
+		}
+		out.write(bytes, sizeof(T));
+	}
+
+	template<typename T>
+	bool readInt(std::ifstream& in, T& value) {
+		unsigned char bytes[sizeof(T)];
+		if (!in.read(reinterpret_cast<char*>(bytes), sizeof(T))) {
+			return false;
+		}
+		uint64_t result = 0;
+		for (size_t i = 0; i < sizeof(T); i++) {
+			result |= uint64_t(bytes[i]) << (8 * i);
+		}
+		value = T(result);
+		return true;
+	}
+
+	Recorder::Recorder(const std::string& path) : out(path, std::ios::binary | std::ios::trunc), start(std::chrono::steady_clock::now()) {
+		if (out) {
+			out.write(MAGIC, sizeof(MAGIC));
+			writeInt<uint32_t>(out, VERSION);
+		}
+	}
+
+	std::shared_ptr<Recorder> Recorder::open(const std::string& path) {
+		static std::mutex recordersGuard;
+		static std::map<std::string, std::weak_ptr<Recorder>> recorders;
+		std::lock_guard<std::mutex> lock(recordersGuard);
+		std::shared_ptr<Recorder> recorder = recorders[path].lock();
+		if (!recorder) {
+			recorder = std::make_shared<Recorder>(path);
+			recorders[path] = recorder;
+		}
+		return recorder;
+	}
+
+	void Recorder::write(Direction direction, uint64_t characterId, std::string_view frame) {
+		auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		std::lock_guard<std::mutex> lock(guard);
+		writeInt<uint8_t>(out, direction);
+		writeInt<uint64_t>(out, time.count());
+		writeInt<uint64_t>(out, characterId);
+		writeInt<uint32_t>(out, frame.size());
+		out.write(frame.data(), frame.size());
+	}
+
+	void Recorder::flush() {
+		std::lock_guard<std::mutex> lock(guard);
+		out.flush();
+	}
+
+	Reader::Reader(const std::string& path) : in(path, std::ios::binary) {
+		char magic[sizeof(MAGIC)];
+		uint32_t version = 0;
+		valid = in.read(magic, sizeof(magic)) && std::equal(magic, magic + sizeof(magic), MAGIC) &&
+			readInt(in, version) && version == VERSION;
+	}
+
+	bool Reader::next(Record& record) {
+		if (!valid) {
+			return false;
+		}
+		uint8_t direction = 0;
+		uint64_t time = 0;
+		uint32_t size = 0;
+		if (!readInt(in, direction) || !readInt(in, time) || !readInt(in, record.characterId) || !readInt(in, size)) {
+			return false;
+		}
+		record.direction = Direction(direction);
+		record.time = std::chrono::nanoseconds(time);
+		record.frame.resize(size);
+		return bool(in.read(record.frame.data(), size));
+	}
+
+	size_t replay(Reader& reader, bool realtime, const std::function<void(const Record&)>& callback) {
+		const auto start = std::chrono::steady_clock::now();
+		size_t count = 0;
+		Record record;
+		while (reader.next(record)) {
+			if (realtime) {
+				std::this_thread::sleep_until(start + record.time);
+			}
+			callback(record);
+			count++;
+		}
+		return count;
+	}
+}
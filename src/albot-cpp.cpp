@@ -1,5 +1,6 @@
 ﻿#include "albot/albot-cpp.hpp"
 #include "albot/HttpWrapper.hpp"
+#include "albot/Utils/TaskGraph.hpp"
 #include <functional>
 #include <fmt/core.h>
 
@@ -63,7 +64,7 @@ namespace ALBot {
 		for (size_t i = 0; i < names.size(); i++) {
 			pretty_names += names[i];
 			char_names += names[i];
-			char_name_ints += std::to_string(HttpWrapper::NAME_TO_NUMBER[names[i]]);
+			char_name_ints += std::to_string(HttpWrapper::NAME_TO_NUMBER.at(names[i]));
 			if (i < names.size() - 1) {
 				pretty_names += ", ";
 				char_names += "\\;";
@@ -100,7 +101,7 @@ namespace ALBot {
 		mLogger->info("Finished.");
 	}
 
-	void start_service(int index) {
+	bool start_service(int index) {
 		HttpWrapper::Service& service = HttpWrapper::services[index];
 		
 		ServiceInfo& info = SERVICE_HANDLERS.emplace(std::piecewise_construct, std::forward_as_tuple(service.name), std::forward_as_tuple(HttpWrapper::data)).first->second;
@@ -109,6 +110,7 @@ namespace ALBot {
 		void* handle = dlopen(file.c_str(), RTLD_LAZY);
 		if (!handle) {
 			mLogger->error("Cannot open library: {}", dlerror());
+			return false;
 		} else {
 
 			typedef void(*init_t)(ServiceInfo&);
@@ -120,6 +122,7 @@ namespace ALBot {
 			if (dlsym_error) {
 				mLogger->error("Cannot load symbol 'init': {}", dlsym_error);
 				dlclose(handle);
+				return false;
 			}
 			init(info);
 			if (!info.has_destructor()) {
@@ -130,10 +133,11 @@ namespace ALBot {
 			}
 
 			DLHANDLES.push_back(handle);
+			return true;
 		}
 	}
 
-	void start_character(int index) {
+	bool start_character(int index) {
 		Character& character = HttpWrapper::characters[index];
 		CharacterGameInfo& info = CHARACTER_HANDLERS[character.name];
 		int server_index = HttpWrapper::find_server(character.server);
@@ -143,10 +147,23 @@ namespace ALBot {
 		info.userId = HttpWrapper::userID;
 		info.G = &HttpWrapper::data;
 		info.parent_handler = ipc_handler;
+		if (HttpWrapper::config->contains("sharedReactor")) {
+			info.sharedReactor = HttpWrapper::config->at("sharedReactor").get<bool>();
+		}
+		if (HttpWrapper::config->contains("compression")) {
+			info.compression = HttpWrapper::config->at("compression").get<bool>();
+		}
+		if (HttpWrapper::config->contains("capture")) {
+			info.capturePath = HttpWrapper::config->at("capture").get<std::string>();
+		}
+		if (HttpWrapper::config->contains("socketUrl")) {
+			info.socketUrl = HttpWrapper::config->at("socketUrl").get<std::string>();
+		}
 		std::string file = "CODE/" + HttpWrapper::characters[index].name + ".so";
 		void* handle = dlopen(file.c_str(), RTLD_LAZY);
 		if (!handle) {
 			mLogger->error("Cannot open library: {}", dlerror());
+			return false;
 		} else {
 			// load the symbol
 			typedef std::thread& (*init_t)(CharacterGameInfo&);
@@ -160,7 +177,7 @@ namespace ALBot {
 				mLogger->error("Cannot load symbol 'init': {}", dlsym_error);
 				mLogger->flush();
 				dlclose(handle);
-				return;
+				return false;
 			}
 			DLHANDLES.push_back(handle);
 			CHARACTER_THREADS.emplace_back(init(info));
@@ -171,6 +188,7 @@ namespace ALBot {
 			if (info.child_handler == nullptr) {
 				mLogger->warn("Character {} did not register a handler! This prevents other processes from communicating with it!", character.name);
 			}
+			return true;
 		}
 	}
 
@@ -187,13 +205,15 @@ namespace ALBot {
 			mLogger->info("Running in services only mode! No connection to the internet will be made, game data will not be updated.");
 			servicesOnly = true;
 		}
-		if (!servicesOnly && !HttpWrapper::login()) {
-			exit(1);
-		}
-
 
 		if (!servicesOnly && !config["fetch"].is_null() && config["fetch"].get<bool>()) {
-			if (!HttpWrapper::get_characters()) {
+			// Only the characters are needed. The version check and signing in overlap, like they
+			// do when starting normally.
+			TaskGraph fetch(mLogger);
+			fetch.add("fetch_game_version", HttpWrapper::fetch_game_version);
+			TaskGraph::Id sign_in = fetch.add("sign_in", HttpWrapper::sign_in);
+			fetch.add("get_characters", HttpWrapper::get_characters, { sign_in });
+			if (!fetch.run()) {
 				exit(1);
 			} else {
 				mLogger->info("Writing characters to file...");
@@ -222,15 +242,11 @@ namespace ALBot {
 			}
 		}
 
+		// Which characters run, and so which scripts get built, decides the shape of the startup graph.
+		// It's all in bot.json, so it's settled before anything else starts.
 		if (!servicesOnly && !HttpWrapper::process_characters(config["characters"])) {
 			exit(1);
 		}
-
-		if (!servicesOnly && !HttpWrapper::get_servers()) {
-
-		}
-		HttpWrapper::get_game_data();
-		clean_code();
 		std::vector<size_t> to_run = std::vector<size_t>();
 		to_run.reserve(4);
 		int merchants_found = 0;
@@ -257,20 +273,6 @@ namespace ALBot {
 				}
 			}
 		}
-		for (size_t i = 0; i < HttpWrapper::services.size(); i++) {
-			HttpWrapper::Service& service = HttpWrapper::services[i];
-			if (service.enabled) {
-				start_service(i);
-			}
-		}
-		for (size_t i = 0; i < SERVICE_THREADS.size(); i++) {
-			SERVICE_THREADS[i].join();
-		}
-		if (servicesOnly) {
-			SERVICE_HANDLERS.clear();
-			return;
-		}
-
 		std::map<std::string, std::pair<std::vector<std::string>,std::vector<ClassEnum::CLASS>>> script_to_characters;
 
 		for (size_t character_id : to_run) {
@@ -280,17 +282,81 @@ namespace ALBot {
 			entry.second.push_back(character.klass);
 		}
 
-		for (const auto& entry : script_to_characters) {
-			build_code(entry.first, entry.second.first, entry.second.second);
+		// Every step runs as soon as what it needs is there: data.js downloads while signing in,
+		// scripts compile while the server list is fetched, and each character connects as soon as
+		// its own script is built.
+		TaskGraph startup(mLogger);
+		std::mutex start_mutex;
+		TaskGraph::Id clean = startup.add("clean_code", []() {
+			clean_code();
+			return true;
+		});
+		// Without these there's nothing to run, so startup fails like a failed login always has.
+		std::vector<TaskGraph::Id> required;
+		std::vector<TaskGraph::Id> game_data_needs;
+		if (!servicesOnly) {
+			game_data_needs.push_back(startup.add("fetch_game_version", HttpWrapper::fetch_game_version));
+			required.push_back(game_data_needs.back());
 		}
-		
-		for (size_t character_id : to_run) {
-			start_character(character_id);
+		TaskGraph::Id game_data = startup.add("get_game_data", HttpWrapper::get_game_data, game_data_needs);
+		required.push_back(game_data);
+		TaskGraph::Id services = startup.add("start_services", [&start_mutex]() {
+			std::lock_guard<std::mutex> lock(start_mutex);
+			size_t failed = 0;
+			for (size_t i = 0; i < HttpWrapper::services.size(); i++) {
+				HttpWrapper::Service& service = HttpWrapper::services[i];
+				if (service.enabled && !start_service(i)) {
+					failed++;
+				}
+			}
+			if (failed != 0) {
+				mLogger->error("{} services failed to start, starting the characters without them.", failed);
+			}
+			// Characters wait for this task, so they still start after every service thread is done.
+			for (size_t i = 0; i < SERVICE_THREADS.size(); i++) {
+				SERVICE_THREADS[i].join();
+			}
+			// A broken service doesn't keep the characters from starting.
+			return true;
+		}, { clean, game_data });
+		if (!servicesOnly) {
+			TaskGraph::Id sign_in = startup.add("sign_in", HttpWrapper::sign_in);
+			required.push_back(sign_in);
+			TaskGraph::Id servers = startup.add("get_servers", HttpWrapper::get_servers, { sign_in });
+			std::map<std::string, TaskGraph::Id> builds;
+			for (const auto& entry : script_to_characters) {
+				builds[entry.first] = startup.add(fmt::format("build_code {}", entry.first), [&entry]() {
+					build_code(entry.first, entry.second.first, entry.second.second);
+					return true;
+				}, { clean });
+			}
+			for (size_t character_id : to_run) {
+				const Character& character = HttpWrapper::characters[character_id];
+				startup.add(fmt::format("start_character {}", character.name), [&start_mutex, character_id]() {
+					// The handler maps and the handle lists aren't safe to grow from two threads.
+					std::lock_guard<std::mutex> lock(start_mutex);
+					return start_character(character_id);
+				}, { builds.at(character.script), servers, game_data, services });
+			}
 		}
+		startup.run();
+		for (TaskGraph::Id id : required) {
+			if (startup.getState(id) != TaskGraph::SUCCEEDED) {
+				exit(1);
+			}
+		}
+		if (servicesOnly) {
+			SERVICE_HANDLERS.clear();
+			return;
+		}
+
 		for(std::thread& character_thread : CHARACTER_THREADS) {
-			character_thread.join();
+			// Characters on the shared reactor all hand out the same thread.
+			if (character_thread.joinable()) {
+				character_thread.join();
+			}
 		}
-		if (merchants_found == 0 && fighters_found == 0) {
+		if (CHARACTER_THREADS.empty()) {
 			mLogger->warn("No characters started.");
 		}
 		CHARACTER_HANDLERS.clear();
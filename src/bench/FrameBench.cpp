@@ -0,0 +1,155 @@
+/**
+ * Replays the inbound frames of a wire capture through FrameParser, and checks every one of them
+ * against the way messageReceiver used to read frames: copy everything after the type digits
+ * with substr() and parse the whole array with nlohmann::json.
+ *
+ * Every EVENT frame FrameParser splits in place has to come out with the same event name, and a
+ * payload that parses to the same JSON as the second element of the array. Frames that aren't
+ * valid, or that FrameParser leaves to a full parse, are counted but not compared. Any mismatch
+ * fails the run.
+ *
+ * Usage: albot-frame-bench <capture> [iterations]
+ *
+ * <capture> is written by a socket with a recorder, see the `capture` key of bot.json.
+ */
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "albot/Utils/FrameParser.hpp"
+#include "albot/Utils/WireCapture.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+double nsPerFrame(Clock::duration elapsed, size_t frames) {
+	return frames == 0 ? 0.0 : std::chrono::duration<double, std::nano>(elapsed).count() / double(frames);
+}
+
+/**
+ * The old messageReceiver: the body after one or two type digits, copied and parsed whole.
+ */
+bool referenceParse(const std::string& message, nlohmann::json& json) {
+	if (message.length() < 2) {
+		return false;
+	}
+	const int packetType = message[1] - '0';
+	const std::string args = packetType < 0 || packetType > 9 ? message.substr(1) : message.substr(2);
+	json = nlohmann::json::parse(args, nullptr, false);
+	return !json.is_discarded();
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " <capture> [iterations]" << std::endl;
+		return 1;
+	}
+	const size_t iterations = argc > 2 ? std::stoul(argv[2]) : 10;
+
+	WireCapture::Reader reader(argv[1]);
+	if (!reader.isValid()) {
+		std::cerr << argv[1] << " isn't a wire capture." << std::endl;
+		return 1;
+	}
+	std::vector<std::string> messages;
+	WireCapture::replay(reader, false, [&messages](const WireCapture::Record& record) {
+		if (record.direction == WireCapture::INBOUND) {
+			messages.push_back(record.frame);
+		}
+	});
+	if (messages.empty()) {
+		std::cerr << argv[1] << " has no inbound frames." << std::endl;
+		return 1;
+	}
+
+	size_t events = 0;
+	size_t fullParses = 0;
+	size_t invalid = 0;
+	size_t mismatches = 0;
+	for (const std::string& message : messages) {
+		FrameParser::Frame frame;
+		if (!FrameParser::decode(message, frame)) {
+			invalid++;
+			continue;
+		}
+		if (frame.frameType != FrameParser::MESSAGE || frame.packetType != FrameParser::EVENT) {
+			continue;
+		}
+		events++;
+		if (frame.needsFullParse) {
+			fullParses++;
+			continue;
+		}
+		nlohmann::json reference;
+		if (!referenceParse(message, reference) || !reference.is_array() || reference.empty() || !reference[0].is_string()) {
+			std::cerr << "FrameParser split a frame nlohmann::json can't read: " << message.substr(0, 200) << std::endl;
+			mismatches++;
+			continue;
+		}
+		const nlohmann::json payload = frame.payload.empty()
+			? nlohmann::json()
+			: nlohmann::json::parse(frame.payload.begin(), frame.payload.end(), nullptr, false);
+		const nlohmann::json expected = reference.size() > 1 ? reference[1] : nlohmann::json();
+		if (frame.eventName != reference[0].get<std::string>() || payload != expected) {
+			std::cerr << "FrameParser disagrees on: " << message.substr(0, 200) << std::endl;
+			mismatches++;
+		}
+	}
+
+	// Only the frames both sides handle go into the timings.
+	std::vector<const std::string*> timed;
+	for (const std::string& message : messages) {
+		FrameParser::Frame frame;
+		if (FrameParser::decode(message, frame) && frame.packetType == FrameParser::EVENT && !frame.needsFullParse) {
+			timed.push_back(&message);
+		}
+	}
+	const size_t frames = timed.size() * iterations;
+
+	size_t sink = 0;
+	auto start = Clock::now();
+	for (size_t i = 0; i < iterations; i++) {
+		for (const std::string* message : timed) {
+			nlohmann::json json;
+			sink += referenceParse(*message, json) && json.size() > 1;
+		}
+	}
+	const double referenceNs = nsPerFrame(Clock::now() - start, frames);
+
+	start = Clock::now();
+	for (size_t i = 0; i < iterations; i++) {
+		for (const std::string* message : timed) {
+			FrameParser::Frame frame;
+			FrameParser::decode(*message, frame);
+			sink += frame.payload.size();
+		}
+	}
+	const double decodeNs = nsPerFrame(Clock::now() - start, frames);
+
+	start = Clock::now();
+	for (size_t i = 0; i < iterations; i++) {
+		for (const std::string* message : timed) {
+			FrameParser::Frame frame;
+			FrameParser::decode(*message, frame);
+			if (!frame.payload.empty()) {
+				sink += nlohmann::json::parse(frame.payload.begin(), frame.payload.end(), nullptr, false).size();
+			}
+		}
+	}
+	const double parsedNs = nsPerFrame(Clock::now() - start, frames);
+
+	std::printf("%zu inbound frames, %zu events, %zu left to a full parse, %zu invalid (checksum %zu)\n",
+		messages.size(), events, fullParses, invalid, sink);
+	std::printf("%-32s %10.1f ns per event\n", "substr + parse the array", referenceNs);
+	std::printf("%-32s %10.1f ns per event\n", "FrameParser::decode", decodeNs);
+	std::printf("%-32s %10.1f ns per event\n", "FrameParser + parse the payload", parsedNs);
+	if (mismatches != 0) {
+		std::fprintf(stderr, "%zu frames decoded differently.\n", mismatches);
+		return 1;
+	}
+	std::printf("Every event frame matches the full parse.\n");
+	return 0;
+}
@@ -0,0 +1,124 @@
+/**
+ * Times loading game data from the cache at startup: parsing data.json, the way a cache hit used
+ * to, against mapping data.bin. Also times writing data.bin, which happens once per game version,
+ * and decoding the JSON out of it, which only happens if something asks for G as JSON.
+ *
+ * The document decoded from data.bin has to equal data.json, and the tables loaded from it the
+ * tables built from data.json. Otherwise the run fails.
+ *
+ * Usage: albot-gamedata-bench [data.json] [--runs <count>]
+ *
+ * Writes gamedata-bench.bin next to the working directory, and removes it afterwards.
+ */
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "albot/GameDataCache.hpp"
+#include "albot/ServiceInterface.hpp"
+
+constexpr const char* CACHE_PATH = "gamedata-bench.bin";
+
+double msSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool sameTables(const GameTables& a, const GameTables& b) {
+	if (a.getMonsters().size() != b.getMonsters().size() || a.getSkills().size() != b.getSkills().size() ||
+		a.getItems().size() != b.getItems().size()) {
+		return false;
+	}
+	for (const MonsterInfo& monster : a.getMonsters()) {
+		const MonsterInfo* other = b.getMonsters().find(monster.name);
+		if (other == nullptr || other->hp != monster.hp || other->speed != monster.speed || other->damageType != monster.damageType) {
+			return false;
+		}
+	}
+	for (const SkillInfo& skill : a.getSkills()) {
+		const SkillInfo* other = b.getSkills().find(skill.name);
+		if (other == nullptr || other->cooldown != skill.cooldown || other->share != skill.share) {
+			return false;
+		}
+	}
+	for (const ItemInfo& item : a.getItems()) {
+		const ItemInfo* other = b.getItems().find(item.name);
+		if (other == nullptr || other->slot != item.slot || other->value != item.value || other->stats.crit != item.stats.crit) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	std::string dataPath = "data.json";
+	int runs = 10;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--runs" && i + 1 < argc) {
+			runs = std::stoi(argv[++i]);
+		} else {
+			dataPath = arg;
+		}
+	}
+	if (!std::ifstream(dataPath)) {
+		std::cerr << "Can't open " << dataPath << std::endl;
+		return 1;
+	}
+
+	double parseMs = 0;
+	GameData parsed;
+	for (int run = 0; run < runs; run++) {
+		std::ifstream file(dataPath);
+		auto start = std::chrono::steady_clock::now();
+		parsed = GameData(file);
+		parseMs += msSince(start);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	if (!GameDataCache::write(CACHE_PATH, 1, parsed.getData())) {
+		std::cerr << "Can't write " << CACHE_PATH << std::endl;
+		return 1;
+	}
+	const double writeMs = msSince(start);
+
+	double mapMs = 0;
+	double decodeMs = 0;
+	bool identical = true;
+	size_t size = 0;
+	size_t maps = 0;
+	for (int run = 0; run < runs; run++) {
+		start = std::chrono::steady_clock::now();
+		std::shared_ptr<const GameDataCache> cache = GameDataCache::open(CACHE_PATH, 1);
+		if (cache == nullptr) {
+			std::cerr << "Can't map " << CACHE_PATH << std::endl;
+			return 1;
+		}
+		GameData mapped(cache);
+		mapMs += msSince(start);
+
+		start = std::chrono::steady_clock::now();
+		const nlohmann::json& document = mapped.getData();
+		decodeMs += msSince(start);
+
+		if (run == 0) {
+			identical = document == parsed.getData() && sameTables(mapped.getTables(), parsed.getTables());
+			size = cache->getSize();
+			maps = cache->getMapCount();
+		}
+	}
+	std::remove(CACHE_PATH);
+
+	std::printf("%s: %zu KiB cache, %zu maps, %zu monsters, %zu skills, %zu items\n", dataPath.c_str(), size / 1024, maps,
+		parsed.getTables().getMonsters().size(), parsed.getTables().getSkills().size(), parsed.getTables().getItems().size());
+	std::printf("%-28s %10.2f ms\n", "parse data.json + tables", parseMs / runs);
+	std::printf("%-28s %10.2f ms\n", "map data.bin + tables", mapMs / runs);
+	std::printf("%-28s %10.2f ms\n", "decode G from data.bin", decodeMs / runs);
+	std::printf("%-28s %10.2f ms  (once per game version)\n", "write data.bin", writeMs);
+	if (!identical) {
+		std::fprintf(stderr, "data.bin doesn't hold the same game data as %s\n", dataPath.c_str());
+		return 1;
+	}
+	return 0;
+}
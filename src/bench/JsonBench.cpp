@@ -0,0 +1,120 @@
+/**
+ * Compares the inbound JSON backends on recorded socket traffic.
+ *
+ * Usage: albot-json-bench <frames> [iterations]
+ *
+ * <frames> holds one raw websocket text message per line, as received by a callback
+ * registered with SocketWrapper::registerRawMessageCallback. Every backend this build was
+ * compiled with decodes the same frames the way the socket would: entities, start and new_map
+ * into typed records, everything else into a DOM.
+ */
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "albot/JsonBackend.hpp"
+#include "albot/Enums/EventEnum.hpp"
+#include "albot/Utils/FrameParser.hpp"
+
+struct Result {
+	size_t records = 0;
+	size_t documents = 0;
+	size_t failures = 0;
+	double entityNs = 0;
+	double documentNs = 0;
+};
+
+Result run(JsonBackend& backend, const std::vector<FrameParser::Frame>& frames, const MonsterTable& monsters, size_t iterations) {
+	using Clock = std::chrono::steady_clock;
+	Result result;
+	for (size_t i = 0; i < iterations; i++) {
+		for (const FrameParser::Frame& frame : frames) {
+			EventEnum::EVENT event = EventEnum::getEventId(frame.eventName);
+			auto start = Clock::now();
+			if (event == EventEnum::ENTITIES || event == EventEnum::START || event == EventEnum::NEW_MAP) {
+				EntityBatch batch;
+				bool success = event == EventEnum::ENTITIES
+					? backend.decodeEntities(frame.payload, batch, monsters, {})
+					: backend.decodeWrapped(frame.payload, batch, monsters);
+				result.entityNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+				result.records += batch.records.size();
+				result.failures += !success;
+			} else {
+				nlohmann::json document;
+				bool success = backend.parseDocument(frame.payload, document);
+				result.documentNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+				result.documents++;
+				result.failures += !success;
+			}
+		}
+	}
+	return result;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " <frames> [iterations]" << std::endl;
+		return 1;
+	}
+	size_t iterations = argc > 2 ? std::stoul(argv[2]) : 20;
+
+	std::ifstream file(argv[1]);
+	if (!file) {
+		std::cerr << "Can't open " << argv[1] << std::endl;
+		return 1;
+	}
+	std::vector<std::string> lines;
+	for (std::string line; std::getline(file, line);) {
+		lines.push_back(std::move(line));
+	}
+	// Frames are views into `lines`, which doesn't change from here on.
+	std::vector<FrameParser::Frame> frames;
+	size_t entityFrames = 0;
+	size_t entityBytes = 0;
+	size_t documentBytes = 0;
+	for (const std::string& line : lines) {
+		FrameParser::Frame frame;
+		if (!FrameParser::decode(line, frame) || frame.packetType != FrameParser::EVENT || frame.needsFullParse || frame.payload.empty()) {
+			continue;
+		}
+		EventEnum::EVENT event = EventEnum::getEventId(frame.eventName);
+		if (event == EventEnum::ENTITIES || event == EventEnum::START || event == EventEnum::NEW_MAP) {
+			entityFrames++;
+			entityBytes += frame.payload.size();
+		} else {
+			documentBytes += frame.payload.size();
+		}
+		frames.push_back(frame);
+	}
+	std::printf("%zu event frames, %zu bytes of entities, %zu bytes of other events, %zu iterations\n",
+		frames.size(), entityBytes, documentBytes, iterations);
+
+	MonsterTable monsters;
+	size_t expectedRecords = 0;
+	bool first = true;
+	for (std::string_view name : JsonBackend::getAvailable()) {
+		std::unique_ptr<JsonBackend> backend = JsonBackend::create(name);
+		// Warm up allocations and the backend's buffers.
+		run(*backend, frames, monsters, 1);
+		Result result = run(*backend, frames, monsters, iterations);
+		double entitySeconds = result.entityNs / 1e9;
+		double documentSeconds = result.documentNs / 1e9;
+		std::printf("%-10s entities: %8.1f MB/s %10.0f ns/frame | other events: %8.1f MB/s | %zu records, %zu failures\n",
+			std::string(name).c_str(),
+			entitySeconds > 0 ? entityBytes * iterations / entitySeconds / 1e6 : 0.0,
+			entityFrames == 0 ? 0.0 : result.entityNs / (entityFrames * iterations),
+			documentSeconds > 0 ? documentBytes * iterations / documentSeconds / 1e6 : 0.0,
+			result.records / iterations, result.failures / iterations);
+		if (first) {
+			expectedRecords = result.records;
+			first = false;
+		} else if (result.records != expectedRecords) {
+			std::printf("%s decoded a different number of records!\n", std::string(name).c_str());
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,198 @@
+/**
+ * Measures how albot-cpp scales with the number of characters in one process.
+ *
+ * Usage: albot-loadtest [--bots 1,2,4,8,16] [--duration <seconds>] [--monsters <n>] [--shared-reactor]
+ *
+ * Starts the stand-in server in process, then adds bots step by step until each count in
+ * --bots is reached. Every bot attacks the first monster it knows of whenever a frame has
+ * arrived since its last tick. After each step has run for --duration seconds, the driver reports
+ * memory and CPU per bot, the process thread count, and the event-to-action latency the
+ * server saw: the time from an `entities` update to the next command from that bot.
+ */
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "albot/BotSkeleton.hpp"
+#include "StandInServer.hpp"
+
+class LoadBot : public BotSkeleton {
+	private:
+		std::atomic<bool> pendingFrame = false;
+	public:
+		LoadBot(const CharacterGameInfo& info) : BotSkeleton(info) {
+			wrapper.registerRawMessageCallback([this](const ix::WebSocketMessagePtr&) {
+				pendingFrame = true;
+			});
+			loop.setInterval([this]() {
+				if (!pendingFrame.exchange(false)) {
+					return;
+				}
+				for (const EntityStore::Entity entity : wrapper.getEntities()) {
+					if (entity.isMonster()) {
+						wrapper.attack(entity.getId());
+						break;
+					}
+				}
+			}, 1000.0 / 60.0);
+		}
+};
+
+struct BotSlot {
+	Character character;
+	CharacterGameInfo info;
+	std::unique_ptr<LoadBot> bot;
+};
+
+namespace {
+	// Resident set size, in KiB.
+	size_t residentKib() {
+		std::ifstream statm("/proc/self/statm");
+		size_t pages = 0;
+		size_t resident = 0;
+		statm >> pages >> resident;
+		return resident * (sysconf(_SC_PAGESIZE) / 1024);
+	}
+	size_t threadCount() {
+		std::ifstream status("/proc/self/status");
+		for (std::string line; std::getline(status, line);) {
+			if (line.rfind("Threads:", 0) == 0) {
+				return std::stoul(line.substr(8));
+			}
+		}
+		return 0;
+	}
+	double cpuSeconds() {
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+	}
+	double percentile(std::vector<double>& values, double p) {
+		if (values.empty()) {
+			return 0;
+		}
+		size_t index = std::min(values.size() - 1, size_t(p * values.size()));
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[index];
+	}
+}
+
+int main(int argc, char** argv) {
+	std::vector<size_t> steps = { 1, 2, 4, 8, 16 };
+	int duration = 10;
+	bool sharedReactor = false;
+	StandInServer::Options options;
+	options.httpPort = 18080;
+	options.socketPort = 18022;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--shared-reactor") {
+			sharedReactor = true;
+		} else if (arg == "--bots" && i + 1 < argc) {
+			steps.clear();
+			std::stringstream list(argv[++i]);
+			for (std::string count; std::getline(list, count, ',');) {
+				steps.push_back(std::stoul(count));
+			}
+			std::sort(steps.begin(), steps.end());
+		} else if (arg == "--duration" && i + 1 < argc) {
+			duration = std::stoi(argv[++i]);
+		} else if (arg == "--monsters" && i + 1 < argc) {
+			options.monsters = std::stoul(argv[++i]);
+		} else {
+			std::cerr << "Unknown argument " << arg << std::endl;
+			return 1;
+		}
+	}
+	spdlog::set_level(spdlog::level::warn);
+	options.characters = steps.empty() ? 0 : steps.back();
+
+	StandInServer server(options);
+	if (!server.start()) {
+		return 1;
+	}
+	GameData G;
+	Server gameServer = { "STANDIN", options.socketPort, false, options.host, "I", "", "STANDIN I" };
+	gameServer.url = options.host + ":" + std::to_string(options.socketPort);
+
+	const size_t baselineKib = residentKib();
+	const size_t baselineThreads = threadCount();
+	// Slots never move, bots hold references to their info.
+	std::deque<BotSlot> slots;
+	std::printf("%6s %12s %12s %10s %10s %10s %10s\n", "bots", "KiB/bot", "CPU%/bot", "threads", "p50 ms", "p99 ms", "actions/s");
+	for (size_t target : steps) {
+		while (slots.size() < target) {
+			BotSlot& slot = slots.emplace_back();
+			size_t index = slots.size() - 1;
+			slot.character = { StandInServer::characterName(index), StandInServer::FIRST_CHARACTER_ID + index, true, ClassEnum::PRIEST, "LoadTest", gameServer.fullName };
+			slot.info.server = &gameServer;
+			slot.info.character = &slot.character;
+			slot.info.G = &G;
+			slot.info.auth = "standin";
+			slot.info.userId = "1";
+			slot.info.sharedReactor = sharedReactor;
+			slot.info.compression = false;
+			slot.info.socketUrl = gameServer.url;
+			slot.bot = std::make_unique<LoadBot>(slot.info);
+			slot.bot->connect();
+		}
+		// Let everyone connect and settle before measuring.
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		auto before = server.getStats();
+		double cpuBefore = cpuSeconds();
+		auto start = std::chrono::steady_clock::now();
+		std::this_thread::sleep_for(std::chrono::seconds(duration));
+		double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		double cpu = cpuSeconds() - cpuBefore;
+		auto after = server.getStats();
+
+		std::vector<double> latencies;
+		size_t actions = 0;
+		for (const auto& [character, stats] : after) {
+			size_t skip = 0;
+			size_t previousActions = 0;
+			auto it = before.find(character);
+			if (it != before.end()) {
+				skip = it->second.actionLatencies.size();
+				previousActions = it->second.commandsReceived;
+			}
+			actions += stats.commandsReceived - previousActions;
+			latencies.insert(latencies.end(), stats.actionLatencies.begin() + skip, stats.actionLatencies.end());
+		}
+		// The server shares the process, so its share of CPU is included in these numbers.
+		std::printf("%6zu %12.0f %12.2f %10zu %10.2f %10.2f %10.1f\n",
+			target,
+			double(residentKib() - baselineKib) / target,
+			cpu / wall * 100.0 / target,
+			threadCount() - baselineThreads,
+			percentile(latencies, 0.5),
+			percentile(latencies, 0.99),
+			actions / wall);
+	}
+	for (BotSlot& slot : slots) {
+		slot.bot->stop();
+		// A bot that never got to start is still waiting for it.
+		slot.bot->loop_running = true;
+		slot.bot->loop_running.notify_all();
+	}
+	server.stop();
+	for (BotSlot& slot : slots) {
+		if (slot.bot->getThread().joinable()) {
+			slot.bot->getThread().join();
+		}
+	}
+	return 0;
+}
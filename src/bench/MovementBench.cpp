@@ -0,0 +1,172 @@
+/**
+ * Times a second of entity movement: MovementMath stepping JSON entities every tick, the way the
+ * world used to move, against settling segments with MovementKernel every
+ * EntityStore::SETTLE_INTERVAL, with every instruction set this CPU has.
+ *
+ * Every instruction set has to produce the same bits as the scalar kernel, and end up where the
+ * JSON entities did, give or take the 0.1 units stopLogic snaps over. Otherwise the run fails.
+ *
+ * Usage: albot-movement-bench [entities...]
+ *
+ * Defaults to 1000, 2000, 5000 and 10000 entities.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "albot/EntityStore.hpp"
+#include "albot/MovementKernel.hpp"
+#include "albot/MovementMath.hpp"
+
+constexpr uint32_t MOVING = EntityStore::MOVING;
+constexpr uint32_t RIP = EntityStore::RIP;
+// A tick at 60 fps, for a second of game time.
+constexpr double STEP = 1000.0 / 60.0;
+constexpr size_t STEPS = 60;
+constexpr size_t SETTLES = size_t(1000.0 / EntityStore::SETTLE_INTERVAL);
+
+struct World {
+	std::vector<double> x, y, vx, vy, fromX, fromY, goingX, goingY, movedAt, arriveAt;
+	std::vector<uint32_t> flags;
+	std::vector<uint8_t> arrived;
+
+	MovementKernel::Columns columns() {
+		return {
+			x.data(), y.data(), vx.data(), vy.data(), goingX.data(), goingY.data(), movedAt.data(), arriveAt.data(),
+			flags.data(), arrived.data(), x.size()
+		};
+	}
+};
+
+World generate(size_t count) {
+	std::mt19937_64 random(count);
+	std::uniform_real_distribution<double> position(-2000, 2000);
+	std::uniform_real_distribution<double> distance(-300, 300);
+	std::uniform_real_distribution<double> speed(20, 80);
+	World world;
+	for (size_t i = 0; i < count; i++) {
+		double x = position(random);
+		double y = position(random);
+		double goingX = x + distance(random);
+		double goingY = y + distance(random);
+		const double entitySpeed = speed(random);
+		auto [vx, vy] = MovementMath::calculateVelocity(x, y, goingX, goingY, entitySpeed);
+		world.x.push_back(x);
+		world.y.push_back(y);
+		world.fromX.push_back(x);
+		world.fromY.push_back(y);
+		world.goingX.push_back(goingX);
+		world.goingY.push_back(goingY);
+		world.vx.push_back(vx);
+		world.vy.push_back(vy);
+		world.movedAt.push_back(0);
+		world.arriveAt.push_back(std::hypot(goingX - x, goingY - y) / entitySpeed * 1000.0);
+		// About a quarter stand still or are dead, like on a busy map.
+		uint64_t roll = random() % 8;
+		world.flags.push_back(roll == 0 ? 0 : roll == 1 ? MOVING | RIP : MOVING);
+	}
+	world.arrived.resize(count);
+	return world;
+}
+
+std::vector<nlohmann::json> toJson(const World& world) {
+	std::vector<nlohmann::json> entities;
+	for (size_t i = 0; i < world.x.size(); i++) {
+		entities.push_back({
+			{"x", world.x[i]}, {"y", world.y[i]}, {"from_x", world.fromX[i]}, {"from_y", world.fromY[i]},
+			{"going_x", world.goingX[i]}, {"going_y", world.goingY[i]}, {"vx", world.vx[i]}, {"vy", world.vy[i]},
+			{"moving", world.flags[i] == MOVING}
+		});
+	}
+	return entities;
+}
+
+double nsPerEntity(std::chrono::steady_clock::duration elapsed, size_t count) {
+	return std::chrono::duration<double, std::nano>(elapsed).count() / double(count);
+}
+
+bool sameBits(double a, double b) {
+	return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+int main(int argc, char** argv) {
+	std::vector<size_t> counts;
+	for (int i = 1; i < argc; i++) {
+		counts.push_back(std::stoul(argv[i]));
+	}
+	if (counts.empty()) {
+		counts = { 1000, 2000, 5000, 10000 };
+	}
+	const MovementKernel::Isa isas[] = { MovementKernel::SCALAR, MovementKernel::SSE2, MovementKernel::AVX2 };
+
+	std::printf("%8s %10s %10s %10s %10s  (ns per entity per second of movement)\n", "entities", "json", "scalar", "sse2", "avx2");
+	bool identical = true;
+	for (size_t count : counts) {
+		const World initial = generate(count);
+
+		std::vector<nlohmann::json> entities = toJson(initial);
+		auto start = std::chrono::steady_clock::now();
+		for (size_t step = 0; step < STEPS; step++) {
+			for (nlohmann::json& entity : entities) {
+				MovementMath::moveEntity(entity, STEP);
+				MovementMath::stopLogic(entity);
+			}
+		}
+		const double jsonNs = nsPerEntity(std::chrono::steady_clock::now() - start, count);
+
+		std::printf("%8zu %10.2f", count, jsonNs);
+		World reference;
+		for (MovementKernel::Isa isa : isas) {
+			if (!MovementKernel::isSupported(isa)) {
+				std::printf(" %10s", "-");
+				continue;
+			}
+			World world = initial;
+			MovementKernel::Columns columns = world.columns();
+			start = std::chrono::steady_clock::now();
+			for (size_t settle = 1; settle <= SETTLES; settle++) {
+				if (MovementKernel::settle(columns, double(settle) * EntityStore::SETTLE_INTERVAL, MOVING | RIP, MOVING, isa) != 0) {
+					// Arrived entities stop, like EntityStore::settle does.
+					for (size_t i = 0; i < count; i++) {
+						if (world.arrived[i]) {
+							world.flags[i] &= ~MOVING;
+						}
+					}
+				}
+			}
+			std::printf(" %10.2f", nsPerEntity(std::chrono::steady_clock::now() - start, count));
+
+			if (isa == MovementKernel::SCALAR) {
+				reference = world;
+			}
+			for (size_t i = 0; i < count; i++) {
+				double x = entities[i]["x"];
+				double y = entities[i]["y"];
+				if (!sameBits(world.x[i], reference.x[i]) || !sameBits(world.y[i], reference.y[i])) {
+					std::fprintf(stderr, "\n%s differs from scalar at entity %zu: %.17g,%.17g vs %.17g,%.17g\n",
+						MovementKernel::getName(isa), i, world.x[i], world.y[i], reference.x[i], reference.y[i]);
+					identical = false;
+					break;
+				}
+				if (std::abs(world.x[i] - x) > 0.11 || std::abs(world.y[i] - y) > 0.11) {
+					std::fprintf(stderr, "\n%s strays from json at entity %zu: %.17g,%.17g vs %.17g,%.17g\n",
+						MovementKernel::getName(isa), i, world.x[i], world.y[i], x, y);
+					identical = false;
+					break;
+				}
+			}
+		}
+		std::printf("\n");
+	}
+	if (!identical) {
+		return 1;
+	}
+	std::printf("Every instruction set matches the scalar kernel bit for bit, and the json positions.\n");
+	return 0;
+}
@@ -0,0 +1,120 @@
+/**
+ * Replays a wire capture through the client, without a server.
+ *
+ * Usage: albot-replay <capture> [--realtime] [--character <id>] [--data <data.json>]
+ *
+ * <capture> is written by a socket with a recorder, see the `capture` key of bot.json.
+ * Inbound frames of one character (the first one in the capture by default) go through
+ * SocketWrapper::messageReceiver, and the world is advanced at 60 Hz of recorded time in between,
+ * so two runs over the same capture do exactly the same work.
+ */
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "albot/BotSkeleton.hpp"
+#include "albot/Utils/WireCapture.hpp"
+
+class ReplayBot : public BotSkeleton {
+	public:
+		ReplayBot(const CharacterGameInfo& info) : BotSkeleton(info) {
+			wrapper.setReplaying(true);
+		}
+		void tick(Types::TimePoint now) {
+			processInternals(now);
+		}
+		void onDisconnect(std::string reason) override {
+			mLogger->info("Disconnected in the capture: {}", reason);
+		}
+};
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " <capture> [--realtime] [--character <id>] [--data <data.json>]" << std::endl;
+		return 1;
+	}
+	bool realtime = false;
+	std::optional<uint64_t> characterId;
+	std::string dataPath = "data.json";
+	for (int i = 2; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--realtime") {
+			realtime = true;
+		} else if (arg == "--character" && i + 1 < argc) {
+			characterId = std::stoull(argv[++i]);
+		} else if (arg == "--data" && i + 1 < argc) {
+			dataPath = argv[++i];
+		} else {
+			std::cerr << "Unknown argument " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	WireCapture::Reader reader(argv[1]);
+	if (!reader.isValid()) {
+		std::cerr << argv[1] << " isn't a wire capture." << std::endl;
+		return 1;
+	}
+	// Monster defaults come from G. Without it, the replay still runs, monsters just lack them.
+	GameData G;
+	std::ifstream dataFile(dataPath);
+	if (dataFile) {
+		G = GameData(dataFile);
+	} else {
+		std::cerr << "Can't open " << dataPath << ", replaying without game data." << std::endl;
+	}
+	Server server = { "REPLAY", 0, false, "", "I", "localhost", "REPLAY I" };
+	Character character = { "replay", 0, true, ClassEnum::PRIEST, "Default", server.fullName };
+	CharacterGameInfo info;
+	info.server = &server;
+	info.character = &character;
+	info.G = &G;
+	// The reactor is never started, so nothing but this thread touches the bot.
+	info.sharedReactor = true;
+	ReplayBot bot(info);
+
+	using Clock = std::chrono::steady_clock;
+	const std::chrono::nanoseconds tickInterval = std::chrono::nanoseconds(1000000000 / 60);
+	const Types::TimePoint origin = Types::Clock::now();
+	std::chrono::nanoseconds nextTick = std::chrono::nanoseconds(0);
+	size_t frames = 0;
+	size_t bytes = 0;
+	size_t skipped = 0;
+	size_t ticks = 0;
+	double receiveNs = 0;
+	double tickNs = 0;
+	const auto start = Clock::now();
+	WireCapture::replay(reader, realtime, [&](const WireCapture::Record& record) {
+		if (!characterId.has_value()) {
+			characterId = record.characterId;
+		}
+		if (record.direction != WireCapture::INBOUND || record.characterId != characterId) {
+			skipped++;
+			return;
+		}
+		auto tickStart = Clock::now();
+		for (; nextTick <= record.time; nextTick += tickInterval) {
+			bot.tick(origin + std::chrono::duration_cast<Types::Clock::duration>(nextTick));
+			ticks++;
+		}
+		auto receiveStart = Clock::now();
+		bot.wrapper.replayMessage(record.frame);
+		auto end = Clock::now();
+		tickNs += std::chrono::duration<double, std::nano>(receiveStart - tickStart).count();
+		receiveNs += std::chrono::duration<double, std::nano>(end - receiveStart).count();
+		frames++;
+		bytes += record.frame.size();
+	});
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::printf("character %llu: %zu inbound frames (%zu bytes), %zu records of other characters or outbound skipped\n",
+		(unsigned long long) characterId.value_or(0), frames, bytes, skipped);
+	std::printf("%.3f s wall, %.3f s of recorded time\n", seconds, nextTick.count() / 1e9);
+	std::printf("receive: %10.0f ns/frame, %8.1f MB/s\n", frames == 0 ? 0.0 : receiveNs / frames, receiveNs > 0 ? bytes / (receiveNs / 1e9) / 1e6 : 0.0);
+	std::printf("process: %10.0f ns/tick over %zu ticks\n", ticks == 0 ? 0.0 : tickNs / ticks, ticks);
+	std::printf("%zu entities known at the end\n", bot.wrapper.getEntities().size());
+	return 0;
+}
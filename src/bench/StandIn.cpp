@@ -0,0 +1,62 @@
+/**
+ * Runs the local stand-in for the game server until interrupted.
+ *
+ * Usage: albot-standin [--host <host>] [--http-port <port>] [--socket-port <port>] [--monsters <n>] [--tick <ms>]
+ *                     [--characters <n>]
+ *
+ * Point albot-cpp at it with `"url": "http://<host>:<http port>"` and `"socketUrl": "<host>:<socket port>"` in bot.json.
+ */
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "StandInServer.hpp"
+
+namespace {
+	volatile std::sig_atomic_t interrupted = 0;
+}
+
+int main(int argc, char** argv) {
+	StandInServer::Options options;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			std::cerr << "Missing a value for " << arg << std::endl;
+			return 1;
+		}
+		if (arg == "--host") {
+			options.host = argv[++i];
+		} else if (arg == "--http-port") {
+			options.httpPort = std::stoi(argv[++i]);
+		} else if (arg == "--socket-port") {
+			options.socketPort = std::stoi(argv[++i]);
+		} else if (arg == "--monsters") {
+			options.monsters = std::stoul(argv[++i]);
+		} else if (arg == "--tick") {
+			options.tickInterval = std::stoi(argv[++i]);
+		} else if (arg == "--characters") {
+			options.characters = std::stoul(argv[++i]);
+		} else {
+			std::cerr << "Unknown argument " << arg << std::endl;
+			return 1;
+		}
+	}
+	StandInServer server(options);
+	if (!server.start()) {
+		return 1;
+	}
+	std::printf("Serving HTTP on %s:%d and websockets on %s:%d with %zu monsters.\n",
+		options.host.c_str(), options.httpPort, options.host.c_str(), options.socketPort, options.monsters);
+	std::signal(SIGINT, [](int) { interrupted = 1; });
+	std::signal(SIGTERM, [](int) { interrupted = 1; });
+	while (!interrupted) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+	server.stop();
+	for (const auto& [character, stats] : server.getStats()) {
+		std::printf("%s: %zu frames sent, %zu commands received\n", character.c_str(), stats.framesSent, stats.commandsReceived);
+	}
+	return 0;
+}
@@ -0,0 +1,335 @@
+#include "StandInServer.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+
+#include <fmt/core.h>
+
+namespace {
+	// Monsters wander within this box around the origin, which is where every character starts.
+	// It's well inside the 700x500 range BotSkeleton keeps entities in.
+	constexpr double AREA_WIDTH = 600;
+	constexpr double AREA_HEIGHT = 400;
+	constexpr double MONSTER_SPEED = 20;
+	constexpr long MONSTER_HP = 1000;
+	constexpr long ATTACK_DAMAGE = 100;
+	constexpr const char* MONSTER_TYPE = "goo";
+	constexpr const char* MAP = "main";
+	constexpr double CHARACTER_SPEED = 50;
+	constexpr long CHARACTER_HP = 5000;
+	constexpr long CHARACTER_MP = 2000;
+	constexpr long ATTACK_MP_COST = 10;
+}
+
+std::string StandInServer::characterName(size_t index) {
+	return fmt::format("Loader{}", index);
+}
+
+StandInServer::StandInServer(Options options) : options(options), http(options.httpPort, options.host), websocket(options.socketPort, options.host), random(std::random_device()()) {
+	monsters.reserve(options.monsters);
+	for (size_t i = 0; i < options.monsters; i++) {
+		monsters.push_back(spawn());
+	}
+	http.setOnConnectionCallback([this](ix::HttpRequestPtr request, std::shared_ptr<ix::ConnectionState>) {
+		return onRequest(request);
+	});
+	websocket.setOnClientMessageCallback([this](std::shared_ptr<ix::ConnectionState> state, ix::WebSocket& socket, const ix::WebSocketMessagePtr& message) {
+		onMessage(state, socket, message);
+	});
+}
+
+StandInServer::~StandInServer() {
+	stop();
+}
+
+bool StandInServer::start() {
+	auto httpResult = http.listen();
+	if (!httpResult.first) {
+		fmt::print(stderr, "Can't listen for HTTP on {}:{}: {}\n", options.host, options.httpPort, httpResult.second);
+		return false;
+	}
+	auto socketResult = websocket.listen();
+	if (!socketResult.first) {
+		fmt::print(stderr, "Can't listen for websockets on {}:{}: {}\n", options.host, options.socketPort, socketResult.second);
+		return false;
+	}
+	http.start();
+	websocket.start();
+	running = true;
+	ticker = std::thread([this]() {
+		while (running) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(options.tickInterval));
+			tick();
+		}
+	});
+	return true;
+}
+
+void StandInServer::stop() {
+	if (!running.exchange(false)) {
+		return;
+	}
+	ticker.join();
+	websocket.stop();
+	http.stop();
+}
+
+std::map<std::string, StandInServer::ClientStats> StandInServer::getStats() {
+	std::lock_guard<std::mutex> lock(guard);
+	std::map<std::string, ClientStats> stats;
+	for (const auto& [id, client] : clients) {
+		if (client.started) {
+			stats.emplace(client.character, client.stats);
+		}
+	}
+	return stats;
+}
+
+ix::HttpResponsePtr StandInServer::onRequest(ix::HttpRequestPtr request) {
+	ix::WebSocketHttpHeaders headers;
+	std::string body;
+	std::string path = request->uri.substr(0, request->uri.find('?'));
+	if (path == "/") {
+		headers["Content-Type"] = "text/html";
+		body = fmt::format("<html><head><script src=\"/data.js?v={}\"></script></head></html>", options.version);
+	} else if (path == "/data.js") {
+		headers["Content-Type"] = "application/javascript";
+		// HttpWrapper strips exactly `var G=` and the trailing `;\n`.
+		body = "var G=" + buildGameData().dump() + ";\n";
+	} else if (path == "/api/signup_or_login") {
+		headers["Set-Cookie"] = "auth=1-standin; Path=/";
+		body = nlohmann::json::array({ { {"type", "message"}, {"message", "Logged In!"} } }).dump();
+	} else if (path == "/api/servers_and_characters") {
+		nlohmann::json characters = nlohmann::json::array();
+		for (size_t i = 0; i < options.characters; i++) {
+			characters.push_back({ {"name", characterName(i)}, {"id", std::to_string(FIRST_CHARACTER_ID + i)}, {"type", "priest"}, {"server", "STANDIN I"} });
+		}
+		nlohmann::json servers = nlohmann::json::array({ { {"name", "I"}, {"region", "STANDIN"}, {"port", options.socketPort}, {"addr", options.host} } });
+		body = nlohmann::json::array({ { {"servers", servers}, {"characters", characters} } }).dump();
+	} else {
+		return std::make_shared<ix::HttpResponse>(404, "Not Found", ix::HttpErrorCode::Ok, headers, "");
+	}
+	return std::make_shared<ix::HttpResponse>(200, "OK", ix::HttpErrorCode::Ok, headers, body);
+}
+
+void StandInServer::onMessage(std::shared_ptr<ix::ConnectionState> state, ix::WebSocket& socket, const ix::WebSocketMessagePtr& message) {
+	const std::string id = state->getId();
+	std::lock_guard<std::mutex> lock(guard);
+	if (message->type == ix::WebSocketMessageType::Open) {
+		Client& client = clients[id];
+		client.socket = &socket;
+		nlohmann::json open = { {"sid", id}, {"upgrades", nlohmann::json::array()}, {"pingInterval", 25000}, {"pingTimeout", 20000}, {"maxPayload", 1000000} };
+		socket.send("0" + open.dump());
+		return;
+	}
+	if (message->type == ix::WebSocketMessageType::Close) {
+		clients.erase(id);
+		return;
+	}
+	if (message->type != ix::WebSocketMessageType::Message) {
+		return;
+	}
+	auto it = clients.find(id);
+	if (it == clients.end()) {
+		return;
+	}
+	Client& client = it->second;
+	const std::string& str = message->str;
+	if (str == "2") {
+		socket.send("3");
+	} else if (str == "40") {
+		socket.send("40" + nlohmann::json({ {"sid", id} }).dump());
+		send(client, "welcome", { {"region", "STANDIN"}, {"name", "I"}, {"pvp", false}, {"map", MAP}, {"in", MAP}, {"x", 0}, {"y", 0} });
+	} else if (str.rfind("42", 0) == 0) {
+		nlohmann::json packet = nlohmann::json::parse(str.begin() + 2, str.end(), nullptr, false);
+		if (packet.is_array() && !packet.empty() && packet[0].is_string()) {
+			onEvent(client, packet[0].get<std::string>(), packet.size() > 1 ? packet[1] : nlohmann::json());
+		}
+	}
+}
+
+void StandInServer::onEvent(Client& client, const std::string& event, const nlohmann::json& data) {
+	if (event == "loaded") {
+		return;
+	}
+	if (event == "auth") {
+		const std::string characterId = data.value("character", "");
+		uint64_t id = 0;
+		std::from_chars(characterId.data(), characterId.data() + characterId.size(), id);
+		if (id < FIRST_CHARACTER_ID || id - FIRST_CHARACTER_ID >= options.characters) {
+			fmt::print(stderr, "No character with id {}, ignoring its auth.\n", characterId);
+			return;
+		}
+		client.character = characterName(id - FIRST_CHARACTER_ID);
+		client.stats.character = client.character;
+		client.x = client.going_x = 0;
+		client.y = client.going_y = 0;
+		client.moving = false;
+		client.hp = CHARACTER_HP;
+		client.mp = CHARACTER_MP;
+		nlohmann::json monsterJson = nlohmann::json::array();
+		for (const Monster& monster : monsters) {
+			monsterJson.push_back(toJson(monster));
+		}
+		nlohmann::json start = toPlayerJson(client);
+		start.update({
+			{"name", client.character}, {"ctype", "priest"}, {"level", 50}, {"m", 1}, {"range", 120},
+			{"gold", 0}, {"s", nlohmann::json::object()}, {"rip", false},
+			{"entities", { {"type", "all"}, {"in", MAP}, {"map", MAP}, {"players", nlohmann::json::array()}, {"monsters", monsterJson} }}
+		});
+		send(client, "start", start);
+		client.started = true;
+		return;
+	}
+	if (!client.started) {
+		return;
+	}
+	client.stats.commandsReceived++;
+	if (client.awaitingAction) {
+		client.awaitingAction = false;
+		client.stats.actionLatencies.push_back(std::chrono::duration<double, std::milli>(Types::Clock::now() - client.lastUpdate).count());
+	}
+	if (event == "move") {
+		// Taken from wherever the server has the character, not from the x and y the client sent.
+		client.going_x = data.value("going_x", client.x);
+		client.going_y = data.value("going_y", client.y);
+		client.moving = client.going_x != client.x || client.going_y != client.y;
+		client.playerChanged = true;
+	} else if (event == "attack") {
+		const std::string target = data.value("id", "");
+		auto monster = std::find_if(monsters.begin(), monsters.end(), [&](const Monster& m) { return m.id == target; });
+		if (monster == monsters.end()) {
+			send(client, "game_response", { {"response", "attack_failed"}, {"id", target} });
+			return;
+		}
+		monster->hp -= ATTACK_DAMAGE;
+		client.mp = std::max(0L, client.mp - ATTACK_MP_COST);
+		client.playerChanged = true;
+		send(client, "game_response", { {"response", "attack_sent"}, {"id", target} });
+		if (monster->hp <= 0) {
+			for (auto& [id, other] : clients) {
+				if (other.started) {
+					send(other, "death", { {"id", target} });
+				}
+			}
+			// The replacement goes out with the next entities update.
+			*monster = spawn();
+		}
+	} else {
+		send(client, "game_response", { {"response", "data"}, {"place", event}, {"success", true} });
+	}
+}
+
+void StandInServer::tick() {
+	std::lock_guard<std::mutex> lock(guard);
+	const double seconds = options.tickInterval / 1000.0;
+	nlohmann::json changed = nlohmann::json::array();
+	for (Monster& monster : monsters) {
+		double dx = monster.going_x - monster.x;
+		double dy = monster.going_y - monster.y;
+		double distance = std::hypot(dx, dy);
+		double step = MONSTER_SPEED * seconds;
+		if (distance <= step) {
+			monster.x = monster.going_x;
+			monster.y = monster.going_y;
+			wander(monster);
+			changed.push_back(toJson(monster));
+		} else {
+			monster.x += dx / distance * step;
+			monster.y += dy / distance * step;
+			// Fresh spawns haven't been sent yet.
+			if (monster.move_num == 0) {
+				monster.move_num = 1;
+				changed.push_back(toJson(monster));
+			}
+		}
+	}
+	for (auto& [id, client] : clients) {
+		if (!client.started || (!client.moving && !client.playerChanged)) {
+			continue;
+		}
+		if (client.moving) {
+			const double dx = client.going_x - client.x;
+			const double dy = client.going_y - client.y;
+			const double distance = std::hypot(dx, dy);
+			const double step = CHARACTER_SPEED * seconds;
+			if (distance <= step) {
+				client.x = client.going_x;
+				client.y = client.going_y;
+				client.moving = false;
+			} else {
+				client.x += dx / distance * step;
+				client.y += dy / distance * step;
+			}
+		}
+		client.playerChanged = false;
+		send(client, "player", toPlayerJson(client));
+	}
+	nlohmann::json payload = { {"type", "xy"}, {"in", MAP}, {"map", MAP}, {"players", nlohmann::json::array()}, {"monsters", changed} };
+	const std::string frame = "42" + nlohmann::json::array({ "entities", payload }).dump();
+	const Types::TimePoint now = Types::Clock::now();
+	for (auto& [id, client] : clients) {
+		if (!client.started) {
+			continue;
+		}
+		client.socket->send(frame);
+		client.stats.framesSent++;
+		client.lastUpdate = now;
+		client.awaitingAction = true;
+	}
+}
+
+StandInServer::Monster StandInServer::spawn() {
+	std::uniform_real_distribution<double> xs(-AREA_WIDTH / 2, AREA_WIDTH / 2);
+	std::uniform_real_distribution<double> ys(-AREA_HEIGHT / 2, AREA_HEIGHT / 2);
+	Monster monster = { std::to_string(++nextMonsterId), xs(random), ys(random), 0, 0, MONSTER_HP, 0 };
+	monster.going_x = monster.x;
+	monster.going_y = monster.y;
+	wander(monster);
+	monster.move_num = 0;
+	return monster;
+}
+
+void StandInServer::wander(Monster& monster) {
+	std::uniform_real_distribution<double> offset(-100, 100);
+	monster.going_x = std::clamp(monster.x + offset(random), -AREA_WIDTH / 2, AREA_WIDTH / 2);
+	monster.going_y = std::clamp(monster.y + offset(random), -AREA_HEIGHT / 2, AREA_HEIGHT / 2);
+	monster.move_num++;
+}
+
+nlohmann::json StandInServer::toJson(const Monster& monster) const {
+	return {
+		{"id", monster.id}, {"type", MONSTER_TYPE},
+		{"x", monster.x}, {"y", monster.y}, {"going_x", monster.going_x}, {"going_y", monster.going_y},
+		{"moving", true}, {"move_num", monster.move_num}, {"speed", MONSTER_SPEED},
+		{"hp", monster.hp}, {"max_hp", MONSTER_HP}
+	};
+}
+
+nlohmann::json StandInServer::toPlayerJson(const Client& client) const {
+	return {
+		{"id", client.character}, {"map", MAP}, {"in", MAP},
+		{"x", client.x}, {"y", client.y}, {"going_x", client.going_x}, {"going_y", client.going_y},
+		{"moving", client.moving}, {"speed", CHARACTER_SPEED},
+		{"hp", client.hp}, {"max_hp", CHARACTER_HP}, {"mp", client.mp}, {"max_mp", CHARACTER_MP}
+	};
+}
+
+nlohmann::json StandInServer::buildGameData() const {
+	return {
+		{"version", options.version},
+		{"monsters", { {MONSTER_TYPE, { {"name", "Goo"}, {"hp", MONSTER_HP}, {"speed", MONSTER_SPEED}, {"range", 15}, {"attack", 10}, {"xp", 100} }} }},
+		{"skills", nlohmann::json::object()},
+		{"items", nlohmann::json::object()},
+		// No geometry, so there's nothing for MapProcessing to simplify.
+		{"geometry", nlohmann::json::object()},
+		{"maps", { {MAP, { {"spawns", { {0, 0} }} }} }}
+	};
+}
+
+void StandInServer::send(Client& client, const std::string& event, const nlohmann::json& data) {
+	client.socket->send("42" + nlohmann::json::array({ event, data }).dump());
+	client.stats.framesSent++;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#ifndef ALBOT_STANDINSERVER_HPP_
+#define ALBOT_STANDINSERVER_HPP_
+
+#include <ixwebsocket/IXHttpServer.h>
+#include <ixwebsocket/IXWebSocketServer.h>
+
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "albot/Utils/Timer.hpp"
+
+/**
+ * Just enough of Adventure Land to run bots against, locally.
+ *
+ * The HTTP side serves `/`, `/data.js`, and the `signup_or_login` and `servers_and_characters`
+ * API methods, the way HttpWrapper expects them. The websocket side speaks the Engine.IO v4
+ * handshake, then `welcome`, `start`, `entities`, `player`, `death` and `game_response`.
+ *
+ * Every character is put on the same synthetic map, full of monsters that wander around it.
+ * Characters walk where `move` sends them, and get a `player` update every tick they move, or
+ * after an attack has cost them mp.
+ * The time between sending an `entities` update and receiving the next command from that
+ * client is recorded as its event-to-action latency.
+ */
+class StandInServer {
+	public:
+		struct Options {
+			std::string host = "127.0.0.1";
+			int httpPort = 8080;
+			int socketPort = 8022;
+			// Monsters on the map. They spawn within a character's view of the origin.
+			size_t monsters = 50;
+			// How often monsters and characters move, and `entities` and `player` updates go out.
+			int tickInterval = 100;
+			int version = 1;
+			// Characters on the account, see characterName() and FIRST_CHARACTER_ID.
+			size_t characters = 4;
+		};
+		struct ClientStats {
+			std::string character;
+			size_t framesSent = 0;
+			size_t commandsReceived = 0;
+			// Milliseconds from an entities update to the next command, one per update that got a reaction.
+			std::vector<double> actionLatencies;
+		};
+	private:
+		struct Monster {
+			std::string id;
+			double x;
+			double y;
+			double going_x;
+			double going_y;
+			long hp;
+			long move_num;
+		};
+		struct Client {
+			ix::WebSocket* socket = nullptr;
+			std::string character;
+			bool started = false;
+			// The character as the server has it. `move` sets where it's going, tick() walks it there.
+			double x = 0;
+			double y = 0;
+			double going_x = 0;
+			double going_y = 0;
+			bool moving = false;
+			long hp = 0;
+			long mp = 0;
+			// Whether the next tick has to send a `player` update even if the character stands still.
+			bool playerChanged = false;
+			bool awaitingAction = false;
+			Types::TimePoint lastUpdate;
+			ClientStats stats;
+		};
+
+		Options options;
+		ix::HttpServer http;
+		ix::WebSocketServer websocket;
+		std::thread ticker;
+		std::atomic<bool> running = false;
+
+		std::mutex guard;
+		std::map<std::string, Client> clients;
+		std::vector<Monster> monsters;
+		size_t nextMonsterId = 0;
+		std::mt19937 random;
+
+		ix::HttpResponsePtr onRequest(ix::HttpRequestPtr request);
+		void onMessage(std::shared_ptr<ix::ConnectionState> state, ix::WebSocket& socket, const ix::WebSocketMessagePtr& message);
+		/**
+		 * Handles a Socket.IO event from a client. The caller must hold guard.
+		 */
+		void onEvent(Client& client, const std::string& event, const nlohmann::json& data);
+		void tick();
+
+		Monster spawn();
+		void wander(Monster& monster);
+		nlohmann::json toJson(const Monster& monster) const;
+		nlohmann::json toPlayerJson(const Client& client) const;
+		nlohmann::json buildGameData() const;
+		static void send(Client& client, const std::string& event, const nlohmann::json& data);
+	public:
+		// Character ids count up from here, in the order of their names.
+		static constexpr uint64_t FIRST_CHARACTER_ID = 1000;
+		/**
+		 * @returns  The name of the index-th character on the account.
+		 */
+		static std::string characterName(size_t index);
+
+		explicit StandInServer(Options options);
+		~StandInServer();
+
+		/**
+		 * @returns  false if either port couldn't be bound.
+		 */
+		bool start();
+		void stop();
+
+		/**
+		 * A copy of the stats of every client that got as far as `start`, keyed by character.
+		 */
+		std::map<std::string, ClientStats> getStats();
+};
+
+#endif /* ALBOT_STANDINSERVER_HPP_ */